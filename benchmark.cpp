@@ -0,0 +1,686 @@
+/**
+ *  Benchmark.cpp
+ *
+ *  Benchmarks for the separate stages of the algorithm, and for the complete
+ *  patch. Each stage runs over a corpus of typical inputs (small edits, large
+ *  rewrites, repetitive html, binary data, utf8 text and append-only logs)
+ *  that is generated with a fixed seed, so that every run uses the same data.
+ *  The corpus is generated instead of stored next to the benchmark, so that
+ *  the sizes of the samples can be changed without adding big files.
+ *  For each stage the throughput and the number of memory allocations per
+ *  diff (of the complete patch of the same input) are reported. All stages
+ *  use the public classes of the library, the same way as an application.
+ *
+ *  Compile and run:
+ *
+ *      g++ -O2 -std=c++11 -pthread benchmark.cpp -o benchmark
+ *      ./benchmark [stage-or-sample]
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Dependencies
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+#include "include/limits.h"
+#include "include/patch.h"
+#include "include/resumablediff.h"
+
+/**
+ *  Number of memory allocations since the program started
+ *  @var std::atomic
+ */
+static std::atomic<size_t> allocations(0);
+
+/**
+ *  Count all allocations (the arenas and the buffers of the library allocate
+ *  with operator new too, so these are counted as well)
+ *  @param  size
+ *  @return void*
+ */
+void *operator new(size_t size)
+{
+    // count the allocation
+    allocations.fetch_add(1, std::memory_order_relaxed);
+
+    // allocate the memory (malloc() may return nullptr for zero bytes)
+    void *data = malloc(size > 0 ? size : 1);
+    if (data == nullptr) throw std::bad_alloc();
+
+    // done
+    return data;
+}
+
+/**
+ *  The other forms of operator new use the one above
+ *  @param  size
+ *  @return void*
+ */
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { try { return operator new(size); } catch (...) { return nullptr; } }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { try { return operator new(size); } catch (...) { return nullptr; } }
+
+/**
+ *  And all forms of operator delete release the memory (gcc warns when it
+ *  inlines these, because it does not see that operator new uses malloc())
+ *  @param  data
+ */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *data) noexcept { free(data); }
+void operator delete[](void *data) noexcept { free(data); }
+void operator delete(void *data, const std::nothrow_t &) noexcept { free(data); }
+void operator delete[](void *data, const std::nothrow_t &) noexcept { free(data); }
+#ifdef __cpp_sized_deallocation
+void operator delete(void *data, size_t) noexcept { free(data); }
+void operator delete[](void *data, size_t) noexcept { free(data); }
+#endif
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Benchmark
+{
+private:
+    /**
+     *  An input of the corpus
+     */
+    struct Sample
+    {
+        /**
+         *  Name of the sample
+         *  @var const char *
+         */
+        const char *name;
+
+        /**
+         *  Should the texts be compared as utf8?
+         *  @var bool
+         */
+        bool utf8;
+
+        /**
+         *  The two texts
+         *  @var std::string
+         */
+        std::string text1;
+        std::string text2;
+    };
+
+    /**
+     *  The result of a stage
+     */
+    struct Result
+    {
+        /**
+         *  Number of bytes that were processed by a single run
+         *  @var size_t
+         */
+        size_t bytes = 0;
+
+        /**
+         *  Number of diffs that were calculated by a single run (zero if the stage does not calculate diffs)
+         *  @var size_t
+         */
+        size_t diffs = 0;
+    };
+
+    /**
+     *  Random number generator for the corpus
+     *  @var std::mt19937
+     */
+    std::mt19937 _random{2018};
+
+    /**
+     *  The corpus
+     *  @var std::vector
+     */
+    std::vector<Sample> _samples;
+
+    /**
+     *  Only the samples and stages that contain this string are run (nullptr to run everything)
+     *  @var const char *
+     */
+    const char *_filter;
+
+    /**
+     *  Random number in a range
+     *  @param  max         the range (exclusive)
+     *  @return size_t
+     */
+    size_t random(size_t max) { return _random() % max; }
+
+    /**
+     *  A random word, the words have a skewed distribution like in real texts
+     *  @param  utf8        should the word contain non-ascii characters?
+     *  @return std::string
+     */
+    std::string word(bool utf8)
+    {
+        // the syllables that the words are made of
+        static const char *ascii[] = { "the", "an", "of", "in", "to", "com", "pa", "ni", "ca", "re", "der", "mo", "li", "ta", "se", "ver", "un", "ex", "pro", "di" };
+        static const char *other[] = { "é", "ü", "ø", "ñ", "ß", "Ж", "ди", "ф", "日本", "語", "中", "λ", "ω", "☃", "€" };
+
+        // small numbers are more likely (so that some words are much more common)
+        size_t seed = random(40) * random(40) / 40;
+
+        // the word
+        std::string result;
+
+        // add a couple of syllables
+        for (size_t i = 0, count = 1 + seed % 3; i < count; ++i)
+        {
+            // most syllables are ascii
+            if (utf8 && (seed + i) % 3 == 0) result.append(other[(seed * 7 + i) % 15]);
+            else result.append(ascii[(seed * 13 + i * 5) % 20]);
+        }
+
+        // done
+        return result;
+    }
+
+    /**
+     *  A random line of words
+     *  @param  utf8        should the line contain non-ascii characters?
+     *  @return std::string
+     */
+    std::string line(bool utf8)
+    {
+        // the line
+        std::string result;
+
+        // add the words
+        for (size_t i = 0, count = 4 + random(12); i < count; ++i) result.append(word(utf8)).append(i + 1 == count ? ".\n" : " ");
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Random lines of text
+     *  @param  size        minimum number of bytes
+     *  @param  utf8        should the text contain non-ascii characters?
+     *  @return std::string
+     */
+    std::string text(size_t size, bool utf8)
+    {
+        // the text
+        std::string result;
+
+        // add lines until it is big enough
+        while (result.size() < size) result.append(line(utf8));
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Apply small random edits to a text, the edits start and end at a space,
+     *  so that utf8 characters are never split up
+     *  @param  input       the original text
+     *  @param  count       number of edits
+     *  @param  utf8        may the inserted data contain non-ascii characters?
+     *  @return std::string
+     */
+    std::string edit(const std::string &input, size_t count, bool utf8)
+    {
+        // the result
+        std::string result(input);
+
+        // apply the edits
+        for (size_t i = 0; i < count && !result.empty(); ++i)
+        {
+            // the start of the edit (at a space)
+            size_t start = result.find(' ', random(result.size()));
+            if (start == std::string::npos) continue;
+
+            // the end of the edit (some words further)
+            size_t end = start;
+            for (size_t words = random(4); words > 0 && end != std::string::npos; --words) end = result.find(' ', end + 1);
+            if (end == std::string::npos) end = start;
+
+            // the words that are inserted instead
+            std::string replacement;
+            for (size_t words = random(4); words > 0; --words) replacement.append(" ").append(word(utf8));
+
+            // apply the edit
+            result.replace(start, end - start, replacement);
+        }
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Rewrite about half of the lines of a text
+     *  @param  input       the original text
+     *  @return std::string
+     */
+    std::string rewrite(const std::string &input)
+    {
+        // the result
+        std::string result;
+
+        // process all lines
+        for (size_t start = 0; start < input.size(); )
+        {
+            // the end of the line
+            size_t end = std::min(input.find('\n', start), input.size() - 1) + 1;
+
+            // keep the line or write a new one
+            if (random(2)) result.append(input, start, end - start);
+            else result.append(line(false));
+
+            // next line
+            start = end;
+        }
+
+        // done
+        return result;
+    }
+
+    /**
+     *  A repetitive html document
+     *  @param  rows        number of rows in the table
+     *  @return std::string
+     */
+    std::string html(size_t rows)
+    {
+        // the document
+        std::string result("<html>\n<body>\n<table>\n");
+
+        // add the rows
+        for (size_t i = 0; i < rows; ++i)
+        {
+            // the cells
+            result.append("  <tr class=\"row\"><td class=\"name\">").append(word(false)).append("</td><td class=\"value\">");
+            result.append(std::to_string(random(100000))).append("</td></tr>\n");
+        }
+
+        // done
+        return result.append("</table>\n</body>\n</html>\n");
+    }
+
+    /**
+     *  Binary data: runs of zeros, random bytes and repeated records
+     *  @param  size        number of bytes
+     *  @return std::string
+     */
+    std::string binary(size_t size)
+    {
+        // the data
+        std::string result;
+
+        // add blocks until it is big enough
+        while (result.size() < size)
+        {
+            // the kind of block
+            switch (random(3)) {
+            case 0: result.append(random(64), '\0'); break;
+            case 1: for (size_t i = random(64); i > 0; --i) result.push_back((char)random(256)); break;
+            case 2: result.append("\x7f" "ELF\x02\x01\x01\0\0\0", 10); break;
+            }
+        }
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Change random bytes of binary data
+     *  @param  input       the original data
+     *  @param  count       number of changes
+     *  @return std::string
+     */
+    std::string corrupt(const std::string &input, size_t count)
+    {
+        // the result
+        std::string result(input);
+
+        // replace, insert or remove a couple of bytes
+        for (size_t i = 0; i < count; ++i)
+        {
+            // the position
+            size_t position = random(result.size());
+
+            // apply the change
+            switch (random(3)) {
+            case 0: result.replace(position, 1 + random(8), binary(1 + random(8))); break;
+            case 1: result.insert(position, binary(1 + random(16))); break;
+            case 2: result.erase(position, 1 + random(16)); break;
+            }
+        }
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Lines of a log file
+     *  @param  first       number of the first line
+     *  @param  size        minimum number of bytes
+     *  @return std::string
+     */
+    std::string log(size_t first, size_t size)
+    {
+        // the log
+        std::string result;
+
+        // add lines until it is big enough
+        for (size_t i = first; result.size() < size; ++i)
+        {
+            // format the line
+            char buffer[128];
+            snprintf(buffer, sizeof(buffer), "2018-11-27 12:%02zu:%02zu [info] worker %zu: processed request %zu in %zums\n", i / 60 % 60, i % 60, random(8), i * 7 + random(7), random(200));
+
+            // add it
+            result.append(buffer);
+        }
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Should a stage run for a sample?
+     *  @param  stage       name of the stage
+     *  @param  sample      the sample
+     *  @return bool
+     */
+    bool selected(const char *stage, const Sample &sample) const
+    {
+        // without a filter everything runs
+        return _filter == nullptr || strstr(stage, _filter) != nullptr || strstr(sample.name, _filter) != nullptr;
+    }
+
+    /**
+     *  Run a stage often enough to get a stable measurement, and report the result
+     *  @param  stage       name of the stage
+     *  @param  sample      the sample
+     *  @param  diffs       number of diffs of the complete patch of the sample
+     *  @param  function    the stage
+     */
+    template <typename function_t>
+    void measure(const char *stage, const Sample &sample, size_t diffs, const function_t &function)
+    {
+        // leap out if the stage is not selected
+        if (!selected(stage, sample)) return;
+
+        // the clock that we use
+        typedef std::chrono::steady_clock clock;
+
+        // run once to warm up
+        Result result = function();
+
+        // the allocations and the time before the runs
+        size_t allocated = allocations.load();
+        clock::time_point start = clock::now();
+
+        // number of runs, and the time that they took
+        size_t runs = 0;
+        double seconds = 0.0;
+
+        // keep running until we have at least a couple of runs and a tenth of a second
+        while (runs < 3 || seconds < 0.1)
+        {
+            // run the stage
+            function(); ++runs;
+
+            // the time so far
+            seconds = std::chrono::duration<double>(clock::now() - start).count();
+        }
+
+        // number of allocations per run
+        double perrun = double(allocations.load() - allocated) / runs;
+
+        // the number of diffs of the stage itself, or else of the complete patch
+        size_t count = result.diffs > 0 ? result.diffs : diffs;
+
+        // report the result
+        printf("%-12s %-14s %10.1f us %10.1f MB/s %10.2f allocs/diff\n", stage, sample.name, seconds * 1e6 / runs, result.bytes * runs / seconds / 1e6, count > 0 ? perrun / count : 0.0);
+    }
+
+    /**
+     *  Run all stages for a sample
+     *  @param  sample      the sample
+     */
+    template <typename text_t>
+    void run(const Sample &sample)
+    {
+        // default limits, and limits without a deadline (so that the stage does not take a shortcut)
+        Limits limits, unlimited;
+        unlimited.timeout = 0;
+
+        // the texts
+        text_t text1(sample.text1.data(), sample.text1.size());
+        text_t text2(sample.text2.data(), sample.text2.size());
+
+        // the complete patch, to find out the number of diffs
+        size_t diffs = Patch<text_t>(limits, text1, text2).size();
+
+        // a copy of the first text with only the last and first byte changed, so that the prefix and suffix cover it
+        std::string copy1(sample.text1), copy2(sample.text1);
+        if (!copy1.empty()) { copy1.back() ^= 1; copy2.front() ^= 1; }
+        text_t last(copy1.data(), copy1.size()), first(copy2.data(), copy2.size());
+
+        // the common prefix and suffix
+        measure("prefix", sample, diffs, [&]() { Result result; result.bytes = CommonPrefix<text_t>(text1, last).bytes(); return result; });
+        measure("suffix", sample, diffs, [&]() { Result result; result.bytes = CommonSuffix<text_t>(text1, first).bytes(); return result; });
+
+        // the long and short text for the half-match
+        const text_t &longtext = text1.characters() > text2.characters() ? text1 : text2;
+        const text_t &shorttext = &longtext == &text1 ? text2 : text1;
+
+        // a single seed of the half-match
+        measure("commonhalf", sample, diffs, [&]() {
+            SeedIndex<text_t> seeds(shorttext, longtext.characters() / 4);
+            CommonHalf<text_t> half(longtext, shorttext, (longtext.characters() + 3) / 4, seeds);
+            Result result; result.bytes = longtext.bytes() + shorttext.bytes(); return result;
+        });
+
+        // the complete half-match
+        measure("halfmatch", sample, diffs, [&]() {
+            HalfMatch<text_t> half(longtext, shorttext);
+            Result result; result.bytes = longtext.bytes() + shorttext.bytes(); return result;
+        });
+
+        // a single middle snake search (without a deadline, over the first part of the texts, because it is quadratic for very different texts)
+        text_t part1(sample.text1.data(), std::min<size_t>(boundary(sample.text1, 16384), sample.text1.size()));
+        text_t part2(sample.text2.data(), std::min<size_t>(boundary(sample.text2, 16384), sample.text2.size()));
+        auto elements1 = elements(part1), elements2 = elements(part2);
+        measure("middlesnake", sample, diffs, [&]() {
+            Arena arena; Scratch scratch(arena); Deadline deadline(unlimited.deadline());
+            MiddleSnake<typename Elements<text_t>::type> snake(elements1.data(), elements1.size(), elements2.data(), elements2.size(), deadline, scratch);
+            Result result; result.bytes = part1.bytes() + part2.bytes(); return result;
+        });
+
+        // the bit-parallel algorithm, over the first part of the texts that it accepts
+        text_t short1(sample.text1.data(), std::min<size_t>(boundary(sample.text1, 256), sample.text1.size()));
+        text_t short2(sample.text2.data(), std::min<size_t>(boundary(sample.text2, 256), sample.text2.size()));
+        auto shortelements1 = elements(short1), shortelements2 = elements(short2);
+        measure("bitparallel", sample, 0, [&]() {
+            Arena arena; Scratch scratch(arena);
+            BitParallel<typename Elements<text_t>::type> lcs(shortelements1.data(), shortelements1.size(), shortelements2.data(), shortelements2.size(), scratch);
+            Result result; result.bytes = short1.bytes() + short2.bytes(); result.diffs = lcs.size(); return result;
+        });
+
+        // the lines of the texts, they share the dictionary so that identical lines get identical tokens
+        Dictionary dictionary;
+        Lines lines1, lines2;
+        measure("lines", sample, diffs, [&]() {
+            dictionary.clear();
+            lines1.assign(text1.buffer(), dictionary);
+            lines2.assign(text2.buffer(), dictionary);
+            Result result; result.bytes = text1.bytes() + text2.bytes(); return result;
+        });
+
+        // the line tokens
+        Tokens tokens1 = lines1.tokens(), tokens2 = lines2.tokens();
+        size_t bytes = tokens1.bytes() + tokens2.bytes();
+
+        // the diff over the lines
+        measure("linemode", sample, 0, [&]() {
+            Patch<Tokens> patch(limits, tokens1, tokens2, false);
+            Result result; result.bytes = bytes; result.diffs = patch.size(); return result;
+        });
+
+        // the anchors of the anchor based algorithms for the lines
+        measure("patience", sample, diffs, [&]() {
+            Patience patience(Elements<Tokens>::data(tokens1), tokens1.characters(), Elements<Tokens>::data(tokens2), tokens2.characters());
+            Result result; result.bytes = bytes; return result;
+        });
+        measure("histogram", sample, diffs, [&]() {
+            Histogram histogram(Elements<Tokens>::data(tokens1), tokens1.characters(), Elements<Tokens>::data(tokens2), tokens2.characters());
+            Result result; result.bytes = bytes; return result;
+        });
+
+        // the diffs of the complete patch, for the cleanup passes
+        Patch<text_t> complete(limits, text1, text2);
+        std::vector<Diff> operations(complete.begin(), complete.end());
+
+        // the cleanup passes
+        measure("semantic", sample, 0, [&]() {
+            Cleanup<text_t> cleanup(text1, text2);
+            cleanup.semantic(operations);
+            Result result; result.bytes = text1.bytes() + text2.bytes(); result.diffs = operations.size(); return result;
+        });
+        measure("efficiency", sample, 0, [&]() {
+            Cleanup<text_t> cleanup(text1, text2);
+            cleanup.efficiency(operations, limits.editcost);
+            Result result; result.bytes = text1.bytes() + text2.bytes(); result.diffs = operations.size(); return result;
+        });
+
+        // the complete patch
+        measure("patch", sample, diffs, [&]() {
+            Patch<text_t> patch(limits, text1, text2);
+            Result result; result.bytes = text1.bytes() + text2.bytes(); return result;
+        });
+
+        // the complete patch, calculated in steps of a millisecond
+        measure("resumable", sample, diffs, [&]() {
+            ResumableDiff<text_t> diff(limits, text1, text2);
+            while (!diff.step(0.001)) {}
+            Result result; result.bytes = text1.bytes() + text2.bytes(); return result;
+        });
+    }
+
+    /**
+     *  Move a byte offset in a text back to the start of a utf8 character (this
+     *  also works for the other samples, because they do not use the offset as text)
+     *  @param  text        the text
+     *  @param  offset      the byte offset
+     *  @return size_t
+     */
+    static size_t boundary(const std::string &text, size_t offset)
+    {
+        // skip back over the continuation bytes
+        while (offset > 0 && offset < text.size() && ((unsigned char)text[offset] & 0xc0) == 0x80) --offset;
+        return offset;
+    }
+
+    /**
+     *  The elements of a text in an array (the code points for utf8 texts)
+     *  @param  text        the text
+     *  @return std::vector
+     */
+    template <typename text_t>
+    static std::vector<typename Elements<text_t>::type> elements(const text_t &text)
+    {
+        // copy the elements
+        std::vector<typename Elements<text_t>::type> result;
+        for (auto element : text) result.push_back(element);
+        return result;
+    }
+
+public:
+    /**
+     *  Constructor, this generates the corpus
+     *  @param  filter      only run the samples and stages that contain this string (nullptr for all)
+     */
+    Benchmark(const char *filter) : _filter(filter)
+    {
+        // a long text with a couple of small edits
+        std::string original(text(256 * 1024, false));
+        _samples.push_back(Sample{ "small-edits", false, original, edit(original, 100, false) });
+
+        // a text of which half of the lines have been rewritten
+        std::string article(text(32 * 1024, false));
+        _samples.push_back(Sample{ "rewrite", false, article, rewrite(article) });
+
+        // a repetitive html document with some changed cells
+        std::string document(html(4096));
+        _samples.push_back(Sample{ "html", false, document, edit(document, 200, false) });
+
+        // binary data
+        std::string data(binary(128 * 1024));
+        _samples.push_back(Sample{ "binary", false, data, corrupt(data, 200) });
+
+        // utf8 text
+        std::string international(text(128 * 1024, true));
+        _samples.push_back(Sample{ "utf8", true, international, edit(international, 100, true) });
+
+        // a log file to which new lines were appended
+        std::string logfile(log(0, 256 * 1024));
+        _samples.push_back(Sample{ "append-log", false, logfile, logfile + log(100000, 32 * 1024) });
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Benchmark() = default;
+
+    /**
+     *  Run the benchmarks
+     */
+    void run()
+    {
+        // the header
+        printf("%-12s %-14s %13s %15s %17s\n", "stage", "sample", "time", "throughput", "allocations");
+
+        // run all samples with the right text type
+        for (const auto &sample : _samples)
+        {
+            // only utf8 needs the slower text type
+            if (sample.utf8) run<Utf8>(sample); else run<Ascii>(sample);
+        }
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
+/**
+ *  Main procedure
+ *  @param  argc
+ *  @param  argv
+ *  @return int
+ */
+int main(int argc, const char *argv[])
+{
+    // the benchmarks, with an optional filter
+    DIFF::Benchmark benchmark(argc > 1 ? argv[1] : nullptr);
+
+    // run them
+    benchmark.run();
+
+    // done
+    return 0;
+}
@@ -0,0 +1,33 @@
+/**
+ *  Algorithm.h
+ *
+ *  The algorithms that can be used for patches over tokens (the lines of
+ *  the linemode, and the tokens of a tokenizer)
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  The enumeration class
+ */
+enum class Algorithm : unsigned char {
+    MYERS,
+    PATIENCE,
+    HISTOGRAM
+};
+
+/**
+ *  End of namespace
+ */
+}
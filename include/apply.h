@@ -0,0 +1,390 @@
+/**
+ *  Apply.h
+ *
+ *  Class that applies hunks to a text. Each hunk is first looked up at its
+ *  expected location. If the text is still the same there, the hunk is
+ *  applied right away. Otherwise the bitap algorithm searches for the best
+ *  fuzzy match nearby, and the changes of the hunk are mapped onto the text
+ *  that was found, just like the patch_apply() function of diff-match-patch.
+ *  Hunks that can not be found are skipped.
+ *
+ *  The result is built in a single pass as long as the hunks are found at
+ *  their expected locations: the unchanged data between the hunks is only
+ *  copied once. The hunks of multiple patches (for example a chain of
+ *  revisions) can be applied in one go.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <vector>
+#include "arena.h"
+#include "ascii.h"
+#include "buffer.h"
+#include "hunks.h"
+#include "limits.h"
+#include "match.h"
+#include "metrics.h"
+#include "patch.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Apply
+{
+private:
+    /**
+     *  Object with the limits / settings for the algorithm
+     *  @var Limits
+     */
+    const Limits &_limits;
+
+    /**
+     *  The text that has been processed so far
+     *  @var std::vector
+     */
+    std::vector<char> _result;
+
+    /**
+     *  Copy of the text after a hunk was applied at a fuzzy location
+     *  @var std::vector
+     */
+    std::vector<char> _buffer;
+
+    /**
+     *  The text that is not yet processed: the input (or the buffer) from a certain position
+     *  @var const char *
+     *  @var size_t
+     *  @var size_t
+     */
+    const char *_input;
+    size_t _size;
+    size_t _consumed = 0;
+
+    /**
+     *  Was each hunk applied?
+     *  @var std::vector
+     */
+    std::vector<bool> _applied;
+
+    /**
+     *  Memory for the diffs of fuzzy matches
+     *  @var Arena
+     */
+    Arena _arena;
+
+    /**
+     *  Move the complete text into the buffer
+     */
+    void flatten()
+    {
+        // construct the complete text
+        std::vector<char> text;
+        text.reserve(_result.size() + _size - _consumed);
+        text.insert(text.end(), _result.begin(), _result.end());
+        text.insert(text.end(), _input + _consumed, _input + _size);
+
+        // this is the new input
+        _buffer.swap(text);
+        _result.clear();
+        _input = _buffer.data();
+        _size = _buffer.size();
+        _consumed = 0;
+    }
+
+    /**
+     *  Apply a hunk at its expected location, if the text is unchanged there
+     *  @param  hunk        the hunk
+     *  @param  location    the expected location
+     *  @return bool        was the hunk applied?
+     */
+    bool exact(const Hunk &hunk, size_t location)
+    {
+        // the location must not be in the part of the text that was already processed
+        if (location < _result.size()) return false;
+
+        // the location in the unprocessed text
+        size_t offset = location - _result.size() + _consumed;
+
+        // the text must be the same as before the change
+        if (offset + hunk.length1() > _size || (hunk.length1() > 0 && memcmp(_input + offset, hunk.before().data(), hunk.length1()) != 0)) return false;
+
+        // copy the unchanged text, and the text after the change
+        _result.insert(_result.end(), _input + _consumed, _input + offset);
+        _result.insert(_result.end(), hunk.after().data(), hunk.after().data() + hunk.length2());
+
+        // the text before the change is skipped
+        _consumed = offset + hunk.length1();
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Levenshtein distance of a patch
+     *  @param  patch       the patch
+     *  @return size_t
+     */
+    static size_t levenshtein(const Patch<Ascii> &patch)
+    {
+        // count the diffs
+        return Metrics(patch).levenshtein();
+    }
+
+    /**
+     *  Map a position in the first input of a patch to the second input
+     *  @param  patch       the patch
+     *  @param  position    position in the first input
+     *  @return size_t
+     */
+    static size_t translate(const Patch<Ascii> &patch, size_t position)
+    {
+        // the positions after the current and the previous diff
+        size_t position1 = 0, position2 = 0, previous1 = 0, previous2 = 0;
+
+        // walk over the diffs
+        for (const auto &diff : patch)
+        {
+            // update the positions
+            if (diff.operation() != Operation::INSERT) position1 += diff.bytes();
+            if (diff.operation() != Operation::DELETE) position2 += diff.bytes();
+
+            // is this the diff that holds the position?
+            if (position1 > position)
+            {
+                // a deleted position is mapped to the start of the deletion
+                if (diff.operation() == Operation::DELETE) return previous2;
+                break;
+            }
+
+            // remember where the diff ended
+            previous1 = position1;
+            previous2 = position2;
+        }
+
+        // the position is moved just as much as the diff in which it is located
+        return previous2 + (position - previous1);
+    }
+
+    /**
+     *  Apply a hunk at a fuzzy location
+     *  @param  hunk        the hunk
+     *  @param  location    the expected location
+     *  @return ssize_t     the location where the hunk was applied, -1 if it was not found
+     */
+    ssize_t fuzzy(const Hunk &hunk, size_t location)
+    {
+        // the complete text must be in the buffer
+        flatten();
+
+        // size of the hunk and the max size of the pattern
+        size_t length = hunk.length1();
+        size_t maxsize = std::max(1, (int)_limits.Match_MaxBits);
+        const char *before = hunk.before().data();
+
+        // the start and end of the match
+        ssize_t start = -1, end = -1;
+
+        // big hunks are matched at both ends
+        if (length > maxsize)
+        {
+            // match the start, and the end after it
+            start = Match(_limits, _input, _size, before, maxsize, location).position();
+            if (start >= 0) end = Match(_limits, _input, _size, before + length - maxsize, maxsize, location + length - maxsize).position();
+            if (end < 0 || start >= end) start = -1;
+        }
+
+        // small hunks are matched completely
+        else start = Match(_limits, _input, _size, before, length, location).position();
+
+        // leap out if the hunk was not found
+        if (start < 0) return -1;
+
+        // the text that was found
+        size_t found = std::min(_size, end < 0 ? start + length : end + maxsize) - start;
+
+        // is it identical to the text before the change?
+        if (found == length && (length == 0 || memcmp(_input + start, before, length) == 0))
+        {
+            // replace it with the text after the change
+            _buffer.erase(_buffer.begin() + start, _buffer.begin() + start + length);
+            _buffer.insert(_buffer.begin() + start, hunk.after().data(), hunk.after().data() + hunk.length2());
+        }
+        else
+        {
+            // the memory of the previous fuzzy match is no longer needed
+            _arena.reset();
+
+            // the diff between the text that was expected and the text that was found
+            Patch<Ascii> patch(_limits, Ascii(before, length), Ascii(_input + start, found), _arena, false);
+
+            // big hunks are not applied if the text is too different
+            if (length > maxsize && (double)levenshtein(patch) / length > _limits.Patch_DeleteThreshold) return -1;
+
+            // the position in the text before the change (including what was inserted so far)
+            size_t position = 0;
+
+            // apply the changes one by one
+            for (const auto &diff : hunk.diffs())
+            {
+                // map the position onto the text that was found
+                size_t offset = std::min(_buffer.size(), start + translate(patch, position));
+
+                // insert or remove the data
+                if (diff.operation() == Operation::INSERT) _buffer.insert(_buffer.begin() + offset, hunk.after().data() + diff.offset(), hunk.after().data() + diff.offset() + diff.bytes());
+                if (diff.operation() == Operation::DELETE) _buffer.erase(_buffer.begin() + offset, _buffer.begin() + std::max(offset, std::min(_buffer.size(), start + translate(patch, position + diff.bytes()))));
+
+                // deleted data does not move the position
+                if (diff.operation() != Operation::DELETE) position += diff.bytes();
+            }
+        }
+
+        // the buffer may have been changed
+        _input = _buffer.data();
+        _size = _buffer.size();
+
+        // done
+        return start;
+    }
+
+    /**
+     *  Apply all hunks of a patch
+     *  @param  hunks       the hunks
+     */
+    void apply(const Hunks &hunks)
+    {
+        // difference between the expected locations and the actual locations
+        ssize_t delta = 0;
+
+        // process all hunks
+        for (const auto &hunk : hunks)
+        {
+            // the expected location
+            size_t location = std::max(ssize_t(0), (ssize_t)hunk.start2() + delta);
+
+            // try the expected location first
+            if (exact(hunk, location)) { _applied.push_back(true); continue; }
+
+            // look for a fuzzy match
+            ssize_t start = fuzzy(hunk, location);
+
+            // store the result
+            _applied.push_back(start >= 0);
+
+            // update the difference between the expected and actual locations
+            if (start >= 0) delta += start - (ssize_t)location;
+            else delta -= (ssize_t)hunk.length2() - (ssize_t)hunk.length1();
+        }
+
+        // the rest of the text is unchanged
+        _result.insert(_result.end(), _input + _consumed, _input + _size);
+        _consumed = _size;
+    }
+
+public:
+    /**
+     *  Apply the hunks of a patch to a text
+     *  @param  limits      the limits with the match and patch settings
+     *  @param  hunks       the hunks to apply
+     *  @param  data        the text
+     *  @param  size        size of the text
+     */
+    Apply(const Limits &limits, const Hunks &hunks, const char *data, size_t size) : Apply(limits, &hunks, 1, data, size) {}
+
+    /**
+     *  Apply the hunks of many patches to a text, one patch after the other
+     *  @param  limits      the limits with the match and patch settings
+     *  @param  hunks       the hunks of each patch
+     *  @param  count       number of patches
+     *  @param  data        the text
+     *  @param  size        size of the text
+     */
+    Apply(const Limits &limits, const Hunks *hunks, size_t count, const char *data, size_t size) :
+        _limits(limits), _input(data), _size(size)
+    {
+        // apply the patches
+        for (size_t i = 0; i < count; ++i)
+        {
+            // the result of the previous patch is the input of the next one
+            if (i > 0) { _buffer.swap(_result); _result.clear(); _input = _buffer.data(); _size = _buffer.size(); _consumed = 0; }
+
+            // apply the patch
+            apply(hunks[i]);
+        }
+
+        // without any patch, the text is unchanged
+        if (count == 0) _result.assign(data, data + size);
+    }
+
+    /**
+     *  Apply the hunks of many patches to a text, one patch after the other
+     *  @param  limits      the limits with the match and patch settings
+     *  @param  hunks       the hunks of each patch
+     *  @param  data        the text
+     *  @param  size        size of the text
+     */
+    Apply(const Limits &limits, const std::vector<Hunks> &hunks, const char *data, size_t size) : Apply(limits, hunks.data(), hunks.size(), data, size) {}
+
+    /**
+     *  Objects can not be copied
+     *  @param  that
+     */
+    Apply(const Apply &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Apply() = default;
+
+    /**
+     *  The patched text
+     *  @return Buffer      a view that is valid as long as this object exists
+     */
+    Buffer buffer() const { return Buffer(_result.data(), _result.size(), false); }
+
+    /**
+     *  Size of the patched text
+     *  @return size_t
+     */
+    size_t bytes() const { return _result.size(); }
+
+    /**
+     *  Number of hunks that were processed
+     *  @return size_t
+     */
+    size_t size() const { return _applied.size(); }
+
+    /**
+     *  Was a hunk applied? The hunks of all patches are numbered one after the other
+     *  @param  index       index of the hunk
+     *  @return bool
+     */
+    bool applied(size_t index) const { return _applied[index]; }
+
+    /**
+     *  Were all hunks applied?
+     *  @return bool
+     */
+    operator bool () const { return std::find(_applied.begin(), _applied.end(), false) == _applied.end(); }
+};
+
+/**
+ *  End of namespace
+ */
+}
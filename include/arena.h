@@ -0,0 +1,253 @@
+/**
+ *  Arena.h
+ *
+ *  Monotonic memory allocator. Memory is handed out from big blocks, and
+ *  is never released individually: all memory is released at once when the
+ *  arena is reset. The blocks themselves are kept, so that an arena that
+ *  is reset and reused does not have to allocate anything once it has
+ *  grown to its working size.
+ *
+ *  This is used for the short-lived temporary memory that is needed while
+ *  a diff is being calculated.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <vector>
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Arena
+{
+private:
+    /**
+     *  Default size of a block
+     *  @var size_t
+     */
+    static const size_t blocksize = 64 * 1024;
+
+    /**
+     *  A block of memory
+     */
+    struct Block
+    {
+        /**
+         *  The data
+         *  @var char*
+         */
+        char *data;
+
+        /**
+         *  Size of the block
+         *  @var size_t
+         */
+        size_t size;
+    };
+
+    /**
+     *  All blocks that have been allocated
+     *  @var std::vector
+     */
+    std::vector<Block> _blocks;
+
+    /**
+     *  Index of the block from which memory is handed out
+     *  @var size_t
+     */
+    size_t _current = 0;
+
+    /**
+     *  Number of bytes of the current block that are in use
+     *  @var size_t
+     */
+    size_t _used = 0;
+
+public:
+    /**
+     *  Constructor
+     */
+    Arena() = default;
+
+    /**
+     *  Arenas can not be copied
+     *  @param  that
+     */
+    Arena(const Arena &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Arena()
+    {
+        // free all blocks
+        for (auto &block : _blocks) ::operator delete(block.data);
+    }
+
+    /**
+     *  Allocate memory
+     *  @param  size        number of bytes
+     *  @param  alignment   required alignment (must be a power of two)
+     *  @return void*
+     */
+    void *allocate(size_t size, size_t alignment)
+    {
+        // walk over the blocks that we already have
+        for (; _current < _blocks.size(); ++_current, _used = 0)
+        {
+            // the block to allocate from
+            const Block &block = _blocks[_current];
+
+            // the aligned position in this block
+            size_t start = (((uintptr_t)block.data + _used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - (uintptr_t)block.data;
+
+            // skip the block if the data does not fit
+            if (start + size > block.size) continue;
+
+            // the memory is now in use
+            _used = start + size;
+
+            // done
+            return block.data + start;
+        }
+
+        // we need a new block, big enough to hold the data even if it is not aligned well enough
+        size_t capacity = size + alignment > blocksize ? size + alignment : blocksize;
+
+        // allocate the block (this throws std::bad_alloc on failure)
+        char *data = (char *)::operator new(capacity);
+
+        // store the block
+        _blocks.push_back(Block{ data, capacity });
+
+        // allocate from this new block
+        return allocate(size, alignment);
+    }
+
+    /**
+     *  Release all memory that was handed out, the blocks are kept for reuse.
+     *  All pointers returned by allocate() become invalid.
+     */
+    void reset()
+    {
+        // start handing out memory from the first block
+        _current = 0;
+        _used = 0;
+    }
+
+    /**
+     *  Total number of bytes that the arena has allocated from the system
+     *  @return size_t
+     */
+    size_t capacity() const
+    {
+        // sum up all blocks
+        size_t result = 0;
+        for (const auto &block : _blocks) result += block.size;
+        return result;
+    }
+};
+
+/**
+ *  Allocator class that can be used by standard containers to allocate
+ *  from an arena. If no arena is set, the normal heap is used.
+ */
+template <typename T>
+class Allocator
+{
+private:
+    /**
+     *  The arena (or nullptr for the heap)
+     *  @var Arena
+     */
+    Arena *_arena;
+
+public:
+    /**
+     *  The type that is allocated
+     */
+    typedef T value_type;
+
+    /**
+     *  Constructor
+     *  @param  arena       the arena to allocate from, or nullptr for the heap
+     */
+    Allocator(Arena *arena = nullptr) noexcept : _arena(arena) {}
+
+    /**
+     *  Constructor based on an allocator for a different type
+     *  @param  that
+     */
+    template <typename U>
+    Allocator(const Allocator<U> &that) noexcept : _arena(that.arena()) {}
+
+    /**
+     *  The arena from which is allocated
+     *  @return Arena
+     */
+    Arena *arena() const { return _arena; }
+
+    /**
+     *  Allocate memory
+     *  @param  count       number of elements
+     *  @return T*
+     */
+    T *allocate(size_t count)
+    {
+        // use the arena if possible
+        if (_arena) return (T *)_arena->allocate(count * sizeof(T), alignof(T));
+
+        // otherwise use the heap
+        return (T *)::operator new(count * sizeof(T));
+    }
+
+    /**
+     *  Deallocate memory (memory from the arena is only released when the arena is reset)
+     *  @param  data        memory to deallocate
+     *  @param  count       number of elements (not used)
+     */
+    void deallocate(T *data, size_t)
+    {
+        // only heap memory has to be released
+        if (_arena == nullptr) ::operator delete(data);
+    }
+
+    /**
+     *  When a container is copied, the copy is allocated on the heap, and
+     *  does not depend on the lifetime of the arena
+     *  @return Allocator
+     */
+    Allocator select_on_container_copy_construction() const { return Allocator(); }
+
+    /**
+     *  Comparison operators
+     *  @param  that
+     *  @return bool
+     */
+    template <typename U>
+    bool operator==(const Allocator<U> &that) const { return _arena == that.arena(); }
+    template <typename U>
+    bool operator!=(const Allocator<U> &that) const { return _arena != that.arena(); }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -237,6 +237,14 @@ public:
      */
     size_t characters() const { return _buffer.bytes(); }
     
+    /**
+     *  Get access to a single character
+     *  Is is up to the caller to ensure that a valid index is supplied (inside the right range)
+     *  @param  index       position of the character
+     *  @return char
+     */
+    char operator[](size_t index) const { return _buffer.data()[index]; }
+    
     /**
      *  Find the substring
      *  @param  that        text to compare
@@ -288,7 +296,7 @@ public:
      */
     Ascii substr(size_t start, size_t size) const
     {
-        return Ascii(std::move(_buffer.part(start, size)));
+        return Ascii(_buffer.part(start, size));
     }
     
     /**
@@ -299,7 +307,7 @@ public:
      */
     Ascii substr(size_t start) const
     {
-        return Ascii(std::move(_buffer.part(start)));
+        return Ascii(_buffer.part(start));
     }
     
     /**
@@ -0,0 +1,335 @@
+/**
+ *  BatchDiff.h
+ *
+ *  Class to calculate the patches of many pairs of texts at once. The pairs
+ *  are divided into chunks that are handed over to a thread pool (or that
+ *  are processed one after the other if there is no pool). Each chunk reuses
+ *  its working memory for all its pairs, and all pairs share the same time
+ *  budget. The diffs of all patches are stored in one contiguous array.
+ *
+ *  Just like the diffs of a single patch, the diffs refer to the inputs, so
+ *  the array of pairs (and the texts in it) must stay in scope for as long
+ *  as the data of the diffs is accessed.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "arena.h"
+#include "ascii.h"
+#include "diff.h"
+#include "limits.h"
+#include "patch.h"
+#include "pool.h"
+#include "scratch.h"
+#include "stats.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t = Ascii>
+class BatchDiff
+{
+private:
+    /**
+     *  The pairs of texts (not a copy, the caller keeps them in scope)
+     *  @var std::pair
+     */
+    const std::pair<text_t, text_t> *_pairs;
+
+    /**
+     *  The diffs of all patches, one patch after the other
+     *  @var std::vector
+     */
+    std::vector<Diff> _diffs;
+
+    /**
+     *  Index in the diffs where each patch starts, followed by the total number of diffs
+     *  @var std::vector
+     */
+    std::vector<size_t> _offsets;
+
+    /**
+     *  Task to calculate the patches of a range of pairs
+     */
+    class Chunk : public Task
+    {
+    private:
+        /**
+         *  Object with limits / settings for the algorithm
+         *  @var Limits
+         */
+        const Limits &_limits;
+
+        /**
+         *  The pairs to process
+         *  @var std::pair
+         */
+        const std::pair<text_t, text_t> *_pairs;
+
+        /**
+         *  Number of pairs to process
+         *  @var size_t
+         */
+        size_t _count;
+
+        /**
+         *  Speedup flag
+         *  @var bool
+         */
+        bool _checklines;
+
+        /**
+         *  Time when the algorithm should stop
+         *  @var Deadline
+         */
+        const Deadline &_deadline;
+
+        /**
+         *  Where to store the number of diffs of each patch
+         *  @var size_t
+         */
+        size_t *_counts;
+
+        /**
+         *  The diffs of all patches of this chunk
+         *  @var std::vector
+         */
+        std::vector<Diff> _diffs;
+
+    protected:
+        /**
+         *  Calculate the patches
+         */
+        virtual void execute()
+        {
+            // working memory for all pairs
+            Arena arena;
+
+            // process all pairs
+            for (size_t i = 0; i < _count; ++i)
+            {
+                // the memory of the previous pair is no longer needed
+                arena.reset();
+
+                // working memory for this pair
+                Scratch scratch(arena, nullptr, _limits.stats);
+
+                // calculate the patch (the diffs are stored in the arena)
+                Patch<text_t> patch(_limits, _pairs[i].first, _pairs[i].second, _checklines, _deadline, scratch);
+
+                // run the optional cleanup passes
+                patch.cleanup(_limits);
+
+                // copy the diffs
+                _diffs.insert(_diffs.end(), patch._diffs.begin(), patch._diffs.end());
+                _counts[i] = patch._diffs.size();
+            }
+        }
+
+    public:
+        /**
+         *  Constructor
+         *  @param  limits      object with limits / settings for the algorithm
+         *  @param  pairs       the pairs to process
+         *  @param  count       number of pairs
+         *  @param  checklines  speedup flag
+         *  @param  deadline    time when the algorithm should stop
+         *  @param  counts      where to store the number of diffs of each patch
+         */
+        Chunk(const Limits &limits, const std::pair<text_t, text_t> *pairs, size_t count, bool checklines, const Deadline &deadline, size_t *counts) :
+            _limits(limits), _pairs(pairs), _count(count), _checklines(checklines), _deadline(deadline), _counts(counts) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Chunk() = default;
+
+        /**
+         *  The calculated diffs
+         *  @return std::vector
+         */
+        const std::vector<Diff> &diffs() const { return _diffs; }
+    };
+
+    /**
+     *  Calculate all patches
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  count       number of pairs
+     *  @param  checklines  speedup flag
+     *  @param  pool        optional thread pool
+     */
+    void calculate(const Limits &limits, size_t count, bool checklines, Pool *pool)
+    {
+        // room for the offsets (the number of diffs of each patch is stored at first)
+        _offsets.assign(count + 1, 0);
+
+        // the time budget that is shared by all pairs, and the bytes copied so far
+        Deadline deadline(limits.deadline());
+        size_t copying = Stats::copying();
+
+        // a couple of chunks per thread, so that the threads can steal work from each other
+        size_t chunks = pool ? std::min(count, pool->size() * 4) : 1;
+        if (chunks == 0) return;
+
+        // create the chunks
+        std::vector<std::unique_ptr<Chunk>> tasks;
+        for (size_t i = 0; i < chunks; ++i)
+        {
+            // the range of pairs
+            size_t first = count * i / chunks;
+            size_t last = count * (i + 1) / chunks;
+
+            // create the chunk
+            tasks.emplace_back(new Chunk(limits, _pairs + first, last - first, checklines, deadline, _offsets.data() + first + 1));
+        }
+
+        // without a pool, the only chunk runs in this thread
+        if (pool == nullptr) tasks[0]->run();
+
+        // otherwise it is handed over to the pool
+        else for (auto &task : tasks) pool->push(task.get());
+
+        // the first exception that was thrown
+        std::exception_ptr exception;
+
+        // wait for all tasks (also when one of them failed, because the tasks refer to our data)
+        for (auto &task : tasks)
+        {
+            // wait for the task
+            try { if (pool) pool->wait(task.get()); else task->join(); }
+
+            // remember the exception
+            catch (...) { if (!exception) exception = std::current_exception(); }
+        }
+
+        // pass on the exception
+        if (exception) std::rethrow_exception(exception);
+
+        // record the stats of the batch (they are not recorded for the single patches, because they share the deadline)
+        Patch<text_t>::finished(limits, deadline, copying);
+
+        // convert the counts into offsets
+        for (size_t i = 0; i < count; ++i) _offsets[i + 1] += _offsets[i];
+
+        // copy the diffs of all chunks into a single array
+        _diffs.reserve(_offsets[count]);
+        for (auto &task : tasks) _diffs.insert(_diffs.end(), task->diffs().begin(), task->diffs().end());
+    }
+
+public:
+    /**
+     *  Calculate the patches of many pairs in the current thread
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  pairs       the pairs of texts (base string and string to compare)
+     *  @param  count       number of pairs
+     *  @param  checklines  tuning flag
+     */
+    BatchDiff(const Limits &limits, const std::pair<text_t, text_t> *pairs, size_t count, bool checklines = true) : _pairs(pairs)
+    {
+        // run the algorithm
+        calculate(limits, count, checklines, nullptr);
+    }
+
+    /**
+     *  Calculate the patches of many pairs with a thread pool
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  pairs       the pairs of texts (base string and string to compare)
+     *  @param  count       number of pairs
+     *  @param  pool        the thread pool
+     *  @param  checklines  tuning flag
+     */
+    BatchDiff(const Limits &limits, const std::pair<text_t, text_t> *pairs, size_t count, Pool &pool, bool checklines = true) : _pairs(pairs)
+    {
+        // run the algorithm
+        calculate(limits, count, checklines, &pool);
+    }
+
+    /**
+     *  Constructors that take a vector of pairs
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  pairs       the pairs of texts
+     *  @param  pool        the thread pool
+     *  @param  checklines  tuning flag
+     */
+    BatchDiff(const Limits &limits, const std::vector<std::pair<text_t, text_t>> &pairs, bool checklines = true) :
+        BatchDiff(limits, pairs.data(), pairs.size(), checklines) {}
+    BatchDiff(const Limits &limits, const std::vector<std::pair<text_t, text_t>> &pairs, Pool &pool, bool checklines = true) :
+        BatchDiff(limits, pairs.data(), pairs.size(), pool, checklines) {}
+
+    /**
+     *  Batches can not be copied, because the diffs refer to the inputs
+     *  @param  that
+     */
+    BatchDiff(const BatchDiff &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~BatchDiff() = default;
+
+    /**
+     *  Number of patches (this is the same as the number of pairs)
+     *  @return size_t
+     */
+    size_t size() const { return _offsets.empty() ? 0 : _offsets.size() - 1; }
+
+    /**
+     *  Total number of diffs of all patches
+     *  @return size_t
+     */
+    size_t diffs() const { return _diffs.size(); }
+
+    /**
+     *  Iterate over the diffs of one of the patches
+     *  @param  index       index of the pair
+     *  @return const Diff*
+     */
+    const Diff *begin(size_t index) const { return _diffs.data() + _offsets[index]; }
+    const Diff *end(size_t index) const { return _diffs.data() + _offsets[index + 1]; }
+
+    /**
+     *  Get access to the data of a diff (a view on the original input)
+     *  @param  index       index of the pair to which the diff belongs
+     *  @param  diff        the diff
+     *  @return Buffer
+     */
+    Buffer buffer(size_t index, const Diff &diff) const
+    {
+        // inserted data comes from the second input, the rest from the first one
+        const text_t &input = diff.operation() == Operation::INSERT ? _pairs[index].second : _pairs[index].first;
+
+        // construct the view
+        return Buffer(input.buffer().data() + diff.offset(), diff.bytes(), false);
+    }
+
+    /**
+     *  Get access to the data of a diff as text
+     *  @param  index       index of the pair to which the diff belongs
+     *  @param  diff        the diff
+     *  @return text_t
+     */
+    text_t text(size_t index, const Diff &diff) const { return text_t(buffer(index, diff), false); }
+};
+
+/**
+ *  End of namespace
+ */
+}
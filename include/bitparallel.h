@@ -0,0 +1,293 @@
+/**
+ *  BitParallel.h
+ *
+ *  Class that calculates the longest common subsequence of two short texts
+ *  with the bit-vector algorithm of Allison-Dix and Hyyrö. Every character
+ *  of the first text is a bit, so a single 64-bit word holds 64 characters,
+ *  and every character of the second text costs one addition, subtraction
+ *  and a couple of logical operations per word. This takes O(N*M/64) time,
+ *  without the recursion and the bookkeeping of the middle snake search,
+ *  which is much faster for the short texts that it is used for.
+ *
+ *  The bit-vectors of all rows are stored, so that the edit script can be
+ *  found by walking back from the end of both texts. Because the longest
+ *  common subsequence is found, the edit script is as small as the one of
+ *  the Myers algorithm (it may only place the edits differently).
+ *
+ *  The first text may have at most 'maxsize' characters. The carries of the
+ *  additions run from one word to the next, so the words are processed one
+ *  after the other with ordinary 64-bit integers.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <vector>
+#include "arena.h"
+#include "operation.h"
+#include "scratch.h"
+#include "tokentable.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename char_t>
+class BitParallel
+{
+public:
+    /**
+     *  Max number of 64-bit words for the characters of the first text, and
+     *  the max number of characters of the first text
+     *  @var size_t
+     */
+    static const size_t maxwords = 4;
+    static const size_t maxsize = 64 * maxwords;
+
+private:
+    /**
+     *  Number of 64-bit words per row
+     *  @var size_t
+     */
+    size_t _words;
+
+    /**
+     *  Entry of each byte value plus one (zero for bytes that are not in the
+     *  first text), this is only used for texts of single bytes
+     *  @var uint16_t
+     */
+    uint16_t _bytes[256];
+
+    /**
+     *  The entries of the characters of the first text, for wider characters
+     *  @var TokenTable
+     */
+    TokenTable _table;
+
+    /**
+     *  The match masks: for each entry the words with a bit for every position
+     *  in the first text where the character occurs
+     *  @var std::vector
+     */
+    std::vector<uint64_t, Allocator<uint64_t>> _masks;
+
+    /**
+     *  The operations of the edit script and their number of characters (in reverse order)
+     *  @var std::vector
+     */
+    std::vector<Operation, Allocator<Operation>> _operations;
+    std::vector<uint32_t, Allocator<uint32_t>> _counts;
+
+    /**
+     *  Length of the longest common subsequence
+     *  @var size_t
+     */
+    size_t _length = 0;
+
+    /**
+     *  Get the entry of a character, a new entry is assigned if the character
+     *  was not seen before
+     *  @param  c
+     *  @return size_t
+     */
+    size_t insert(char c)
+    {
+        // the slot of the byte
+        uint16_t &slot = _bytes[(unsigned char)c];
+
+        // assign a new entry
+        if (slot == 0) slot = _masks.size() / _words + 1;
+
+        // done
+        return slot - 1;
+    }
+    size_t insert(uint32_t token) { return _table.insert(token); }
+
+    /**
+     *  Find the entry of a character
+     *  @param  c
+     *  @return ssize_t     the entry, or -1 if the character is not in the first text
+     */
+    ssize_t find(char c) const { return (ssize_t)_bytes[(unsigned char)c] - 1; }
+    ssize_t find(uint32_t token) const { return _table.find(token); }
+
+    /**
+     *  Number of zero bits in a row below a certain position (this is the
+     *  length of the common subsequence up to that position)
+     *  @param  row         the words of the row
+     *  @param  position    position in the first text
+     *  @return size_t
+     */
+    static size_t zeros(const uint64_t *row, size_t position)
+    {
+        // the result
+        size_t result = 0;
+
+        // the full words
+        for (size_t w = 0; w < position / 64; ++w) result += 64 - __builtin_popcountll(row[w]);
+
+        // the bits of the last word
+        if (position % 64 == 0) return result;
+
+        // only count the bits below the position
+        return result + position % 64 - __builtin_popcountll(row[position / 64] & ((1ULL << (position % 64)) - 1));
+    }
+
+    /**
+     *  Add an operation to the edit script (in reverse order)
+     *  @param  operation
+     */
+    void add(Operation operation)
+    {
+        // extend the previous operation if it is the same
+        if (!_operations.empty() && _operations.back() == operation) { ++_counts.back(); return; }
+
+        // start a new operation
+        _operations.push_back(operation);
+        _counts.push_back(1);
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  text1       characters of the first text (at most maxsize)
+     *  @param  size1       number of characters of the first text
+     *  @param  text2       characters of the second text
+     *  @param  size2       number of characters of the second text
+     *  @param  scratch     working memory
+     */
+    BitParallel(const char_t *text1, size_t size1, const char_t *text2, size_t size2, Scratch &scratch) :
+        _words((size1 + 63) / 64),
+        _table(sizeof(char_t) == 1 ? 0 : size1, &scratch.arena()),
+        _masks(Allocator<uint64_t>(&scratch.arena())),
+        _operations(Allocator<Operation>(&scratch.arena())),
+        _counts(Allocator<uint32_t>(&scratch.arena()))
+    {
+        // the table of bytes is only used for texts of bytes
+        if (sizeof(char_t) == 1) memset(_bytes, 0, sizeof(_bytes));
+
+        // build the match masks
+        for (size_t i = 0; i < size1; ++i)
+        {
+            // the entry of the character
+            size_t entry = insert(text1[i]);
+
+            // a new entry needs room
+            if (entry * _words == _masks.size()) _masks.resize(_masks.size() + _words, 0);
+
+            // set the bit of the position
+            _masks[entry * _words + i / 64] |= 1ULL << (i % 64);
+        }
+
+        // the rows of bit-vectors: a zero bit means that the common subsequence grows at that position
+        uint64_t *rows = scratch.bitvectors((size2 + 1) * _words);
+
+        // the row in front of the second text has no common subsequence
+        for (size_t w = 0; w < _words; ++w) rows[w] = ~0ULL;
+
+        // process the characters of the second text
+        for (size_t j = 0; j < size2; ++j)
+        {
+            // the previous row and the new row
+            const uint64_t *previous = rows + j * _words;
+            uint64_t *row = rows + (j + 1) * _words;
+
+            // the entry of the character
+            ssize_t entry = find(text2[j]);
+
+            // a character that does not appear in the first text changes nothing
+            if (entry < 0) { memcpy(row, previous, _words * sizeof(uint64_t)); continue; }
+
+            // the match mask of the character
+            const uint64_t *mask = _masks.data() + entry * _words;
+
+            // the carry of the addition and the borrow of the subtraction
+            uint64_t carry = 0, borrow = 0;
+
+            // process the words
+            for (size_t w = 0; w < _words; ++w)
+            {
+                // the matches that are not yet used
+                uint64_t v = previous[w], u = v & mask[w];
+
+                // the addition, with the carry of the previous word
+                uint64_t sum = v + u + carry;
+                carry = (sum < v || (carry && sum == v)) ? 1 : 0;
+
+                // the subtraction, with the borrow of the previous word
+                uint64_t difference = v - u - borrow;
+                borrow = (v < u || (borrow && v == u)) ? 1 : 0;
+
+                // the new bits
+                row[w] = sum | difference;
+            }
+        }
+
+        // the length of the common subsequence
+        _length = zeros(rows + size2 * _words, size1);
+
+        // walk back from the end of both texts
+        size_t i = size1, j = size2;
+        while (i > 0 && j > 0)
+        {
+            // common characters are part of the subsequence
+            if (text1[i - 1] == text2[j - 1]) { add(Operation::EQUAL); --i; --j; continue; }
+
+            // inserts are preferred at the end, so that deletes come first in the script (if the
+            // common subsequence is just as long without the character of the second text)
+            if (zeros(rows + (j - 1) * _words, i) == zeros(rows + j * _words, i)) { add(Operation::INSERT); --j; }
+
+            // otherwise the character of the first text is deleted
+            else { add(Operation::DELETE); --i; }
+        }
+
+        // the rest of the texts
+        while (j > 0) { add(Operation::INSERT); --j; }
+        while (i > 0) { add(Operation::DELETE); --i; }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~BitParallel() = default;
+
+    /**
+     *  Length of the longest common subsequence
+     *  @return size_t
+     */
+    size_t length() const { return _length; }
+
+    /**
+     *  Number of operations in the edit script
+     *  @return size_t
+     */
+    size_t size() const { return _operations.size(); }
+
+    /**
+     *  An operation of the edit script and its number of characters
+     *  @param  index       index of the operation
+     *  @return Operation
+     */
+    Operation operation(size_t index) const { return _operations[_operations.size() - 1 - index]; }
+    size_t count(size_t index) const { return _counts[_counts.size() - 1 - index]; }
+};
+
+/**
+ *  End of namespace
+ */
+}
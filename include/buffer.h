@@ -5,6 +5,16 @@
  *  the same as the buffer of characters (for utf8 for example, a char
  *  can be 1, 2, 3 or 4 bytes wide.
  *
+ *  A buffer is either a view on data that is owned by someone else, or it
+ *  refers to a block of storage that it allocated itself. The storage is
+ *  reference counted: copies and parts of a buffer share the storage of
+ *  the original, so copying a buffer or taking a part of it never copies
+ *  the data, also not if the buffer owns it. The data is only copied when
+ *  this is explicitly asked for (with the deepcopy flag), or when data is
+ *  added to a buffer whose storage is not big enough, or that does not end
+ *  where the used part of its storage ends (because a buffer that shares the
+ *  storage could still refer to the bytes behind it).
+ *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
  */
@@ -14,6 +24,16 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include "stats.h"
+
 /**
  *  Begin of namespace
  */
@@ -25,11 +45,49 @@ namespace DIFF {
 class Buffer
 {
 private:
+    /**
+     *  Header of a block of storage, the data follows right after it
+     */
+    struct Storage
+    {
+        /**
+         *  Number of buffers that refer to the storage
+         *  @var std::atomic
+         */
+        std::atomic<size_t> references;
+
+        /**
+         *  Number of bytes that fit in the storage
+         *  @var size_t
+         */
+        size_t capacity;
+
+        /**
+         *  Number of bytes at the start of the storage that are in use, data can
+         *  only be added in place at this end (other buffers may still refer to
+         *  the bytes behind a buffer that was made smaller)
+         *  @var std::atomic
+         */
+        std::atomic<size_t> used;
+
+        /**
+         *  Constructor
+         *  @param  capacity    number of bytes that fit in the storage
+         */
+        Storage(size_t capacity) : references(1), capacity(capacity), used(0) {}
+
+        /**
+         *  The data of the storage
+         *  @return char*
+         */
+        char *data() { return (char *)(this + 1); }
+    };
+
     /**
      *  The byte-string (not characters!)
-     *  @var void *
+     *  @var const char *
      */
-    char *_data;
+    const char *_data;
     
     /**
      *  Size of the byte-string
@@ -38,16 +96,77 @@ private:
     size_t _size;
     
     /**
-     *  Is the byte-buffer self-allocated?
-     *  @var bool
+     *  The storage that holds the data (nullptr if the data is owned by someone else)
+     *  @var Storage
      */
-    bool _allocated;
+    Storage *_storage;
+
+    /**
+     *  Stop referring to the storage, it is deallocated by the last buffer that refers to it
+     */
+    void release()
+    {
+        // is there storage, and was this the last reference?
+        if (_storage != nullptr && _storage->references.fetch_sub(1, std::memory_order_acq_rel) == 1) ::operator delete(_storage);
+
+        // no more storage
+        _storage = nullptr;
+    }
+
+    /**
+     *  Refer to the storage of an other buffer (the data and size are not changed)
+     *  @param  storage     the storage (or nullptr)
+     */
+    void share(Storage *storage)
+    {
+        // the new storage gets an extra reference first, so that sharing our own storage is safe
+        if (storage != nullptr) storage->references.fetch_add(1, std::memory_order_relaxed);
+
+        // forget the old storage
+        release();
+
+        // remember the new storage
+        _storage = storage;
+    }
+
+    /**
+     *  Allocate new storage for two blocks of data one after the other, and
+     *  store the copy in the buffer (the sources may be the old data)
+     *  @param  data1       first block of data
+     *  @param  size1       size of the first block
+     *  @param  data2       second block of data
+     *  @param  size2       size of the second block
+     *  @param  capacity    number of bytes to allocate (at least the size of both blocks)
+     */
+    void own(const char *data1, size_t size1, const char *data2, size_t size2, size_t capacity)
+    {
+        // empty buffers do not need storage
+        if (capacity == 0) { release(); _data = nullptr; _size = 0; return; }
+
+        // allocate the storage
+        void *memory = ::operator new(sizeof(Storage) + capacity);
+        Storage *storage = new (memory) Storage(capacity);
+
+        // copy the data (before the old storage is released, the data could be in there)
+        if (size1 > 0) memcpy(storage->data(), data1, size1);
+        if (size2 > 0) memcpy(storage->data() + size1, data2, size2);
+        storage->used = size1 + size2;
+
+        // count the copied bytes
+        Stats::copying(size1 + size2);
+
+        // replace the storage
+        release();
+        _storage = storage;
+        _data = storage->data();
+        _size = size1 + size2;
+    }
 
 public:
     /**
      *  Default constructor
      */
-    Buffer() : _data(nullptr), _size(0), _allocated(false) {}
+    Buffer() : _data(nullptr), _size(0), _storage(nullptr) {}
     
     /**
      *  Constructor
@@ -56,27 +175,34 @@ public:
      *  @param  deepcopy    should we make a deep-copy?
      */
     Buffer(const char *data, size_t size, bool deepcopy) :
-        _data(deepcopy ? (char *)malloc(size) : (char *)data),
+        _data(data),
         _size(size),
-        _allocated(deepcopy)
+        _storage(nullptr)
     {
         // make a deepcopy if necessary
-        if (deepcopy) memcpy(_data, data, size);
+        if (deepcopy) own(data, size, nullptr, 0, size);
     }
 
     /**
      *  Constructor based on other object
      *  @param  that        object to copy
-     *  @param  deepcopy    make a deep copy?
+     *  @param  deepcopy    make a deep copy? (otherwise the storage of the other buffer is shared)
      */
     Buffer(const Buffer &that, bool deepcopy) :
-        Buffer(that._data, that._size, deepcopy) {}
+        _data(that._data),
+        _size(that._size),
+        _storage(nullptr)
+    {
+        // copy the data, or share the storage
+        if (deepcopy) own(that._data, that._size, nullptr, 0, that._size);
+        else share(that._storage);
+    }
 
     /**
-     *  Copy constructor
+     *  Copy constructor, this shares the storage of the other buffer
      *  @param  that
      */
-    Buffer(const Buffer &that) : Buffer(that, that._allocated) {}
+    Buffer(const Buffer &that) : Buffer(that, false) {}
     
     /**
      *  Move constructor
@@ -85,11 +211,12 @@ public:
     Buffer(Buffer &&that) : 
         _data(that._data),
         _size(that._size),
-        _allocated(that._allocated)
+        _storage(that._storage)
     {
         // invalidate the other object
+        that._data = nullptr;
         that._size = 0;
-        that._allocated = false;
+        that._storage = nullptr;
     }
     
     /**
@@ -99,20 +226,26 @@ public:
      *  @param  end         end iterator
      */
     template <typename iter_t>
-    Buffer(size_t size, const iter_t &begin, const iter_t &end) :
-        _data(size > 0 ? (char *)malloc(size) : nullptr),
-        _size(0),
-        _allocated(size > 0)
+    Buffer(size_t size, const iter_t &begin, const iter_t &end) : Buffer()
     {
+        // allocate the storage
+        own(nullptr, 0, nullptr, 0, size);
+
         // iterate over the data
         for (auto iter = begin; iter != end; ++iter)
         {
             // append data
-            memcpy(_data + _size, iter->_data, iter->_size);
+            if (iter->_size > 0) memcpy(_storage->data() + _size, iter->_data, iter->_size);
             
             // update size
             _size += iter->_size;
         }
+
+        // the data is written
+        _storage->used = _size;
+
+        // count the copied bytes
+        Stats::copying(_size);
     }
     
     /**
@@ -121,9 +254,56 @@ public:
     virtual ~Buffer()
     {
         // deallocate
-        if (_allocated) free(_data);
+        release();
+    }
+
+    /**
+     *  Assignment operator, this shares the storage of the other buffer
+     *  @param  that
+     *  @return Buffer
+     */
+    Buffer &operator=(const Buffer &that)
+    {
+        // share the storage and the data
+        share(that._storage);
+        _data = that._data;
+        _size = that._size;
+
+        // allow chaining
+        return *this;
+    }
+
+    /**
+     *  Move assignment
+     *  @param  that
+     *  @return Buffer
+     */
+    Buffer &operator=(Buffer &&that)
+    {
+        // leap out on self-assignment
+        if (this == &that) return *this;
+
+        // take over the storage and the data
+        release();
+        _data = that._data;
+        _size = that._size;
+        _storage = that._storage;
+
+        // invalidate the other object
+        that._data = nullptr;
+        that._size = 0;
+        that._storage = nullptr;
+
+        // allow chaining
+        return *this;
     }
 
+    /**
+     *  Does the buffer own its data? (the storage may still be shared with other buffers)
+     *  @return bool
+     */
+    bool owned() const { return _storage != nullptr; }
+
     /**
      *  Get access to the underlying raw data
      *  @return const char *
@@ -143,32 +323,30 @@ public:
      */
     void append(const char *data, size_t size)
     {
-        // are we already allocated?
-        if (_allocated)
+        // nothing to do for empty data
+        if (size == 0) return;
+
+        // where our data ends in the storage
+        size_t end = _storage == nullptr ? 0 : _data + _size - _storage->data();
+
+        // the data can be added in place if there is room, and if our data ends where the used part of the storage
+        // ends (the bytes are claimed first, because buffers that share the storage could do the same in other threads)
+        if (_storage != nullptr && end + size <= _storage->capacity && _storage->used.compare_exchange_strong(end, end + size, std::memory_order_acq_rel))
         {
-            // reallocate
-            _data = (char *)realloc(_data, _size + size);
+            // copy the other data behind ours
+            memcpy(_storage->data() + end, data, size);
+
+            // count the copied bytes
+            Stats::copying(size);
+
+            // update total size
+            _size += size;
         }
         else
         {
-            // remember the old data
-            void *olddata = _data;
-            
-            // now allocate it
-            _data = (char *)malloc(_size + size);
-            
-            // copy the old data
-            if (_size > 0) memcpy(_data, olddata, _size);
-            
-            // data is now allocated
-            _allocated = true;
+            // new storage, with room to grow (so that appending over and over again is not quadratic)
+            own(_data, _size, data, size, std::max(_size + size, _size * 2));
         }
-        
-        // append the other data
-        memcpy(_data + _size, data, size);
-        
-        // update total size
-        _size += size;
     }
 
     /**
@@ -188,20 +366,11 @@ public:
      */
     void prepend(const char *data, size_t size)
     {
-        // allocate a brand new buffer
-        char *buffer = (char *)malloc(_size + size);
-        
-        // copy all data
-        memcpy(buffer, data, size);
-        memcpy(buffer + size, _data, _size);
-        
-        // get rid of the old buffer
-        if (_allocated) free(_data);
-        
-        // update status
-        _data = buffer;
-        _size += size;
-        _allocated = true;
+        // nothing to do for empty data
+        if (size == 0) return;
+
+        // copy all data to new storage
+        own(data, size, _data, _size, size + _size);
     }
         
     /**
@@ -222,74 +391,40 @@ public:
      */
     void assign(const char *data, size_t size, bool deepcopy)
     {
-        // should we allocate or reallocate?
-        if (_allocated)
-        {
-            // should we stay allocated?
-            if (deepcopy)
-            {
-                // we may have to reallocate
-                if (_size != size) _data = (char *)realloc(_data, size);
-
-                // copy the data
-                memcpy(_data, data, size);
-            }
-            else
-            {
-                // data no longer has to be allocated
-                free(_data);
-                
-                // assign data
-                _allocated = false;
-                _data = (char *)data;
-            }
-        }
-        else
-        {
-            // do we have to allocate?
-            if (deepcopy)
-            {
-                // allocate enough data
-                _allocated = true;
-                _data = (char *)malloc(size);
-                
-                // copy the data
-                memcpy(_data, data, size);
-            }
-            else
-            {
-                // we just have to assign data
-                _data = (char *)data;
-            }
-        }
+        // copy the data to new storage
+        if (deepcopy) return own(data, size, nullptr, 0, size);
 
-        // there is a new size
+        // the data is owned by someone else
+        release();
+        _data = data;
         _size = size;
     }
     
     /**
      *  Assign a different buffer
      *  @param  buffer      buffer to copy
-     *  @param  deepcopy    make a deep copy
+     *  @param  deepcopy    make a deep copy (otherwise the storage of the other buffer is shared)
      */
     void assign(const Buffer &that, bool deepcopy)
     {
-        // pass on
-        assign(that._data, that._size, deepcopy);
+        // copy the data, or share the buffer
+        if (deepcopy) own(that._data, that._size, nullptr, 0, that._size);
+        else *this = that;
     }
     
     /**
-     *  Make a deep copy
+     *  Assign a different buffer, this shares the storage of the other buffer
      *  @param  buffer
      */
     void assign(const Buffer &that)
     {
         // pass on
-        assign(that, that._allocated);
+        *this = that;
     }
     
     /**
-     *  Shrink a buffer from the end (make it smaller with a number of bytes)
+     *  Shrink a buffer from the end (make it smaller with a number of bytes),
+     *  the storage is kept, so this does not copy anything
      *  @param  size        number of bytes to shrink
      */
     void shrink(size_t size)
@@ -297,18 +432,13 @@ public:
         // if the buffer should be emptied
         if (size >= _size) return clear();
         
-        // if nothing changes
-        if (size == 0) return;
-    
-        // do we have an allocated buffer?
-        if (_allocated) _data = (char *)realloc(_data, _size - size);
-        
         // store the new size
         _size -= size;
     }
     
     /**
-     *  Shrink the buffer from the beginning
+     *  Shrink the buffer from the beginning, the storage is kept, so this
+     *  does not copy anything
      *  @param  size        number of bytes to shrink
      */
     void skip(size_t size)
@@ -316,22 +446,9 @@ public:
         // if everything is removed
         if (size >= _size) return clear();
 
-        // if nothing changes
-        if (size == 0) return;
-        
-        // create a new buffer
-        char *buffer = (char *)malloc(_size - size);
-        
-        // copy the old data
-        memcpy(buffer, _data + size, _size - size);
-        
-        // get rid of the old buffer
-        if (_allocated) free(_data);
-        
-        // update status
-        _data = buffer;
+        // move the start of the data
+        _data += size;
         _size -= size;
-        _allocated = true;
     }
     
     /**
@@ -340,10 +457,9 @@ public:
     void clear()
     {
         // deallocate
-        if (_allocated) free(_data);
+        release();
         
         // reset members
-        _allocated = false;
         _data = nullptr;
         _size = 0;
     }
@@ -371,8 +487,9 @@ public:
      */
     int compare(const Buffer &that) const
     {
-        // compare the prefix
-        int result = memcmp(_data, that._data, std::min(_size, that._size));
+        // compare the prefix (memcmp() may not be called for empty buffers, their data can be a nullptr)
+        size_t size = std::min(_size, that._size);
+        int result = size == 0 ? 0 : memcmp(_data, that._data, size);
         
         // the result is final if both strings have the same size, or if we 
         // already discovered that there is a difference between the strings
@@ -426,30 +543,37 @@ public:
     bool operator!=(const Buffer &that) const { return compare(that) != 0; }
 
     /**
-     *  Get a partial substring
+     *  Get a partial substring, this shares the storage (the data is not copied)
      *  @param  start       start position
+     *  @return Buffer
      */
     Buffer part(size_t start) const
     {
         // prevent out-of-range errors
         if (start >= _size) return Buffer();
         
-        // get the partial buffer
-        return Buffer(_data + start, _size - start, _allocated);
+        // get the partial buffer, it shares the storage
+        Buffer result(*this);
+        result.skip(start);
+        return result;
     }
     
     /**
-     *  Get a partial substring
+     *  Get a partial substring, this shares the storage (the data is not copied)
      *  @param  start       start position  
-     *  @param  size        size of the buffre
+     *  @param  size        size of the buffer
+     *  @return Buffer
      */
     Buffer part(size_t start, size_t size) const
     {
         // prevent out-of-range errors
         if (start >= _size || size == 0) return Buffer();
         
-        // get the partial buffer
-        return Buffer(_data + start, std::min(_size - start, size), _allocated);
+        // get the partial buffer, it shares the storage
+        Buffer result(*this);
+        result._data += start;
+        result._size = std::min(_size - start, size);
+        return result;
     }
 };
 
@@ -0,0 +1,423 @@
+/**
+ *  Cleanup.h
+ *
+ *  The optional cleanup passes that run over a complete patch. The semantic
+ *  cleanup makes a patch easier to read for humans, the efficiency cleanup
+ *  makes it cheaper to store and apply (both as in diff-match-patch). The
+ *  passes only decide which EQUAL operations should be dropped: the patch
+ *  normalizes itself with these flags, so that the dropped equalities are
+ *  merged into the edits around them. After the semantic cleanup, the
+ *  overlaps between deletions and insertions are turned into equalities.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "diff.h"
+#include "elements.h"
+#include "operation.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t>
+class Cleanup
+{
+private:
+    /**
+     *  The base input
+     *  @var text_t
+     */
+    const text_t &_input1;
+
+    /**
+     *  The input to compare
+     *  @var text_t
+     */
+    const text_t &_input2;
+
+    /**
+     *  Flags for the EQUAL operations that the last pass dropped
+     *  @var std::vector
+     */
+    std::vector<bool> _dropped;
+
+    /**
+     *  An EQUAL operation that may be dropped by the semantic cleanup
+     */
+    struct Equality
+    {
+        /**
+         *  Index of the diff
+         *  @var size_t
+         */
+        size_t index;
+
+        /**
+         *  Number of characters
+         *  @var size_t
+         */
+        size_t length;
+
+        /**
+         *  Number of inserted and deleted characters between the previous equality and this one
+         *  @var size_t
+         */
+        size_t inserted;
+        size_t deleted;
+    };
+
+    /**
+     *  Pointer to the data of a diff
+     *  @param  diff        the diff
+     *  @return const char *
+     */
+    const char *data(const Diff &diff) const
+    {
+        // inserted data comes from the second input, the rest from the first one
+        return (diff.operation() == Operation::INSERT ? _input2 : _input1).buffer().data() + diff.offset();
+    }
+
+    /**
+     *  The data of a diff as text
+     *  @param  diff        the diff
+     *  @return text_t
+     */
+    text_t text(const Diff &diff) const { return Elements<text_t>::substring(diff.operation() == Operation::INSERT ? _input2 : _input1, diff.offset(), diff.bytes()); }
+
+    /**
+     *  Number of characters in the data of a diff
+     *  @param  diff        the diff
+     *  @return size_t
+     */
+    size_t length(const Diff &diff) const { return Elements<text_t>::characters(diff.operation() == Operation::INSERT ? _input2 : _input1, diff.offset(), diff.bytes()); }
+
+    /**
+     *  Number of bytes at the end of the data of a diff that are repeated at the
+     *  start of the data of an other diff. After normalizing, the overlap is always
+     *  smaller than both diffs.
+     *  @param  diff1       the diff with the first text
+     *  @param  diff2       the diff with the second text
+     *  @return size_t
+     */
+    size_t overlapping(const Diff &diff1, const Diff &diff2) const
+    {
+        // only the parts that could overlap are compared
+        size_t size = std::min(diff1.bytes(), diff2.bytes());
+        const char *text1 = data(diff1) + diff1.bytes() - size;
+        const char *text2 = data(diff2);
+
+        // the second text, to check that the overlap does not split a character
+        text_t text(this->text(diff2));
+
+        // the longest overlap so far
+        size_t best = 0;
+
+        // look for longer and longer overlaps
+        for (size_t length = 1; length <= size; )
+        {
+            // look for the last bytes of the first text in the second text
+            const char *found = (const char *)memmem(text2, size, text1 + size - length, length);
+
+            // leap out if they do not appear, then there is no longer overlap either
+            if (found == nullptr) return best;
+
+            // an overlap can only start where these bytes were found
+            length += found - text2;
+
+            // check if this is an overlap
+            if (found == text2 || memcmp(text1 + size - length, text2, length) == 0)
+            {
+                // remember it, if it ends at the end of a character
+                if (Elements<text_t>::boundary(text, length) == length) best = length;
+
+                // look for a longer one
+                ++length;
+            }
+        }
+
+        // done
+        return best;
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  input1      the base input of the patch
+     *  @param  input2      the input to compare
+     */
+    Cleanup(const text_t &input1, const text_t &input2) : _input1(input1), _input2(input2) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Cleanup() = default;
+
+    /**
+     *  Semantic cleanup: equalities that are not bigger than the edits on both
+     *  sides of them are replaced by an edit. The equalities that could still
+     *  be dropped are kept on a stack, so that the one in front of a dropped
+     *  equality is checked again without scanning the diffs again. After the
+     *  patch is normalized, the overlaps are extracted with overlaps().
+     *  @param  diffs       the diffs of the patch
+     *  @return bool        were equalities dropped? (see dropped())
+     */
+    template <typename diffs_t>
+    bool semantic(const diffs_t &diffs)
+    {
+        // flags for the EQUAL operations that are dropped
+        _dropped.assign(diffs.size(), false);
+
+        // the equalities that could still be dropped
+        std::vector<Equality> equalities;
+
+        // number of characters that were inserted and deleted behind the last equality
+        size_t inserted = 0, deleted = 0;
+
+        // was anything dropped?
+        bool changed = false;
+
+        // go iterate
+        for (size_t i = 0; i < diffs.size(); ++i)
+        {
+            // the diff, and its size in characters
+            const Diff &diff = diffs[i];
+            size_t characters = length(diff);
+
+            // an EQUAL operation is a candidate, the counting restarts behind it
+            if (diff.operation() == Operation::EQUAL)
+            {
+                // remember the equality
+                equalities.push_back(Equality{ i, characters, inserted, deleted });
+
+                // restart counting
+                inserted = deleted = 0; continue;
+            }
+
+            // count the edit
+            if (diff.operation() == Operation::INSERT) inserted += characters; else deleted += characters;
+
+            // drop the last equality if the edits in front and behind it are at least as big
+            while (!equalities.empty())
+            {
+                // the last equality
+                const Equality &last = equalities.back();
+
+                // leap out if it is bigger than the edits on one of its sides
+                if (last.length > std::max(last.inserted, last.deleted) || last.length > std::max(inserted, deleted)) break;
+
+                // the equality becomes part of the edits, and the one in front of it is checked next
+                inserted += last.inserted + last.length;
+                deleted += last.deleted + last.length;
+
+                // drop it
+                _dropped[last.index] = changed = true;
+                equalities.pop_back();
+            }
+        }
+
+        // done
+        return changed;
+    }
+
+    /**
+     *  Efficiency cleanup, as in diff-match-patch: equalities shorter than the edit
+     *  cost are replaced by an edit when they are surrounded by insertions and
+     *  deletions on both sides, and equalities shorter than half the edit cost when
+     *  they are surrounded by three edits. A dropped equality is read as a deletion
+     *  followed by an insertion. When it was not surrounded on both sides, the pass
+     *  rewinds to the equality in front of it (or to the last safe position) and
+     *  checks that part again. This removes diffs that cost more to store than they
+     *  save.
+     *  @param  diffs       the diffs of the patch
+     *  @param  editcost    cost of an operation in characters
+     *  @return bool        were equalities dropped? (see dropped())
+     */
+    template <typename diffs_t>
+    bool efficiency(const diffs_t &diffs, size_t editcost)
+    {
+        // flags for the EQUAL operations that are dropped
+        _dropped.assign(diffs.size(), false);
+
+        // the indices of the equalities that could still be dropped
+        std::vector<size_t> equalities;
+
+        // is the last of these equalities still a candidate, and its number of characters
+        bool candidate = false;
+        size_t last = 0;
+
+        // were there insertions and deletions in front of and behind the last equality?
+        bool preinsert = false, predelete = false, postinsert = false, postdelete = false;
+
+        // the position where the pass restarts when there is no equality to fall back to
+        size_t safe = 0, safehalf = 0;
+
+        // was anything dropped?
+        bool changed = false;
+
+        // go iterate, a position is a diff plus the half of a dropped equality (0 for its deletion, 1 for its insertion)
+        for (size_t i = 0, half = 0; i < diffs.size(); )
+        {
+            // the diff, and the operation at this position
+            const Diff &diff = diffs[i];
+            Operation operation = !_dropped[i] ? diff.operation() : half == 0 ? Operation::DELETE : Operation::INSERT;
+
+            // check if this equality is a candidate
+            if (operation == Operation::EQUAL)
+            {
+                // the size of the equality
+                size_t characters = length(diff);
+
+                // short equalities behind an edit are candidates
+                if (characters < editcost && (postinsert || postdelete))
+                {
+                    // remember it, and the edits in front of it
+                    equalities.push_back(i);
+                    preinsert = postinsert; predelete = postdelete;
+                    candidate = true; last = characters;
+                }
+                else
+                {
+                    // a long equality protects the equalities in front of it
+                    equalities.clear(); candidate = false;
+                    safe = i; safehalf = 0;
+                }
+
+                // restart checking
+                postinsert = postdelete = false;
+            }
+            else
+            {
+                // remember the kind of edit
+                if (operation == Operation::INSERT) postinsert = true; else postdelete = true;
+
+                // is the last equality surrounded by insertions and deletions on both sides, or by three edits?
+                if (candidate && ((preinsert && predelete && postinsert && postdelete) || (last < editcost / 2 && preinsert + predelete + postinsert + postdelete == 3)))
+                {
+                    // drop it
+                    size_t index = equalities.back();
+                    _dropped[index] = changed = true;
+                    equalities.pop_back();
+                    candidate = false;
+
+                    // if there were insertions and deletions in front of it, the previous equalities are no longer affected
+                    if (preinsert && predelete)
+                    {
+                        // the pass continues behind the insertion of the dropped equality
+                        postinsert = postdelete = true;
+                        equalities.clear();
+                        i = safe = index; half = safehalf = 1;
+                    }
+                    else
+                    {
+                        // the previous equality has to be checked again
+                        if (!equalities.empty()) equalities.pop_back();
+
+                        // rewind to the equality in front of it, or to the last safe position
+                        if (equalities.empty()) { i = safe; half = safehalf; }
+                        else { i = equalities.back(); half = 0; }
+
+                        // process that position again
+                        postinsert = postdelete = false;
+                        continue;
+                    }
+                }
+            }
+
+            // the next position
+            if (_dropped[i] && half == 0) half = 1; else { ++i; half = 0; }
+        }
+
+        // done
+        return changed;
+    }
+
+    /**
+     *  Replace the overlap between a DELETE operation and the INSERT operation behind
+     *  it by an EQUAL operation, if the overlap is at least half as big as one of them
+     *  (e.g: <del>abcxxx</del><ins>xxxdef</ins> -> <del>abc</del>xxx<ins>def</ins>)
+     *  @param  diffs       the diffs of the normalized patch
+     */
+    template <typename diffs_t>
+    void overlaps(diffs_t &diffs) const
+    {
+        // the result (an overlap turns two operations into three)
+        diffs_t result(diffs.get_allocator());
+        result.reserve(diffs.size() + diffs.size() / 2 + 1);
+
+        // go iterate
+        for (size_t i = 0; i < diffs.size(); ++i)
+        {
+            // the diff
+            const Diff &diff = diffs[i];
+
+            // we need a deletion with an insertion behind it
+            if (diff.operation() != Operation::DELETE || i + 1 == diffs.size() || diffs[i + 1].operation() != Operation::INSERT) { result.push_back(diff); continue; }
+
+            // the insertion (it is processed together with the deletion)
+            const Diff &insert = diffs[++i];
+
+            // the overlaps in both directions
+            size_t overlap1 = overlapping(diff, insert);
+            size_t overlap2 = overlapping(insert, diff);
+
+            // does the deletion end with the start of the insertion?
+            if (overlap1 >= overlap2 && (overlap1 * 2 >= diff.bytes() || overlap1 * 2 >= insert.bytes()))
+            {
+                // the overlap is taken from the end of the deleted data
+                result.emplace_back(Operation::DELETE, diff.offset(), diff.bytes() - overlap1);
+                result.emplace_back(Operation::EQUAL, diff.offset() + diff.bytes() - overlap1, overlap1);
+                result.emplace_back(Operation::INSERT, insert.offset() + overlap1, insert.bytes() - overlap1);
+            }
+
+            // or does the insertion end with the start of the deletion?
+            else if (overlap2 > overlap1 && (overlap2 * 2 >= diff.bytes() || overlap2 * 2 >= insert.bytes()))
+            {
+                // the order is reversed, the overlap is taken from the start of the deleted data
+                result.emplace_back(Operation::INSERT, insert.offset(), insert.bytes() - overlap2);
+                result.emplace_back(Operation::EQUAL, diff.offset(), overlap2);
+                result.emplace_back(Operation::DELETE, diff.offset() + overlap2, diff.bytes() - overlap2);
+            }
+            else
+            {
+                // the operations are kept
+                result.push_back(diff);
+                result.push_back(insert);
+            }
+        }
+
+        // leap out if nothing changed
+        if (result.size() == diffs.size()) return;
+
+        // use the result
+        diffs.swap(result);
+    }
+
+    /**
+     *  Flags for the EQUAL operations that the last semantic() or efficiency()
+     *  call dropped, one for every diff that was passed to it
+     *  @return std::vector
+     */
+    const std::vector<bool> &dropped() const { return _dropped; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -3,6 +3,15 @@
  *
  *  Class that checks if one string is for the half equal to the other string.
  *
+ *  The positions of the seed in the short text come from a hash index, and
+ *  the match around every position is extended with a common prefix and
+ *  suffix. Positions inside the best match found so far are skipped (in
+ *  repetitive texts most positions are part of the same match), and at most
+ *  'maxextensions' positions are extended. The work per seed is therefore
+ *  at most O(maxextensions * n), instead of O(hits * n) for a seed that
+ *  appears very often in the short text. The best match may be missed when
+ *  more positions remain, but the half-match is a heuristic anyway.
+ *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
  */
@@ -12,6 +21,13 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include "commonprefix.h"
+#include "commonsuffix.h"
+#include "seedindex.h"
+
 /**
  *  Begin of namespace
  */
@@ -24,6 +40,12 @@ template <typename text_t>
 class CommonHalf
 {
 private:
+    /**
+     *  Max number of positions of the seed that are extended into a match
+     *  @var size_t
+     */
+    static const size_t maxextensions = 64;
+
     /**
      *  The long text
      *  @var text_t
@@ -65,31 +87,46 @@ public:
      *  Constructor that checks 
      *  @param  longtext        the long text
      *  @param  shorttext       the short text
-     *  @param  index           index of the quarter that is checked (this should be the 2nd or 3th quarter)
+     *  @param  index           position of the seed in the long text (this should be in the 2nd or 3th quarter)
+     *  @param  seeds           index of the substrings of the short text with the length of a seed
      */
-    CommonHalf(const text_t &longtext, const text_t &shorttext, size_t index) : 
+    CommonHalf(const text_t &longtext, const text_t &shorttext, size_t index, const SeedIndex<text_t> &seeds) : 
         _longtext(longtext), 
         _shorttext(shorttext),
         _start(index)
     {
         // start with a 1/4 length substring at position i as a seed.
-        auto seed = longtext.substr(index, longtext.characters() / 4);
-        
-        // look for the substring size
-        int pos = -1;
+        auto seed = longtext.substr(index, seeds.length());
+
+        // look for the first position of the seed
+        ssize_t pos = seeds.find(seed, 0, -1);
+
+        // the hash of the seed, to look up the other positions in the index
+        uint64_t hash = pos >= 0 ? seeds.hash(seed) : 0;
+
+        // number of positions that were extended so far
+        size_t extensions = 0;
 
         // look for the substring size
-        while ((pos = shorttext.find(seed, pos + 1)) >= 0)
+        for (; pos >= 0 && extensions < maxextensions; pos = seeds.find(seed, hash, pos))
         {
+            // positions inside the best match so far are skipped
+            if (characters() > 0 && (size_t)pos >= _substr - _suffix && (size_t)pos < _substr + _prefix) continue;
+
+            // one more position is extended
+            extensions += 1;
+
             // get the size of the shared prefix and suffix
             CommonPrefix<text_t> prefix(longtext.substr(index), shorttext.substr(pos));
             CommonSuffix<text_t> suffix(longtext.substr(0, index), shorttext.substr(0, pos));
             
             // proceed if we already have a better score
-            if (characters() > prefix.characters() + suffix.characters()) continue;
+            if (characters() >= prefix.characters() + suffix.characters()) continue;
             
             // we have a new best match
             _substr = pos;
+            _prefix = prefix.characters();
+            _suffix = suffix.characters();
         }
     }
 
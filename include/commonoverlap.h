@@ -12,6 +12,12 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include "buffer.h"
+#include "operation.h"
+
 /**
  *  Begin of namespace
  */
@@ -83,7 +89,7 @@ public:
      *  The suffix buffer (the non-overlapping part behind)
      *  @return Buffer
      */
-    Buffer suffix() const { return _longtext.buffer(_skip); }
+    Buffer suffix() const { return _longtext.buffer(_skip + _shorttext.characters()); }
     
     /**
      *  The part in middle that is overlapping
@@ -14,6 +14,15 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include <algorithm>
+#include "ascii.h"
+#include "tokens.h"
+#include "utf8.h"
+#include "mismatch.h"
+
 /**
  *  Begin of namespace
  */
@@ -36,46 +45,104 @@ private:
      *  Number of elements that the inputs have in common
      *  @var size_t
      */
-    size_t _size = 0;
-    
-public:
+    size_t _size;
+
     /**
-     *  Constructor to access inputs that map bytes to characters
+     *  Count the number of identical characters at the start of two inputs
      *  @param  input1
      *  @param  input2
+     *  @param  maxsize     max number of characters to compare
+     *  @return size_t
      */
-    CommonPrefix(const text_t &input1, const text_t &input2) : _input(input1)
+    template <typename input_t>
+    static size_t count(const input_t &input1, const input_t &input2, size_t maxsize)
     {
-        // the max-size
-        size_t maxsize = std::min(input1.characters(), input2.characters());
-        
+        // number of identical characters
+        size_t result = 0;
+
         // get iterators for the two inputs
         auto iter1 = input1.begin();
         auto iter2 = input2.begin();
         
         // check how many characters the strings have in common
-        while (_size < maxsize)
+        while (result < maxsize)
         {
             // leap out if there is a difference
-            if (*iter1 != *iter2) return;
+            if (*iter1 != *iter2) return result;
             
             // we found one more identical prefix character
-            ++_size;
+            ++result;
             
             // proceed the iterators
             ++iter1;
             ++iter2;
         }
+
+        // all characters were identical
+        return result;
     }
-    
+
     /**
-     *  Constructor to access raw byte buffers
+     *  Count the number of identical characters at the start of two inputs
+     *  that store one character per byte, this compares many bytes at once
      *  @param  input1
      *  @param  input2
+     *  @param  maxsize     max number of characters to compare
+     *  @return size_t
      */
-    CommonPrefix(const Diff &input1, const Diff &input2) : 
-        CommonPrefix(text_t(input1.data(), input1.bytes()), text_t(input2.data(), input2.bytes())) {}
+    static size_t count(const Ascii &input1, const Ascii &input2, size_t maxsize)
+    {
+        // compare the raw bytes
+        return Mismatch::forward(input1.buffer().data(), input2.buffer().data(), maxsize);
+    }
 
+    /**
+     *  Count the number of identical tokens at the start of two inputs, this
+     *  compares the raw bytes, the first different byte is part of the first
+     *  different token
+     *  @param  input1
+     *  @param  input2
+     *  @param  maxsize     max number of tokens to compare
+     *  @return size_t
+     */
+    static size_t count(const Tokens &input1, const Tokens &input2, size_t maxsize)
+    {
+        // compare the raw bytes
+        return Mismatch::forward(input1.buffer().data(), input2.buffer().data(), maxsize * sizeof(uint32_t)) / sizeof(uint32_t);
+    }
+
+    /**
+     *  Count the number of identical code points at the start of two utf8
+     *  inputs, this compares the raw bytes, and moves back to the start of
+     *  the sequence in which the first difference was found
+     *  @param  input1
+     *  @param  input2
+     *  @param  maxsize     max number of code points to compare (not used)
+     *  @return size_t
+     */
+    static size_t count(const Utf8 &input1, const Utf8 &input2, size_t)
+    {
+        // compare the raw bytes
+        const Buffer &buffer1 = input1.buffer(), &buffer2 = input2.buffer();
+        size_t bytes = Mismatch::forward(buffer1.data(), buffer2.data(), std::min(buffer1.bytes(), buffer2.bytes()));
+
+        // skip back over the continuation bytes of a partly identical sequence
+        while (bytes > 0 && bytes < buffer1.bytes() && ((unsigned char)buffer1.data()[bytes] & 0xc0) == 0x80) --bytes;
+
+        // convert to code points
+        return input1.character(bytes);
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  input1
+     *  @param  input2
+     */
+    CommonPrefix(const text_t &input1, const text_t &input2) :
+        _input(input1),
+        _size(count(input1, input2, std::min(input1.characters(), input2.characters()))) {}
+    
     /**
      *  Destructor
      */
@@ -14,6 +14,15 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include <algorithm>
+#include "ascii.h"
+#include "tokens.h"
+#include "utf8.h"
+#include "mismatch.h"
+
 /**
  *  Begin of namespace
  */
@@ -36,45 +45,105 @@ private:
      *  Number of elements that the inputs have in common
      *  @var size_t
      */
-    size_t _size = 0;
-    
-public:
+    size_t _size;
+
     /**
-     *  Constructor
+     *  Count the number of identical characters at the end of two inputs
      *  @param  input1
      *  @param  input2
+     *  @param  maxsize     max number of characters to compare
+     *  @return size_t
      */
-    CommonSuffix(const text_t &input1, const text_t &input2) : _input(input1)
+    template <typename input_t>
+    static size_t count(const input_t &input1, const input_t &input2, size_t maxsize)
     {
-        // the max-size
-        size_t maxsize = std::min(input1.characters(), input2.characters());
-        
+        // number of identical characters
+        size_t result = 0;
+
         // get iterators for the two inputs
         auto iter1 = input1.rbegin();
         auto iter2 = input2.rbegin();
         
         // check how many characters the strings have in common
-        while (_size < maxsize)
+        while (result < maxsize)
         {
             // leap out if there is a difference
-            if (*iter1 != *iter2) return;
+            if (*iter1 != *iter2) return result;
             
             // we found one more identical suffix character
-            ++_size;
+            ++result;
             
             // proceed the iterators
             ++iter1;
             ++iter2;
         }
+
+        // all characters were identical
+        return result;
+    }
+
+    /**
+     *  Count the number of identical characters at the end of two inputs
+     *  that store one character per byte, this compares many bytes at once
+     *  @param  input1
+     *  @param  input2
+     *  @param  maxsize     max number of characters to compare
+     *  @return size_t
+     */
+    static size_t count(const Ascii &input1, const Ascii &input2, size_t maxsize)
+    {
+        // compare the raw bytes, starting at the end
+        const Buffer &buffer1 = input1.buffer(), &buffer2 = input2.buffer();
+        return Mismatch::backward(buffer1.data() + buffer1.bytes(), buffer2.data() + buffer2.bytes(), maxsize);
     }
 
     /**
-     *  Constructor to access raw byte buffers
+     *  Count the number of identical tokens at the end of two inputs, this
+     *  compares the raw bytes, the last different byte is part of the last
+     *  different token
+     *  @param  input1
+     *  @param  input2
+     *  @param  maxsize     max number of tokens to compare
+     *  @return size_t
+     */
+    static size_t count(const Tokens &input1, const Tokens &input2, size_t maxsize)
+    {
+        // compare the raw bytes, starting at the end
+        const Buffer &buffer1 = input1.buffer(), &buffer2 = input2.buffer();
+        return Mismatch::backward(buffer1.data() + buffer1.bytes(), buffer2.data() + buffer2.bytes(), maxsize * sizeof(uint32_t)) / sizeof(uint32_t);
+    }
+
+    /**
+     *  Count the number of identical code points at the end of two utf8
+     *  inputs, this compares the raw bytes, and moves forward to the end of
+     *  the sequence in which the last difference was found
+     *  @param  input1
+     *  @param  input2
+     *  @param  maxsize     max number of code points to compare (not used)
+     *  @return size_t
+     */
+    static size_t count(const Utf8 &input1, const Utf8 &input2, size_t)
+    {
+        // compare the raw bytes, starting at the end
+        const Buffer &buffer1 = input1.buffer(), &buffer2 = input2.buffer();
+        size_t bytes = Mismatch::backward(buffer1.data() + buffer1.bytes(), buffer2.data() + buffer2.bytes(), std::min(buffer1.bytes(), buffer2.bytes()));
+
+        // skip the continuation bytes of a partly identical sequence
+        while (bytes > 0 && ((unsigned char)buffer1.data()[buffer1.bytes() - bytes] & 0xc0) == 0x80) --bytes;
+
+        // convert to code points
+        return input1.characters() - input1.character(buffer1.bytes() - bytes);
+    }
+
+public:
+    /**
+     *  Constructor
      *  @param  input1
      *  @param  input2
      */
-    CommonSuffix(const Diff &input1, const Diff &input2) : 
-        CommonSuffix(text_t(input1.data(), input1.bytes()), text_t(input2.data(), input2.bytes())) {}
+    CommonSuffix(const text_t &input1, const text_t &input2) :
+        _input(input1),
+        _size(count(input1, input2, std::min(input1.characters(), input2.characters()))) {}
 
     /**
      *  Destructor
@@ -0,0 +1,115 @@
+/**
+ *  Conflict.h
+ *
+ *  A conflict of a three-way merge: a range of the base text that was
+ *  changed in different ways by both sides. The conflict holds the byte
+ *  ranges in the base text and in both versions, and the offset in the
+ *  merged text where the range of our version was put in its place (so
+ *  that the caller can replace it with its own resolution).
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stddef.h>
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Conflict
+{
+private:
+    /**
+     *  Byte offset and number of bytes in the base text
+     *  @var size_t
+     */
+    size_t _base;
+    size_t _baselength;
+
+    /**
+     *  Byte offset and number of bytes in our version
+     *  @var size_t
+     */
+    size_t _ours;
+    size_t _ourslength;
+
+    /**
+     *  Byte offset and number of bytes in their version
+     *  @var size_t
+     */
+    size_t _theirs;
+    size_t _theirslength;
+
+    /**
+     *  Byte offset in the merged text (the range has the size of our version)
+     *  @var size_t
+     */
+    size_t _merged;
+
+public:
+    /**
+     *  Constructor
+     *  @param  base            byte offset in the base text
+     *  @param  baselength      number of bytes in the base text
+     *  @param  ours            byte offset in our version
+     *  @param  ourslength      number of bytes in our version
+     *  @param  theirs          byte offset in their version
+     *  @param  theirslength    number of bytes in their version
+     *  @param  merged          byte offset in the merged text
+     */
+    Conflict(size_t base, size_t baselength, size_t ours, size_t ourslength, size_t theirs, size_t theirslength, size_t merged) :
+        _base(base), _baselength(baselength),
+        _ours(ours), _ourslength(ourslength),
+        _theirs(theirs), _theirslength(theirslength),
+        _merged(merged) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Conflict() = default;
+
+    /**
+     *  Byte offset and number of bytes in the base text
+     *  @return size_t
+     */
+    size_t base() const { return _base; }
+    size_t baselength() const { return _baselength; }
+
+    /**
+     *  Byte offset and number of bytes in our version
+     *  @return size_t
+     */
+    size_t ours() const { return _ours; }
+    size_t ourslength() const { return _ourslength; }
+
+    /**
+     *  Byte offset and number of bytes in their version
+     *  @return size_t
+     */
+    size_t theirs() const { return _theirs; }
+    size_t theirslength() const { return _theirslength; }
+
+    /**
+     *  Byte offset in the merged text, where our version of the range is
+     *  @return size_t
+     */
+    size_t merged() const { return _merged; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -3,6 +3,14 @@
  *
  *  Class that checks if the deadline for the algorithm has already been reached
  *
+ *  The deadline is based on the monotonic clock, so it measures wall clock
+ *  time (and not cpu time), it is not affected when the system time changes,
+ *  and it works for sub-second budgets too. Reading the clock is cheap, but
+ *  not free, so the algorithms only call reached() once every couple of
+ *  thousand steps. Once the deadline has been reached, this is remembered
+ *  in an atomic flag, so that all threads that share the deadline switch to
+ *  the cheap (limited) search without having to read the clock again.
+ *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
  */
@@ -12,6 +20,12 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include <atomic>
+#include <chrono>
+
 /**
  *  Begin of namespace
  */
@@ -24,73 +38,104 @@ class Deadline
 {
 private:
     /**
-     *  Start time of the operation
-     *  @var clock_t
+     *  The clock that we use
      */
-    clock_t _start;
-    
+    typedef std::chrono::steady_clock clock;
+
+    /**
+     *  The time when the deadline expires
+     *  @var clock::time_point
+     */
+    clock::time_point _expire;
+
     /**
-     *  Number of seconds that the operation may take (0 for infinity)
-     *  @var time_t
+     *  Is there a deadline at all?
+     *  @var bool
      */
-    time_t _max;
+    bool _set;
 
+    /**
+     *  Has the deadline already been reached? (this is shared by all threads that use the deadline)
+     *  @var std::atomic
+     */
+    mutable std::atomic<bool> _reached;
 
 public:
     /**
      *  Default constructor creates an infinite deadline
      */
-    Deadline() : _start(clock()), _max(0) {}
-    
+    Deadline() : _set(false), _reached(false) {}
+
     /**
      *  Constructor to set a max
-     *  @param  seconds
+     *  @param  budget      the time that the operation may take
+     */
+    explicit Deadline(const clock::duration &budget) : _expire(clock::now() + budget), _set(true), _reached(false) {}
+
+    /**
+     *  Constructor to set a max in seconds (fractions are allowed, so 0.005 is 5 milliseconds)
+     *  @param  seconds     number of seconds, zero or less for an infinite deadline
      */
-    Deadline(time_t seconds) : _start(clock()), _max(seconds) {}
-    
+    explicit Deadline(double seconds) :
+        _expire(clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds))),
+        _set(seconds > 0),
+        _reached(false) {}
+
+    /**
+     *  Copy constructor
+     *  @param  that
+     */
+    Deadline(const Deadline &that) : _expire(that._expire), _set(that._set), _reached(that._reached.load(std::memory_order_relaxed)) {}
+
     /**
      *  Destructor
      */
     virtual ~Deadline() = default;
-    
+
     /**
      *  Is the deadline set? This is a cast-to-boolean operation
      *  @return bool
      */
-    operator bool () const { return _max > 0; }
-    bool operator! () const { return _max == 0; }
-    
+    operator bool () const { return _set; }
+    bool operator! () const { return !_set; }
+
     /**
-     *  What is the value of the deadline? Could be a wrapped value.
-     *  @return value
+     *  What is the value of the deadline?
+     *  @return clock::time_point
      */
-    clock_t expiration() const { return _start + _max * CLOCKS_PER_SEC; }
-    
+    clock::time_point expiration() const { return _expire; }
+
+    /**
+     *  Did an earlier call to reached() see that the deadline expired? This
+     *  does not check the clock
+     *  @return bool
+     */
+    bool expired() const { return _reached.load(std::memory_order_relaxed); }
+
     /**
      *  Have we reached the deadline?
      *  @return bool
      */
-    bool reached() const 
+    bool reached() const
     {
         // never reached if there is no max
-        if (_max == 0) return false;
-        
-        // get the current cpu time and the expire time
-        clock_t expire = expiration();
-        clock_t now = clock();
-        
-        // if the expire time has not wrapped, we expired if time is after
-        // the expire time, or when the time did wrap
-        if (expire > _start) return now >= expire || now < _start;
-        
-        // the expire time did wrap, so the start time must have wrapped too
-        return now > _start && now >= expire;
-    }
+        if (!_set) return false;
+
+        // if an other thread already saw that the deadline expired, we do not have to check the clock
+        if (_reached.load(std::memory_order_relaxed)) return true;
+
+        // check the clock
+        if (clock::now() < _expire) return false;
 
+        // remember that the deadline was reached
+        _reached.store(true, std::memory_order_relaxed);
+
+        // done
+        return true;
+    }
 };
 
 /**
  *  End of namespace
  */
 }
-
@@ -0,0 +1,336 @@
+/**
+ *  DeltaDecoder.h
+ *
+ *  Class that decodes a binary delta that was made by the DeltaEncoder.
+ *  The delta is not copied: the decoder reads straight from the buffer
+ *  (which could for example be a MappedFile), so the caller must keep it
+ *  in scope. The delta is validated once, when the decoder is constructed,
+ *  after that the diffs can be iterated and applied without any checks.
+ *
+ *  Just like the diffs of a patch, the offsets of equal and deleted diffs
+ *  refer to the original text. The offsets of inserted diffs refer to the
+ *  delta itself, because that is where the inserted data is stored.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <stdexcept>
+#include "buffer.h"
+#include "diff.h"
+#include "varint.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class DeltaDecoder
+{
+private:
+    /**
+     *  The delta (not a copy)
+     *  @var const char *
+     */
+    const char *_data;
+
+    /**
+     *  Size of the delta
+     *  @var size_t
+     */
+    size_t _size;
+
+    /**
+     *  Size of the original text and of the new text
+     *  @var size_t
+     */
+    size_t _bytes1 = 0;
+    size_t _bytes2 = 0;
+
+    /**
+     *  Offset of the first record in the delta
+     *  @var size_t
+     */
+    size_t _records = 0;
+
+    /**
+     *  Number of records
+     *  @var size_t
+     */
+    size_t _count = 0;
+
+    /**
+     *  Iterator over the diffs
+     */
+    class iterator
+    {
+    private:
+        /**
+         *  Start of the delta
+         *  @var const char *
+         */
+        const char *_data;
+
+        /**
+         *  The next record, and the end of the delta
+         *  @var const char *
+         */
+        const char *_next;
+        const char *_end;
+
+        /**
+         *  Position in the original text after the current diff
+         *  @var size_t
+         */
+        size_t _position = 0;
+
+        /**
+         *  The current diff (valid if the iterator is not at the end)
+         *  @var Diff
+         */
+        Diff _diff;
+
+        /**
+         *  Is the iterator at the end?
+         *  @var bool
+         */
+        bool _done = false;
+
+        /**
+         *  Decode the next record (the delta was already validated)
+         */
+        void decode()
+        {
+            // are we at the end?
+            if (_next == _end) { _done = true; return; }
+
+            // read the size and the operation
+            uint64_t value;
+            Varint::read(_next, _end, value);
+            Operation operation = (Operation)(value & 3);
+            size_t bytes = value >> 2;
+
+            // inserted data follows the record
+            if (operation == Operation::INSERT) { _diff = Diff(operation, _next - _data, bytes); _next += bytes; return; }
+
+            // other data comes from the original text
+            _diff = Diff(operation, _position, bytes);
+            _position += bytes;
+        }
+
+    public:
+        /**
+         *  Constructor
+         *  @param  data        start of the delta
+         *  @param  next        the first record
+         *  @param  end         end of the delta
+         */
+        iterator(const char *data, const char *next, const char *end) :
+            _data(data), _next(next), _end(end), _diff(Operation::EQUAL, 0, 0) { decode(); }
+
+        /**
+         *  Destructor
+         */
+        virtual ~iterator() = default;
+
+        /**
+         *  Compare with a different iterator
+         *  @param  that
+         */
+        bool operator==(const iterator &that) const { return _done == that._done && (_done || _next == that._next); }
+        bool operator!=(const iterator &that) const { return !operator==(that); }
+
+        /**
+         *  Dereference, get the diff
+         *  @return Diff
+         */
+        const Diff &operator*() const { return _diff; }
+        const Diff *operator->() const { return &_diff; }
+
+        /**
+         *  Move the iterator (implements ++iter)
+         *  @return iterator
+         */
+        const iterator &operator++()
+        {
+            // decode the next diff
+            decode();
+
+            // allow chaining
+            return *this;
+        }
+
+        /**
+         *  Move the iterator (implements iter++)
+         *  @return iterator
+         */
+        iterator operator++(int)
+        {
+            // move the iterator, but return the prev
+            iterator result(*this); ++*this; return result;
+        }
+    };
+
+    /**
+     *  Report a delta that is not valid
+     *  @throws std::invalid_argument
+     */
+    [[noreturn]] static void invalid()
+    {
+        // throw an exception
+        throw std::invalid_argument("invalid delta");
+    }
+
+public:
+    /**
+     *  Constructor, this validates the delta
+     *  @param  data        the delta
+     *  @param  size        size of the delta
+     *  @throws std::invalid_argument
+     */
+    DeltaDecoder(const char *data, size_t size) : _data(data), _size(size)
+    {
+        // the position and end of the delta
+        const char *position = data, *end = data + size;
+
+        // read the sizes of the texts
+        uint64_t bytes1, bytes2;
+        if (!Varint::read(position, end, bytes1) || !Varint::read(position, end, bytes2)) invalid();
+
+        // the records start here
+        _records = position - data;
+
+        // the sizes that are covered by the records
+        uint64_t covered1 = 0, covered2 = 0;
+
+        // check the records
+        while (position < end)
+        {
+            // read the record
+            uint64_t value;
+            if (!Varint::read(position, end, value)) invalid();
+
+            // the size and operation
+            uint64_t bytes = value >> 2;
+            Operation operation = (Operation)(value & 3);
+
+            // a record may not cover more than what is left of the texts (this is checked
+            // before the sizes are added, so that corrupt sizes can not make them wrap around)
+            bool first = operation == Operation::DELETE || operation == Operation::EQUAL;
+            bool second = operation == Operation::INSERT || operation == Operation::EQUAL;
+            if ((first && bytes > bytes1 - covered1) || (second && bytes > bytes2 - covered2)) invalid();
+
+            // update the administration
+            switch (operation) {
+            case Operation::INSERT:
+                if (bytes > uint64_t(end - position)) invalid();
+                position += bytes; covered2 += bytes;
+                break;
+            case Operation::DELETE:
+                covered1 += bytes;
+                break;
+            case Operation::EQUAL:
+                covered1 += bytes; covered2 += bytes;
+                break;
+            default:
+                invalid();
+            }
+
+            // one more record
+            _count += 1;
+        }
+
+        // the records must cover the texts exactly
+        if (covered1 != bytes1 || covered2 != bytes2) invalid();
+
+        // store the sizes
+        _bytes1 = bytes1;
+        _bytes2 = bytes2;
+    }
+
+    /**
+     *  Constructor
+     *  @param  buffer      the delta
+     *  @throws std::invalid_argument
+     */
+    explicit DeltaDecoder(const Buffer &buffer) : DeltaDecoder(buffer.data(), buffer.bytes()) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~DeltaDecoder() = default;
+
+    /**
+     *  Size of the original text and of the new text
+     *  @return size_t
+     */
+    size_t bytes1() const { return _bytes1; }
+    size_t bytes2() const { return _bytes2; }
+
+    /**
+     *  Number of diffs
+     *  @return size_t
+     */
+    size_t size() const { return _count; }
+
+    /**
+     *  Iterate over the diffs
+     *  @return iterator
+     */
+    iterator begin() const { return iterator(_data, _data + _records, _data + _size); }
+    iterator end() const { return iterator(_data, _data + _size, _data + _size); }
+
+    /**
+     *  Get access to the data of a diff
+     *  @param  diff        the diff
+     *  @param  source      the original text
+     *  @return Buffer
+     */
+    Buffer buffer(const Diff &diff, const char *source) const
+    {
+        // inserted data comes from the delta, the rest from the original text
+        return Buffer((diff.operation() == Operation::INSERT ? _data : source) + diff.offset(), diff.bytes(), false);
+    }
+
+    /**
+     *  Rebuild the new text
+     *  @param  source      the original text
+     *  @param  size        size of the original text
+     *  @param  target      where to write the new text (room for bytes2() bytes)
+     *  @throws std::invalid_argument   if the original text has the wrong size
+     */
+    void apply(const char *source, size_t size, char *target) const
+    {
+        // the delta only fits on a text with the right size
+        if (size != _bytes1) throw std::invalid_argument("delta does not match the text");
+
+        // copy the data of all diffs
+        for (const auto &diff : *this)
+        {
+            // deleted data is skipped
+            if (diff.operation() == Operation::DELETE) continue;
+
+            // copy the data
+            memcpy(target, (diff.operation() == Operation::INSERT ? _data : source) + diff.offset(), diff.bytes());
+            target += diff.bytes();
+        }
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,111 @@
+/**
+ *  DeltaEncoder.h
+ *
+ *  Class that encodes a patch into a compact binary delta. The delta holds
+ *  only the data that was inserted: unchanged data is copied from the
+ *  original text, and deleted data is skipped over. With the delta and the
+ *  original text, the new text can be rebuilt (see the DeltaDecoder class).
+ *
+ *  The delta starts with the sizes of the original text and of the new text,
+ *  followed by one record for each diff. A record starts with a varint that
+ *  holds the size of the diff, shifted two bits to the left, and the
+ *  operation in the lowest two bits. Records of inserts are followed by the
+ *  inserted bytes. All numbers are varints (see varint.h).
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <vector>
+#include "buffer.h"
+#include "patch.h"
+#include "varint.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class DeltaEncoder
+{
+private:
+    /**
+     *  The encoded delta
+     *  @var std::vector
+     */
+    std::vector<char> _data;
+
+public:
+    /**
+     *  Constructor
+     *  @param  patch       the patch to encode
+     */
+    template <typename text_t, typename char_t>
+    DeltaEncoder(const Patch<text_t, char_t> &patch)
+    {
+        // the max size of the delta: the header, the records, and the inserted data
+        size_t size = 2 * Varint::maxsize;
+        for (const auto &diff : patch) size += Varint::maxsize + (diff.operation() == Operation::INSERT ? diff.bytes() : 0);
+
+        // allocate it all at once
+        _data.resize(size);
+        char *output = _data.data();
+
+        // the sizes of the texts
+        output += Varint::write(output, patch.input1().bytes());
+        output += Varint::write(output, patch.input2().bytes());
+
+        // write the records
+        for (const auto &diff : patch)
+        {
+            // the size and the operation
+            output += Varint::write(output, uint64_t(diff.bytes()) << 2 | (uint64_t)diff.operation());
+
+            // inserted data is stored in the delta
+            if (diff.operation() != Operation::INSERT) continue;
+
+            // copy the data
+            memcpy(output, patch.input2().data() + diff.offset(), diff.bytes());
+            output += diff.bytes();
+        }
+
+        // the actual size
+        _data.resize(output - _data.data());
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~DeltaEncoder() = default;
+
+    /**
+     *  The encoded delta
+     *  @return Buffer      a view that is valid as long as this object exists
+     */
+    Buffer buffer() const { return Buffer(_data.data(), _data.size(), false); }
+
+    /**
+     *  The encoded data and its size
+     *  @return const char *
+     *  @return size_t
+     */
+    const char *data() const { return _data.data(); }
+    size_t bytes() const { return _data.size(); }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,193 @@
+/**
+ *  Dictionary.h
+ *
+ *  Hash table that assigns a unique number to each distinct byte sequence
+ *  (for example: to each distinct line in a text). The table uses open
+ *  addressing with linear probing, and it does not copy the byte sequences:
+ *  the keys are views on the original buffers, so these buffers should stay
+ *  in scope for as long as the dictionary is used.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <vector>
+#include "buffer.h"
+#include "arena.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Dictionary
+{
+private:
+    /**
+     *  The slots of the hash table, holding the token + 1 (zero for empty slots)
+     *  @var std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> _slots;
+
+    /**
+     *  The keys, indexed by token
+     *  @var std::vector
+     */
+    std::vector<Buffer, Allocator<Buffer>> _keys;
+
+    /**
+     *  The hashes of the keys, indexed by token
+     *  @var std::vector
+     */
+    std::vector<size_t, Allocator<size_t>> _hashes;
+
+    /**
+     *  Calculate the hash of a byte sequence (FNV-1a)
+     *  @param  data        the bytes
+     *  @param  size        number of bytes
+     *  @return size_t
+     */
+    static size_t hash(const char *data, size_t size)
+    {
+        // start with the offset basis
+        uint64_t result = 14695981039346656037ULL;
+
+        // process all bytes
+        for (size_t i = 0; i < size; ++i) result = (result ^ (unsigned char)data[i]) * 1099511628211ULL;
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Find the slot for a certain hash and key
+     *  @param  hash        the hash
+     *  @param  data        the bytes
+     *  @param  size        number of bytes
+     *  @return size_t      index of the slot, which is either empty or holds the key
+     */
+    size_t slot(size_t hash, const char *data, size_t size) const
+    {
+        // the capacity is a power of two
+        size_t mask = _slots.size() - 1;
+
+        // walk over the slots
+        for (size_t index = hash & mask; true; index = (index + 1) & mask)
+        {
+            // an empty slot ends the search
+            if (_slots[index] == 0) return index;
+
+            // the token stored in this slot
+            uint32_t token = _slots[index] - 1;
+
+            // do the keys match?
+            if (_hashes[token] == hash && _keys[token].bytes() == size && memcmp(_keys[token].data(), data, size) == 0) return index;
+        }
+    }
+
+    /**
+     *  Double the capacity of the hash table
+     */
+    void grow()
+    {
+        // the new capacity
+        size_t capacity = std::max(_slots.size() * 2, (size_t)1024);
+
+        // empty all slots
+        _slots.assign(capacity, 0);
+
+        // size of the mask
+        size_t mask = capacity - 1;
+
+        // insert all keys again
+        for (uint32_t token = 0; token < _keys.size(); ++token)
+        {
+            // find an empty slot
+            size_t index = _hashes[token] & mask;
+            while (_slots[index] != 0) index = (index + 1) & mask;
+
+            // store the token
+            _slots[index] = token + 1;
+        }
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  arena       arena to allocate from (nullptr for the heap)
+     */
+    Dictionary(Arena *arena = nullptr) :
+        _slots(Allocator<uint32_t>(arena)),
+        _keys(Allocator<Buffer>(arena)),
+        _hashes(Allocator<size_t>(arena)) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Dictionary() = default;
+
+    /**
+     *  Number of distinct keys in the dictionary
+     *  @return size_t
+     */
+    size_t size() const { return _keys.size(); }
+
+    /**
+     *  Remove all keys, the allocated memory is kept so that it can be reused
+     */
+    void clear()
+    {
+        // forget all keys
+        std::fill(_slots.begin(), _slots.end(), 0);
+        _keys.clear();
+        _hashes.clear();
+    }
+
+    /**
+     *  Get the token for a byte sequence, a new token is assigned if the
+     *  sequence was not seen before
+     *  @param  data        the bytes
+     *  @param  size        number of bytes
+     *  @return uint32_t
+     */
+    uint32_t intern(const char *data, size_t size)
+    {
+        // keep the load factor under 50%
+        if (_keys.size() * 2 >= _slots.size()) grow();
+
+        // calculate the hash, and find the slot
+        size_t hash = Dictionary::hash(data, size);
+        size_t index = slot(hash, data, size);
+
+        // is the key already known?
+        if (_slots[index] != 0) return _slots[index] - 1;
+
+        // the new token
+        uint32_t token = _keys.size();
+
+        // store the key (not a copy, but a view on the original data)
+        _keys.emplace_back(data, size, false);
+        _hashes.push_back(hash);
+        _slots[index] = token + 1;
+
+        // done
+        return token;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
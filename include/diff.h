@@ -1,8 +1,14 @@
 /**
  *  Diff.h
  *
- *  A patch is implemented as a list of diffs. Each diff holds a 
- *  INSERT, DELETE or EQUAL operation
+ *  A patch is implemented as a list of diffs. Each diff holds a
+ *  INSERT, DELETE or EQUAL operation. The diff does not hold the data
+ *  itself, but refers to a range of bytes in one of the inputs of the
+ *  patch: EQUAL and DELETE operations refer to the first input, INSERT
+ *  operations to the second input.
+ *
+ *  The patch stores its diffs by value in a contiguous array, that is why
+ *  this class is kept small and trivially copyable.
  *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
@@ -16,8 +22,8 @@
 /**
  *  Dependencies
  */
+#include <stddef.h>
 #include "operation.h"
-#include "buffer.h"
 
 /**
  *  Begin of namespace
@@ -27,99 +33,82 @@ namespace DIFF {
 /**
  *  Class definition
  */
-class Diff : public Buffer
+class Diff
 {
 private:
     /**
-     *  The operation
-     *  @var Operation
+     *  Byte offset in the input that holds the data
+     *  @var size_t
      */
-    Operation _operation;
-    
+    size_t _offset;
 
-public:
     /**
-     *  Constructor for an empty buffer
-     *  @param  operation   the operation
+     *  Number of bytes
+     *  @var size_t
      */
-    Diff(const Operation &operation) : _operation(operation) {}
+    size_t _size;
 
     /**
-     *  Constructor to wrap around a buffer
-     *  @param  operation   the operation
-     *  @param  buffer      buffer to copy
+     *  The operation
+     *  @var Operation
      */
-    Diff(const Operation &operation, const Buffer &buffer) :
-        Buffer(buffer), _operation(operation) {}
+    Operation _operation;
 
+public:
     /**
-     *  Constructor to wrap around a buffer by moving the buffer
+     *  Constructor
      *  @param  operation   the operation
-     *  @param  buffer      buffer to move
+     *  @param  offset      byte offset in the input
+     *  @param  size        number of bytes
      */
-    Diff(const Operation &operation, Buffer &&buffer) :
-        Buffer(std::move(buffer)), _operation(operation) {}
+    Diff(const Operation &operation, size_t offset, size_t size) :
+        _offset(offset), _size(size), _operation(operation) {}
 
     /**
-     *  Constructor to construct based on a list of other buffers
-     *  @param  operation   the operation
-     *  @param  size        total size
-     *  @param  begin       start iterator
-     *  @param  end         end iterator
+     *  Expose the operation
+     *  @return Operation
      */
-    template <typename iter_t>
-    Diff(const Operation &operation, size_t size, const iter_t &begin, const iter_t &end) :
-        Buffer(size, begin, end), _operation(operation) {}
-        
+    const Operation &operation() const { return _operation; }
+
     /**
-     *  Copy constructor
-     *  @param  that
+     *  Byte offset in the input (the first input for EQUAL and DELETE
+     *  operations, the second input for INSERT operations)
+     *  @return size_t
      */
-    Diff(const Diff &that) :
-        Buffer(that), _operation(that._operation) {}
-    
+    size_t offset() const { return _offset; }
+
     /**
-     *  Move constructor
-     *  @param  that
+     *  Number of bytes
+     *  @return size_t
      */
-    Diff(Diff &&that) :
-        Buffer(std::move(that)), _operation(that._operation) {}
-        
+    size_t bytes() const { return _size; }
+
     /**
-     *  Destructor
+     *  Grow the range at the end
+     *  @param  size        number of bytes
      */
-    virtual ~Diff() = default;
-    
+    void append(size_t size) { _size += size; }
+
     /**
-     *  Expose the operation
-     *  @return Operation
+     *  Grow the range at the front
+     *  @param  size        number of bytes
      */
-    const Operation &operation() const { return _operation; }
+    void prepend(size_t size) { _offset -= size; _size += size; }
 
     /**
-     *  Get a partial substring
-     *  @param  start       start position
+     *  Shrink the range from the end
+     *  @param  size        number of bytes
      */
-    Diff part(size_t start) const
-    {
-        // call base operation
-        return Diff(_operation, std::move(Buffer::part(start)));
-    }
-    
+    void shrink(size_t size) { _size -= size; }
+
     /**
-     *  Get a partial substring
-     *  @param  start       start position  
-     *  @param  size        size of the buffre
+     *  Shrink the range from the beginning
+     *  @param  size        number of bytes
      */
-    Diff part(size_t start, size_t size) const
-    {
-        // call base operation
-        return Diff(_operation, std::move(Buffer::part(start, size)));
-    }
+    void skip(size_t size) { _offset += size; _size -= size; }
 };
 
 /**
  *  End of namespace
  */
 }
-
@@ -0,0 +1,168 @@
+/**
+ *  DiffEngine.h
+ *
+ *  Long-lived object to calculate many patches one after the other. The
+ *  engine holds the settings and the arena with all working memory (the
+ *  V-arrays of the bisect algorithm, the line dictionary, the diffs of the
+ *  sub-patches, etc). The arena is reset before each diff, but its memory
+ *  is kept, so once the engine has grown to its working size, the only
+ *  allocation that is left is the array with the diffs of the result.
+ *
+ *  An engine can not be used by multiple threads at the same time: use an
+ *  engine per thread instead.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "arena.h"
+#include "ascii.h"
+#include "fingerprint.h"
+#include "limits.h"
+#include "metrics.h"
+#include "patch.h"
+#include "pool.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t = Ascii>
+class DiffEngine
+{
+private:
+    /**
+     *  Limits / settings for the algorithm
+     *  @var Limits
+     */
+    Limits _limits;
+
+    /**
+     *  Arena with the working memory
+     *  @var Arena
+     */
+    Arena _arena;
+
+    /**
+     *  Optional thread pool to calculate big sub-problems in parallel
+     *  @var Pool
+     */
+    Pool *_pool;
+
+public:
+    /**
+     *  Constructor
+     *  @param  limits      limits / settings for the algorithm
+     *  @param  pool        optional thread pool
+     */
+    DiffEngine(const Limits &limits = Limits(), Pool *pool = nullptr) : _limits(limits), _pool(pool) {}
+
+    /**
+     *  Engines can not be copied
+     *  @param  that
+     */
+    DiffEngine(const DiffEngine &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~DiffEngine() = default;
+
+    /**
+     *  The limits / settings, these can be changed between diffs
+     *  @return Limits
+     */
+    Limits &limits() { return _limits; }
+    const Limits &limits() const { return _limits; }
+
+    /**
+     *  Number of bytes of working memory that the engine holds
+     *  @return size_t
+     */
+    size_t capacity() const { return _arena.capacity(); }
+
+    /**
+     *  Calculate the patch to transform one string into an other string
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  tuning flag
+     *  @return Patch
+     */
+    Patch<text_t> diff(const text_t &input1, const text_t &input2, bool checklines = true)
+    {
+        // the memory of the previous diff is no longer needed
+        _arena.reset();
+
+        // construct the patch, and run the algorithm with our working memory
+        Patch<text_t> result(input1, input2);
+        result.calculate(_limits, input1, input2, checklines, _arena, _pool);
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Calculate the metrics of two strings (the numbers of a patch, without storing the patch itself)
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  tuning flag
+     *  @return Metrics
+     */
+    Metrics metrics(const text_t &input1, const text_t &input2, bool checklines = true)
+    {
+        // the memory of the previous diff is no longer needed
+        _arena.reset();
+
+        // run the algorithm with our working memory
+        Metrics result;
+        result.calculate(_limits, input1, input2, checklines, _arena, _pool);
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Calculate the patch with the fingerprints of the inputs, unrelated texts
+     *  are then replaced as a whole without running the algorithm
+     *  @param  input1      the base string
+     *  @param  fingerprint1    fingerprint of the base string
+     *  @param  input2      the string to compare
+     *  @param  fingerprint2    fingerprint of the string to compare
+     *  @param  checklines  tuning flag
+     *  @return Patch
+     */
+    Patch<text_t> diff(const text_t &input1, const Fingerprint &fingerprint1, const text_t &input2, const Fingerprint &fingerprint2, bool checklines = true)
+    {
+        // construct the patch
+        Patch<text_t> result(input1, input2);
+
+        // leap out if the fingerprints are enough
+        if (result.prescreen(_limits, input1, input2, fingerprint1, fingerprint2)) return result;
+
+        // the memory of the previous diff is no longer needed
+        _arena.reset();
+
+        // run the algorithm with our working memory
+        result.calculate(_limits, input1, input2, checklines, _arena, _pool);
+
+        // done
+        return result;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
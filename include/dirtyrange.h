@@ -0,0 +1,178 @@
+/**
+ *  DirtyRange.h
+ *
+ *  The part of a patch that has to be recalculated after a small edit of
+ *  the second input. The range covers the edit plus some context on both
+ *  sides, and it is widened until both ends fall inside an EQUAL operation,
+ *  so that the diffs before and after it can be taken from the patch before
+ *  the edit. An EQUAL operation at an end of the range is cut in two: the
+ *  part outside the range is kept, the part inside it is recalculated.
+ *
+ *  All offsets are byte offsets. Those in the first input and in the second
+ *  input before the edit are measured in the patch before the edit, the end
+ *  of the range in the second input after the edit is given by end2().
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <algorithm>
+#include "diff.h"
+#include "elements.h"
+#include "operation.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t>
+class DirtyRange
+{
+private:
+    /**
+     *  The last equal diff that starts before the range (the number of diffs if there is none), and the number of its bytes that are kept
+     *  @var size_t
+     */
+    size_t _last;
+    size_t _cut = 0;
+
+    /**
+     *  The first equal diff that ends after the range (the number of diffs if there is none), and the number of its bytes inside the range
+     *  @var size_t
+     */
+    size_t _first;
+    size_t _resume = 0;
+
+    /**
+     *  Start of the range in the first and second input
+     *  @var size_t
+     */
+    size_t _begin1 = 0;
+    size_t _begin2 = 0;
+
+    /**
+     *  End of the range in the first input, and in the second input before the edit
+     *  @var size_t
+     */
+    size_t _end1;
+    size_t _end2;
+
+    /**
+     *  Number of bytes that were removed from the second input, and inserted instead
+     *  @var size_t
+     */
+    size_t _removed;
+    size_t _inserted;
+
+public:
+    /**
+     *  Constructor, this walks over the diffs before the edit
+     *  @param  diffs       the diffs of the patch before the edit
+     *  @param  input2      the second input after the edit
+     *  @param  size1       number of bytes of the first input
+     *  @param  size2       number of bytes of the second input before the edit
+     *  @param  offset      byte offset of the edit in the second input
+     *  @param  removed     number of bytes that were removed from the second input
+     *  @param  inserted    number of bytes that were inserted instead
+     *  @param  context     number of bytes around the edit that are recalculated too
+     */
+    template <typename diffs_t>
+    DirtyRange(const diffs_t &diffs, const text_t &input2, size_t size1, size_t size2, size_t offset, size_t removed, size_t inserted, size_t context) :
+        _last(diffs.size()), _first(diffs.size()), _end1(size1), _end2(size2), _removed(removed), _inserted(inserted)
+    {
+        // the dirty range in the second input before the edit, including the context
+        size_t low = offset - std::min(offset, context);
+        size_t high = offset + removed + context;
+
+        // the positions in both inputs at the start of each diff
+        size_t position1 = 0, position2 = 0;
+
+        // walk over the diffs
+        for (size_t i = 0; i < diffs.size(); ++i)
+        {
+            // the diff and its size
+            const Diff &diff = diffs[i];
+            size_t bytes = diff.bytes();
+
+            // equal diffs are the places where the patch can be cut
+            if (diff.operation() == Operation::EQUAL)
+            {
+                // can the diff be cut before the dirty range? (the prefix must end with equal data)
+                size_t before = Elements<text_t>::boundary(input2, std::min(position2 + bytes, low));
+                if (position2 < low && before > position2) _last = i, _begin1 = position1 + before - position2, _begin2 = before, _cut = before - position2;
+
+                // can the diff be cut after the dirty range? (this is measured before the edit)
+                if (position2 + bytes > high)
+                {
+                    // the start of the suffix after the edit, moved to the start of a character
+                    size_t after = Elements<text_t>::boundary(input2, high - removed + inserted) + removed - inserted;
+
+                    // the suffix may not start inside the edit or before the diff
+                    after = std::max(after, std::max(position2, offset + removed));
+
+                    // this is where the suffix starts
+                    _first = i; _end1 = position1 + after - position2; _end2 = after; _resume = after - position2;
+                    break;
+                }
+            }
+
+            // update the positions
+            if (diff.operation() != Operation::INSERT) position1 += bytes;
+            if (diff.operation() != Operation::DELETE) position2 += bytes;
+        }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~DirtyRange() = default;
+
+    /**
+     *  The diffs in front of the range: the diffs before last() are kept, and
+     *  cut() bytes of the equal diff last() (nothing is kept if last() is the
+     *  number of diffs)
+     *  @return size_t
+     */
+    size_t last() const { return _last; }
+    size_t cut() const { return _cut; }
+
+    /**
+     *  The diffs after the range: the equal diff first() is kept without its
+     *  first resume() bytes, and the diffs after it are kept (nothing is kept
+     *  if first() is the number of diffs)
+     *  @return size_t
+     */
+    size_t first() const { return _first; }
+    size_t resume() const { return _resume; }
+
+    /**
+     *  The range in the first input
+     *  @return size_t
+     */
+    size_t begin1() const { return _begin1; }
+    size_t end1() const { return _end1; }
+
+    /**
+     *  The range in the second input after the edit
+     *  @return size_t
+     */
+    size_t begin2() const { return _begin2; }
+    size_t end2() const { return _end2 - _removed + _inserted; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,189 @@
+/**
+ *  Elements.h
+ *
+ *  Traits that tell how the characters of a text type are stored. Text
+ *  types with fixed-width characters expose them as a contiguous array,
+ *  so that the middle snake search can compare the elements directly. The
+ *  search is instantiated once for each element type: bytes for ascii text,
+ *  32-bit values for tokens (like the lines in line mode). A text type with
+ *  16-bit units only needs a specialization with 'uint16_t' as its type.
+ *
+ *  Utf8 text does not have fixed-width characters, it is decoded into an
+ *  array of 32-bit code points first, so it does not expose an array.
+ *
+ *  The diffs of a patch hold byte offsets. The traits also convert these
+ *  to characters: they move an offset back to the start of a character,
+ *  take the part of a text between two offsets, and count the characters
+ *  in between. For utf8 the index of the text is used for both.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include "ascii.h"
+#include "tokens.h"
+#include "utf8.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition, only the specializations are defined
+ */
+template <typename text_t>
+struct Elements;
+
+/**
+ *  Ascii text is an array of bytes
+ */
+template <>
+struct Elements<Ascii>
+{
+    /**
+     *  Type of the elements
+     */
+    typedef char type;
+
+    /**
+     *  The array of elements
+     *  @param  text
+     *  @return const char*
+     */
+    static const char *data(const Ascii &text) { return text.buffer().data(); }
+
+    /**
+     *  Move a byte offset back to the start of a character
+     *  @param  text        the text
+     *  @param  offset      the byte offset
+     *  @return size_t
+     */
+    static size_t boundary(const Ascii &, size_t offset) { return offset; }
+
+    /**
+     *  Part of a text between two byte offsets
+     *  @param  text        the text
+     *  @param  offset      byte offset where the part starts (at the start of a character)
+     *  @param  bytes       number of bytes (the part ends at the end of a character)
+     *  @return Ascii
+     */
+    static Ascii substring(const Ascii &text, size_t offset, size_t bytes) { return text.substr(offset, bytes); }
+
+    /**
+     *  Number of characters of a text between two byte offsets
+     *  @param  text        the text
+     *  @param  offset      byte offset where the part starts (at the start of a character)
+     *  @param  bytes       number of bytes (the part ends at the end of a character)
+     *  @return size_t
+     */
+    static size_t characters(const Ascii &, size_t, size_t bytes) { return bytes; }
+};
+
+/**
+ *  Tokens are an array of 32-bit values
+ */
+template <>
+struct Elements<Tokens>
+{
+    /**
+     *  Type of the elements
+     */
+    typedef uint32_t type;
+
+    /**
+     *  The array of elements
+     *  @param  text
+     *  @return const uint32_t*
+     */
+    static const uint32_t *data(const Tokens &text) { return (const uint32_t *)text.buffer().data(); }
+
+    /**
+     *  Move a byte offset back to the start of a character
+     *  @param  text        the text
+     *  @param  offset      the byte offset
+     *  @return size_t
+     */
+    static size_t boundary(const Tokens &, size_t offset) { return offset - offset % sizeof(uint32_t); }
+
+    /**
+     *  Part of a text between two byte offsets
+     *  @param  text        the text
+     *  @param  offset      byte offset where the part starts (at the start of a character)
+     *  @param  bytes       number of bytes (the part ends at the end of a character)
+     *  @return Tokens
+     */
+    static Tokens substring(const Tokens &text, size_t offset, size_t bytes) { return text.substr(offset / sizeof(uint32_t), bytes / sizeof(uint32_t)); }
+
+    /**
+     *  Number of characters of a text between two byte offsets
+     *  @param  text        the text
+     *  @param  offset      byte offset where the part starts (at the start of a character)
+     *  @param  bytes       number of bytes (the part ends at the end of a character)
+     *  @return size_t
+     */
+    static size_t characters(const Tokens &, size_t, size_t bytes) { return bytes / sizeof(uint32_t); }
+};
+
+/**
+ *  Utf8 text is decoded into an array of code points
+ */
+template <>
+struct Elements<Utf8>
+{
+    /**
+     *  Type of the elements
+     */
+    typedef uint32_t type;
+
+    /**
+     *  Move a byte offset back to the start of a character
+     *  @param  text        the text
+     *  @param  offset      the byte offset
+     *  @return size_t
+     */
+    static size_t boundary(const Utf8 &text, size_t offset)
+    {
+        // skip back over the continuation bytes
+        while (offset > 0 && offset < text.bytes() && ((unsigned char)text.buffer().data()[offset] & 0xc0) == 0x80) --offset;
+        return offset;
+    }
+
+    /**
+     *  Part of a text between two byte offsets, the part shares the index of the
+     *  text, so that it does not have to be validated and indexed again
+     *  @param  text        the text
+     *  @param  offset      byte offset where the part starts (at the start of a character)
+     *  @param  bytes       number of bytes (the part ends at the end of a character)
+     *  @return Utf8
+     */
+    static Utf8 substring(const Utf8 &text, size_t offset, size_t bytes)
+    {
+        // the characters at both ends
+        size_t first = text.character(offset);
+        return text.substr(first, text.character(offset + bytes) - first);
+    }
+
+    /**
+     *  Number of characters of a text between two byte offsets, these are looked up in the index
+     *  @param  text        the text
+     *  @param  offset      byte offset where the part starts (at the start of a character)
+     *  @param  bytes       number of bytes (the part ends at the end of a character)
+     *  @return size_t
+     */
+    static size_t characters(const Utf8 &text, size_t offset, size_t bytes) { return text.character(offset + bytes) - text.character(offset); }
+};
+
+/**
+ *  End of namespace
+ */
+}
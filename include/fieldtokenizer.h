@@ -0,0 +1,87 @@
+/**
+ *  FieldTokenizer.h
+ *
+ *  Tokenizer for csv data. Each field (including the separator that ends
+ *  it) is a token, and so is each line ending. Fields that start with a
+ *  double quote may contain separators, newlines and escaped quotes ("").
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "tokenizer.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class FieldTokenizer : public Tokenizer
+{
+private:
+    /**
+     *  The separator between the fields
+     *  @var char
+     */
+    char _separator;
+
+public:
+    /**
+     *  Constructor
+     *  @param  separator   the separator between the fields
+     */
+    FieldTokenizer(char separator = ',') : _separator(separator) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~FieldTokenizer() = default;
+
+    /**
+     *  Size of the token at the start of the data
+     *  @param  data        the remaining data
+     *  @param  size        number of remaining bytes
+     *  @return size_t
+     */
+    virtual size_t next(const char *data, size_t size) const
+    {
+        // line endings are tokens on their own
+        if (data[0] == '\n') return 1;
+        if (data[0] == '\r') return size > 1 && data[1] == '\n' ? 2 : 1;
+
+        // the end of the field
+        size_t end = 0;
+
+        // quoted fields run until the closing quote (a double quote is an escaped quote)
+        if (data[0] == '"') for (end = 1; end < size; ++end)
+        {
+            // skip the other characters
+            if (data[end] != '"') continue;
+
+            // this is the closing quote, unless it is escaped
+            if (end + 1 < size && data[end + 1] == '"') ++end; else { ++end; break; }
+        }
+
+        // the field runs until the separator or the line ending
+        while (end < size && data[end] != _separator && data[end] != '\n' && data[end] != '\r') ++end;
+
+        // the separator is part of the field
+        return end < size && data[end] == _separator ? end + 1 : end;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
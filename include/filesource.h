@@ -0,0 +1,107 @@
+/**
+ *  FileSource.h
+ *
+ *  Source that reads from a file descriptor
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <system_error>
+#include "source.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class FileSource : public Source
+{
+private:
+    /**
+     *  The file descriptor
+     *  @var int
+     */
+    int _fd;
+
+    /**
+     *  Is the file descriptor owned by this object?
+     *  @var bool
+     */
+    bool _owned;
+
+public:
+    /**
+     *  Constructor to read from a file descriptor, the caller remains responsible for closing it
+     *  @param  fd
+     */
+    explicit FileSource(int fd) : _fd(fd), _owned(false) {}
+
+    /**
+     *  Constructor to open and read a file
+     *  @param  filename
+     *  @throws std::system_error
+     */
+    explicit FileSource(const char *filename) : _fd(open(filename, O_RDONLY | O_CLOEXEC)), _owned(true)
+    {
+        // check for failure
+        if (_fd < 0) throw std::system_error(errno, std::generic_category(), filename);
+    }
+
+    /**
+     *  Sources can not be copied
+     *  @param  that
+     */
+    FileSource(const FileSource &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~FileSource()
+    {
+        // close the file if we opened it
+        if (_owned) close(_fd);
+    }
+
+    /**
+     *  Read data from the file
+     *  @param  buffer      where to store the data
+     *  @param  size        max number of bytes to read
+     *  @return size_t      number of bytes read, zero at the end of the file
+     *  @throws std::system_error
+     */
+    virtual size_t read(char *buffer, size_t size)
+    {
+        // keep trying when interrupted by a signal
+        while (true)
+        {
+            // read from the file
+            ssize_t result = ::read(_fd, buffer, size);
+
+            // check for success
+            if (result >= 0) return result;
+
+            // report errors
+            if (errno != EINTR) throw std::system_error(errno, std::generic_category(), "read");
+        }
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
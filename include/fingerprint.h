@@ -0,0 +1,194 @@
+/**
+ *  Fingerprint.h
+ *
+ *  Class with a compact summary of a text: a 64-bit hash of the entire
+ *  content and a MinHash sketch of its 8-byte shingles. The fingerprint of
+ *  a text that is diffed over and over again (like the current version of
+ *  a document) can be calculated once and be kept next to the text.
+ *
+ *  Texts with different hashes or sizes are known to be different. The hash
+ *  is not collision-resistant, so texts with the same hash and size are not
+ *  known to be identical, and patches do not use it to skip the diff. The
+ *  sketches estimate how similar the texts are: the fraction of shingles
+ *  that the texts share (the Jaccard index of the sets of shingles). This
+ *  is cheap enough to skip the diff altogether for unrelated texts (see
+ *  Prescreen).
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include "buffer.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Fingerprint
+{
+public:
+    /**
+     *  Number of bins of the sketch (the upper 6 bits of a hash select the bin)
+     *  @var size_t
+     */
+    static const size_t bins = 64;
+
+private:
+    /**
+     *  Number of bytes of the text
+     *  @var size_t
+     */
+    size_t _bytes;
+
+    /**
+     *  Hash of the entire text
+     *  @var uint64_t
+     */
+    uint64_t _hash;
+
+    /**
+     *  The sketch: for each bin the lowest hash of the shingles that fell into it
+     *  (all bits are set for empty bins)
+     *  @var uint64_t
+     */
+    uint64_t _sketch[bins];
+
+    /**
+     *  Scatter the bits of a 64-bit value (the finalizer of splitmix64)
+     *  @param  value
+     *  @return uint64_t
+     */
+    static uint64_t mix(uint64_t value)
+    {
+        // multiply and shift a couple of times
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+
+    /**
+     *  Load up to 8 bytes from memory (the missing bytes are zero)
+     *  @param  data
+     *  @param  size
+     *  @return uint64_t
+     */
+    static uint64_t load(const char *data, size_t size)
+    {
+        // copy the bytes into a word
+        uint64_t result = 0;
+        memcpy(&result, data, size < 8 ? size : 8);
+        return result;
+    }
+
+    /**
+     *  Add the hash of a shingle to the sketch
+     *  @param  hash
+     */
+    void add(uint64_t hash)
+    {
+        // the upper bits select the bin, the bin keeps the lowest hash
+        uint64_t &bin = _sketch[hash >> (64 - 6)];
+        if (hash < bin) bin = hash;
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  data        the text
+     *  @param  size        number of bytes of the text
+     */
+    Fingerprint(const char *data, size_t size) : _bytes(size), _hash(mix(size))
+    {
+        // all bins are empty
+        for (auto &bin : _sketch) bin = ~0ULL;
+
+        // the hash of the entire text, per word of 8 bytes
+        for (size_t i = 0; i < size; i += 8) _hash = mix(_hash ^ load(data + i, size - i)) + i;
+
+        // a text shorter than a shingle is a shingle of its own
+        if (size > 0 && size < 8) add(mix(load(data, size)));
+
+        // add the shingles of every position to the sketch
+        for (size_t i = 0; i + 8 <= size; ++i) add(mix(load(data + i, 8)));
+    }
+
+    /**
+     *  Constructor
+     *  @param  buffer      the text
+     */
+    Fingerprint(const Buffer &buffer) : Fingerprint(buffer.data(), buffer.bytes()) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Fingerprint() = default;
+
+    /**
+     *  Number of bytes of the text
+     *  @return size_t
+     */
+    size_t bytes() const { return _bytes; }
+
+    /**
+     *  Hash of the entire text
+     *  @return uint64_t
+     */
+    uint64_t hash() const { return _hash; }
+
+    /**
+     *  Could the texts be identical? This only compares the hashes and sizes: texts
+     *  with different fingerprints are different, but texts with the same fingerprint
+     *  still have to be compared to be sure
+     *  @param  that
+     *  @return bool
+     */
+    bool operator==(const Fingerprint &that) const { return _bytes == that._bytes && _hash == that._hash; }
+    bool operator!=(const Fingerprint &that) const { return !operator==(that); }
+
+    /**
+     *  Estimate the similarity of the texts: the fraction of the shingles of
+     *  both texts that they have in common, from 0.0 (unrelated texts) to 1.0
+     *  (the same shingles, this does not mean that the texts are identical).
+     *  The estimate is not accurate for texts with only a few shingles.
+     *  @param  that
+     *  @return double
+     */
+    double similarity(const Fingerprint &that) const
+    {
+        // number of bins that are used by one of the texts, and that hold the same shingle
+        size_t used = 0, same = 0;
+
+        // compare the bins
+        for (size_t i = 0; i < bins; ++i)
+        {
+            // skip the bins that are empty for both texts
+            if (_sketch[i] == ~0ULL && that._sketch[i] == ~0ULL) continue;
+
+            // count the bin
+            used += 1;
+            same += _sketch[i] == that._sketch[i] ? 1 : 0;
+        }
+
+        // two empty texts are the same
+        return used == 0 ? 1.0 : (double)same / used;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -4,6 +4,12 @@
  *  Class that checks if there is a common substring that is at least
  *  half of the size of the longer text. This is an optimization.
  *
+ *  Such a substring always holds the second or the third quarter of the
+ *  long text, so these quarters are used as seeds that are looked up in
+ *  the short text. The substrings of the short text are indexed once,
+ *  which makes it cheap to try two extra seeds in between (these may
+ *  find a longer common substring).
+ *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
  */
@@ -17,6 +23,8 @@
  *  Dependencies
  */
 #include "commonhalf.h"
+#include "seedindex.h"
+#include "arena.h"
 
 /**
  *  Begin of namespace
@@ -31,20 +39,27 @@ class HalfMatch
 {
 private:
     /**
-     *  The common half based on the second quarter
-     *  @var CommonHalf
+     *  Number of seeds that are tried
+     *  @var size_t
      */
-    CommonHalf<text_t> _q2;
-    
+    static const size_t seeds = 4;
+
+    /**
+     *  Index of the substrings of the short text
+     *  @var SeedIndex
+     */
+    SeedIndex<text_t> _index;
+
     /**
-     *  The common half based on the third quarter
+     *  The common halves based on the seeds: the second quarter, the
+     *  third quarter, and the positions halfway these quarters
      *  @var CommonHalf
      */
-    CommonHalf<text_t> _q3;
+    CommonHalf<text_t> _halves[seeds];
     
     /**
      *  The winning result
-     *  @var CommonHald
+     *  @var CommonHalf
      */
     CommonHalf<text_t> *_winner = nullptr;
     
@@ -52,19 +67,28 @@ private:
 public:
     /**
      *  Constructor
-     *  @param  text1
-     *  @param  text2
+     *  @param  longtext
+     *  @param  shorttext
+     *  @param  arena       arena for the index (nullptr for the heap)
      */
-    HalfMatch(const text_t &longtext, const text_t &shorttext) :
-        _q2(longtext, shorttext, (longtext.characters() + 3) / 4),
-        _q3(longtext, shorttext, (longtext.characters() + 1) / 2)
+    HalfMatch(const text_t &longtext, const text_t &shorttext, Arena *arena = nullptr) :
+        _index(shorttext, longtext.characters() / 4, arena),
+        _halves{
+            CommonHalf<text_t>(longtext, shorttext, (longtext.characters() + 3) / 4, _index),
+            CommonHalf<text_t>(longtext, shorttext, (longtext.characters() * 3 + 5) / 8, _index),
+            CommonHalf<text_t>(longtext, shorttext, (longtext.characters() + 1) / 2, _index),
+            CommonHalf<text_t>(longtext, shorttext, (longtext.characters() * 5 + 3) / 8, _index)
+        }
     {
-        // do we have two matches?
-        if (_q2 && _q3) _winner = _q2.characters() > _q3.characters() ? &_q2 : &_q3;
-    
-        // or only one?
-        else if (_q2) _winner = &_q2;
-        else if (_q3) _winner = &_q3;
+        // find the biggest match (on a tie, the later seed wins)
+        for (auto &half : _halves)
+        {
+            // skip seeds that did not give a useful result
+            if (!half) continue;
+
+            // is this better than what we had?
+            if (_winner == nullptr || half.characters() >= _winner->characters()) _winner = &half;
+        }
     }
     
     /**
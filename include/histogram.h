@@ -0,0 +1,166 @@
+/**
+ *  Histogram.h
+ *
+ *  Class that finds the anchor of the histogram diff algorithm (as it is
+ *  used by git and jgit) in two arrays of tokens. The anchor is the longest
+ *  common run of tokens that contains the rarest token of the first text,
+ *  so that lines that appear all over the place (like blank lines or closing
+ *  tags) are not used to align the texts. The texts are split around the
+ *  anchor, and the parts in front of it and behind it are solved separately.
+ *
+ *  Tokens that appear more than a couple of times in the first text are
+ *  never used as anchor. If all common tokens appear that often (or if
+ *  there are no common tokens at all), no anchor is found, and the texts
+ *  should be diffed with an other algorithm.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "arena.h"
+#include "tokentable.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Histogram
+{
+private:
+    /**
+     *  Max number of occurrences of a token in the first text to be used as anchor
+     *  @var size_t
+     */
+    static const size_t maxchain = 64;
+
+    /**
+     *  Position of the anchor in the first and second text
+     *  @var size_t
+     */
+    size_t _x = 0;
+    size_t _y = 0;
+
+    /**
+     *  Number of tokens of the anchor (zero if there is no anchor)
+     *  @var size_t
+     */
+    size_t _length = 0;
+
+public:
+    /**
+     *  Constructor
+     *  @param  text1       tokens of the first text
+     *  @param  size1       number of tokens of the first text
+     *  @param  text2       tokens of the second text
+     *  @param  size2       number of tokens of the second text
+     *  @param  arena       arena for the temporary arrays (nullptr for the heap)
+     */
+    Histogram(const uint32_t *text1, size_t size1, const uint32_t *text2, size_t size2, Arena *arena = nullptr)
+    {
+        // the distinct tokens of the first text
+        TokenTable table(size1, arena);
+
+        // the entry in the table of each position in the first text
+        std::vector<uint32_t, Allocator<uint32_t>> entries{Allocator<uint32_t>(arena)};
+        entries.reserve(size1);
+        for (size_t i = 0; i < size1; ++i) entries.push_back(table.insert(text1[i]));
+
+        // the number of occurrences of each entry, the first position where it occurs plus one, and
+        // the next position with the same entry plus one (zero at the end of the chain)
+        std::vector<uint32_t, Allocator<uint32_t>> counts(table.size(), 0, Allocator<uint32_t>(arena));
+        std::vector<uint32_t, Allocator<uint32_t>> heads(table.size(), 0, Allocator<uint32_t>(arena));
+        std::vector<uint32_t, Allocator<uint32_t>> next(size1, 0, Allocator<uint32_t>(arena));
+
+        // fill the chains back to front, so that the positions are in ascending order
+        for (size_t i = size1; i-- > 0;) { next[i] = heads[entries[i]]; heads[entries[i]] = i + 1; ++counts[entries[i]]; }
+
+        // the lowest number of occurrences of the best anchor so far (tokens that occur more often are skipped)
+        size_t lowest = maxchain;
+
+        // walk over the second text
+        for (size_t j = 0; j < size2;)
+        {
+            // the entry of the token
+            ssize_t entry = table.find(text2[j]);
+
+            // skip tokens that do not appear in the first text, or that are too common
+            if (entry < 0 || counts[entry] > lowest) { ++j; continue; }
+
+            // where to continue in the second text
+            size_t proceed = j + 1;
+
+            // try all positions where the token appears in the first text
+            for (uint32_t link = heads[entry]; link != 0; link = next[link - 1])
+            {
+                // the position in the first text
+                size_t i = link - 1;
+
+                // the number of occurrences of the rarest token in the common run
+                size_t count = counts[entry];
+
+                // extend the common run to the front
+                size_t begin1 = i, begin2 = j;
+                while (begin1 > 0 && begin2 > 0 && text1[begin1 - 1] == text2[begin2 - 1]) { --begin1; --begin2; count = std::min(count, (size_t)counts[entries[begin1]]); }
+
+                // and to the back
+                size_t end1 = i + 1, end2 = j + 1;
+                while (end1 < size1 && end2 < size2 && text1[end1] == text2[end2]) { count = std::min(count, (size_t)counts[entries[end1]]); ++end1; ++end2; }
+
+                // the run is better if its tokens are rarer, or if it is longer
+                if (count < lowest || end1 - begin1 > _length) { _x = begin1; _y = begin2; _length = end1 - begin1; lowest = count; }
+
+                // the tokens inside the run do not have to be tried again
+                proceed = std::max(proceed, end2);
+            }
+
+            // proceed with the next token
+            j = proceed;
+        }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Histogram() = default;
+
+    /**
+     *  Was an anchor found?
+     *  @return bool
+     */
+    bool valid() const { return _length > 0; }
+
+    /**
+     *  Cast to boolean
+     *  @return bool
+     */
+    operator bool () const { return valid(); }
+    bool operator! () const { return !valid(); }
+
+    /**
+     *  Position of the anchor in the two texts, and its number of tokens
+     *  @return size_t
+     */
+    size_t x() const { return _x; }
+    size_t y() const { return _y; }
+    size_t length() const { return _length; }
+};
+
+/**
+ *  End of namespace
+ */
+}
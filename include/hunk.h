@@ -0,0 +1,120 @@
+/**
+ *  Hunk.h
+ *
+ *  A hunk is a self-contained part of a patch that can be applied to a text
+ *  on its own: it holds the text before and after the change, including a
+ *  couple of bytes of context on both sides, and the diffs between the two.
+ *  Unlike a Patch, a hunk holds a copy of its data, so it does not depend
+ *  on the texts from which it was made.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <utility>
+#include <vector>
+#include "buffer.h"
+#include "diff.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Hunk
+{
+private:
+    /**
+     *  Byte offset of the hunk in the original text and in the new text
+     *  @var size_t
+     */
+    size_t _start1;
+    size_t _start2;
+
+    /**
+     *  The text before and after the change (including the context)
+     *  @var Buffer
+     */
+    Buffer _before;
+    Buffer _after;
+
+    /**
+     *  The diffs (inserted data is stored in the 'after' buffer, the rest in the 'before' buffer)
+     *  @var std::vector
+     */
+    std::vector<Diff> _diffs;
+
+public:
+    /**
+     *  Constructor
+     *  @param  start1      byte offset in the original text
+     *  @param  start2      byte offset in the new text
+     *  @param  before      the text before the change
+     *  @param  after       the text after the change
+     *  @param  diffs       the diffs between the two
+     */
+    Hunk(size_t start1, size_t start2, const std::vector<char> &before, const std::vector<char> &after, std::vector<Diff> &&diffs) :
+        _start1(start1), _start2(start2),
+        _before(before.data(), before.size(), true),
+        _after(after.data(), after.size(), true),
+        _diffs(std::move(diffs)) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Hunk() = default;
+
+    /**
+     *  Byte offset where the hunk starts in the original text and in the new text
+     *  @return size_t
+     */
+    size_t start1() const { return _start1; }
+    size_t start2() const { return _start2; }
+
+    /**
+     *  Number of bytes of the hunk in the original text and in the new text
+     *  @return size_t
+     */
+    size_t length1() const { return _before.bytes(); }
+    size_t length2() const { return _after.bytes(); }
+
+    /**
+     *  The text before and after the change
+     *  @return Buffer
+     */
+    const Buffer &before() const { return _before; }
+    const Buffer &after() const { return _after; }
+
+    /**
+     *  The diffs between the two
+     *  @return std::vector
+     */
+    const std::vector<Diff> &diffs() const { return _diffs; }
+
+    /**
+     *  Get access to the data of a diff
+     *  @param  diff        the diff
+     *  @return Buffer
+     */
+    Buffer buffer(const Diff &diff) const
+    {
+        // inserted data comes from the text after the change, the rest from the text before
+        return Buffer((diff.operation() == Operation::INSERT ? _after : _before).data() + diff.offset(), diff.bytes(), false);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,261 @@
+/**
+ *  Hunks.h
+ *
+ *  Class that splits a patch into hunks: the changes that are close to each
+ *  other (separated by less than twice Limits::Patch_Margin unchanged bytes)
+ *  end up in the same hunk. Each hunk gets enough context to be found back
+ *  in a text that was modified in the meantime: at least Patch_Margin bytes
+ *  on both sides, and even more if the hunk is not unique in its area.
+ *
+ *  The hunks are meant to be applied in order (see the Apply class). The
+ *  context in front of a hunk is therefore taken from the new text (where
+ *  the previous hunks have already been applied), and the context after the
+ *  hunk from the original text.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "buffer.h"
+#include "diff.h"
+#include "hunk.h"
+#include "limits.h"
+#include "patch.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Hunks
+{
+private:
+    /**
+     *  The hunks
+     *  @var std::vector
+     */
+    std::vector<Hunk> _hunks;
+
+    /**
+     *  Does a pattern appear only once in a text?
+     *  @param  text        the text
+     *  @param  size        size of the text
+     *  @param  pattern     the pattern
+     *  @param  length      size of the pattern
+     *  @return bool
+     */
+    static bool unique(const char *text, size_t size, const char *pattern, size_t length)
+    {
+        // the end of the text (memmem() is not available everywhere)
+        const char *end = text + size;
+
+        // find the first occurrence
+        const char *found = std::search(text, end, pattern, pattern + length);
+        if (found == end) return true;
+
+        // there should not be a second one
+        return std::search(found + 1, end, pattern, pattern + length) == end;
+    }
+
+    /**
+     *  Create a hunk for a range of diffs
+     *  @param  limits      the limits with the patch settings
+     *  @param  input1      the original text
+     *  @param  input2      the new text
+     *  @param  first       the first diff
+     *  @param  last        the end of the diffs
+     *  @param  begin1      byte offset of the first diff in the original text
+     *  @param  begin2      byte offset of the first diff in the new text
+     */
+    template <typename iterator_t>
+    void add(const Limits &limits, const Buffer &input1, const Buffer &input2, iterator_t first, iterator_t last, size_t begin1, size_t begin2)
+    {
+        // the end of the diffs in the original text
+        size_t end1 = begin1;
+        for (auto diff = first; diff != last; ++diff) if (diff->operation() != Operation::INSERT) end1 += diff->bytes();
+
+        // size of the margin, and the max size of the pattern
+        size_t margin = std::max(0, (int)limits.Patch_Margin);
+        size_t maxsize = std::max(0, limits.Match_MaxBits - 2 * limits.Patch_Margin);
+
+        // the area in which the hunk must be unique: the distance where a fuzzy match is still accepted
+        size_t tolerance = (size_t)std::max(0.0f, limits.Match_Threshold * limits.Match_Distance) + std::max(0, (int)limits.Match_MaxBits);
+
+        // the text in which the hunk is going to be applied: the new text in front of it, the original text after it
+        size_t before = std::min(begin2, tolerance);
+        std::vector<char> area(input2.data() + begin2 - before, input2.data() + begin2);
+        area.insert(area.end(), input1.data() + begin1, input1.data() + std::min(input1.bytes(), end1 + tolerance));
+
+        // the position and size of the hunk in this area
+        size_t position = before, size = end1 - begin1;
+
+        // add context until the pattern is unique (but do not make the pattern too long)
+        size_t padding = 0;
+        while (margin > 0 && size + 2 * padding < maxsize)
+        {
+            // the pattern with the context so far
+            size_t start = position - std::min(position, padding);
+            size_t end = std::min(area.size(), position + size + padding);
+
+            // leap out if it is unique
+            if (unique(area.data(), area.size(), area.data() + start, end - start)) break;
+
+            // use more context
+            padding += margin;
+
+            // leap out if there is nothing more to add
+            if (start == 0 && end == area.size()) break;
+        }
+
+        // add one more margin to be safe
+        padding += margin;
+
+        // the context on both sides
+        size_t prefix = std::min(position, padding);
+        size_t suffix = std::min(area.size() - position - size, padding);
+
+        // the texts before and after the change, and the diffs
+        std::vector<char> text1(area.data() + position - prefix, area.data() + position);
+        std::vector<char> text2(text1);
+        std::vector<Diff> diffs;
+
+        // the context in front
+        if (prefix > 0) diffs.emplace_back(Operation::EQUAL, 0, prefix);
+
+        // the data of the diffs
+        for (auto diff = first; diff != last; ++diff)
+        {
+            // the data of this diff
+            const char *data = (diff->operation() == Operation::INSERT ? input2 : input1).data() + diff->offset();
+
+            // store it in the right buffer
+            switch (diff->operation()) {
+            case Operation::INSERT:
+                diffs.emplace_back(Operation::INSERT, text2.size(), diff->bytes());
+                text2.insert(text2.end(), data, data + diff->bytes());
+                break;
+
+            case Operation::DELETE:
+                diffs.emplace_back(Operation::DELETE, text1.size(), diff->bytes());
+                text1.insert(text1.end(), data, data + diff->bytes());
+                break;
+
+            case Operation::EQUAL:
+                diffs.emplace_back(Operation::EQUAL, text1.size(), diff->bytes());
+                text1.insert(text1.end(), data, data + diff->bytes());
+                text2.insert(text2.end(), data, data + diff->bytes());
+                break;
+            }
+        }
+
+        // the context after the change
+        if (suffix > 0)
+        {
+            // the context that is added
+            const char *data = area.data() + position + size;
+
+            // merge with a trailing equal diff
+            if (diffs.back().operation() == Operation::EQUAL) diffs.back().append(suffix);
+            else diffs.emplace_back(Operation::EQUAL, text1.size(), suffix);
+
+            // add to both texts
+            text1.insert(text1.end(), data, data + suffix);
+            text2.insert(text2.end(), data, data + suffix);
+        }
+
+        // store the hunk
+        _hunks.emplace_back(begin1 - prefix, begin2 - prefix, text1, text2, std::move(diffs));
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  limits      the limits with the patch settings
+     *  @param  patch       the patch to split
+     */
+    template <typename text_t, typename char_t>
+    Hunks(const Limits &limits, const Patch<text_t, char_t> &patch)
+    {
+        // number of bytes of an equal diff that separates two hunks
+        size_t separator = 2 * std::max(0, (int)limits.Patch_Margin);
+
+        // the position in the two texts, and the start of the current hunk
+        size_t position1 = 0, position2 = 0, begin1 = 0, begin2 = 0;
+
+        // the diffs of the current hunk
+        auto first = patch.begin(), last = patch.begin();
+        bool pending = false;
+
+        // walk over the diffs
+        for (auto diff = patch.begin(); diff != patch.end(); ++diff)
+        {
+            // a change starts a new hunk if there is none yet
+            if (!pending && diff->operation() != Operation::EQUAL) first = diff, begin1 = position1, begin2 = position2, pending = true;
+
+            // changes are always added to the hunk
+            if (diff->operation() != Operation::EQUAL) last = diff + 1;
+
+            // short unchanged parts are added too, but not at the end of the patch
+            else if (pending && diff->bytes() <= separator && diff + 1 != patch.end()) last = diff + 1;
+
+            // long unchanged parts end the hunk
+            if (pending && diff->operation() == Operation::EQUAL && diff->bytes() >= separator)
+            {
+                // create the hunk
+                add(limits, patch.input1(), patch.input2(), first, last, begin1, begin2);
+                pending = false;
+            }
+
+            // update the positions
+            if (diff->operation() != Operation::INSERT) position1 += diff->bytes();
+            if (diff->operation() != Operation::DELETE) position2 += diff->bytes();
+        }
+
+        // the last hunk
+        if (pending) add(limits, patch.input1(), patch.input2(), first, last, begin1, begin2);
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Hunks() = default;
+
+    /**
+     *  Number of hunks
+     *  @return size_t
+     */
+    size_t size() const { return _hunks.size(); }
+
+    /**
+     *  Iterate over the hunks
+     *  @return iterator
+     */
+    std::vector<Hunk>::const_iterator begin() const { return _hunks.begin(); }
+    std::vector<Hunk>::const_iterator end() const { return _hunks.end(); }
+
+    /**
+     *  Get access to a hunk
+     *  @param  index
+     *  @return Hunk
+     */
+    const Hunk &operator[](size_t index) const { return _hunks[index]; }
+};
+
+/**
+ *  End of namespace
+ */
+}
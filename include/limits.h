@@ -15,13 +15,19 @@
 /**
  *  Dependencies
  */
-#include <limits>
+#include "algorithm.h"
+#include "deadline.h"
 
 /**
  *  Begin of namespace
  */
 namespace DIFF {
 
+/**
+ *  Forward declarations
+ */
+class Stats;
+
 /**
  *  Class definition
  */
@@ -29,7 +35,7 @@ class Limits
 {
 public:
     /**
-     *  Timeout for the "diff" operation
+     *  Timeout for the "diff" operation in seconds (zero or less for no timeout)
      *  @var float
      */
     float timeout = 1.0f;
@@ -40,6 +46,83 @@ public:
      */
     short editcost = 4;
 
+    /**
+     *  Once the deadline has passed, the middle snake searches are limited to
+     *  this number of edit steps, after which the texts are split at the
+     *  furthest points that were reached. The patch then gets worse gradually
+     *  when the deadline is tight. Zero replaces the rest of the texts with
+     *  one big DELETE and INSERT (this is faster, but gives huge patches)
+     *  @var size_t
+     */
+    size_t anytime = 64;
+
+    /**
+     *  Algorithm for patches over tokens: the lines in linemode, and the tokens
+     *  of a tokenizer. Patience and histogram diff align the texts on rare
+     *  lines, which gives more readable patches for code and templates with
+     *  many repeated lines (like blank lines and closing tags), and they are
+     *  faster too. If they find no rare common lines, Myers is used after all.
+     *  Character based patches always use Myers.
+     *  @var Algorithm
+     */
+    Algorithm algorithm = Algorithm::MYERS;
+
+    /**
+     *  Texts that both have at most this number of characters are diffed with
+     *  the bit-parallel algorithm, which handles 64 characters per machine word
+     *  and is much faster for short texts than the recursive bisect. Values over
+     *  256 are treated as 256, and zero always uses the other algorithms.
+     *  @var size_t
+     */
+    size_t bitparallel = 256;
+
+    /**
+     *  When patches are calculated with the fingerprints of the texts, texts
+     *  that are estimated to be less similar than this (the fraction of
+     *  shared 8-byte shingles, see Fingerprint) are replaced as a whole
+     *  without running the algorithm. Zero always runs the algorithm.
+     *  @var float
+     */
+    float similarity = 0.0f;
+
+    /**
+     *  Should the patch be cleaned up for human readers? Short equalities between
+     *  bigger edits are then merged into the edits, and overlaps between deleted
+     *  and inserted data become equalities
+     *  @var bool
+     */
+    bool semantic = false;
+
+    /**
+     *  Should the patch be cleaned up for efficiency? Equalities that are shorter
+     *  than the editcost and that are surrounded by edits are then merged into
+     *  the edits, because they cost more than they save
+     *  @var bool
+     */
+    bool efficient = false;
+
+    /**
+     *  Optional object in which the patches record how they were calculated
+     *  (this is only filled in if the library is compiled with DIFF_STATS)
+     *  @var Stats
+     */
+    Stats *stats = nullptr;
+
+    /**
+     *  When a thread pool is used, the two halves of a problem are only
+     *  calculated in parallel if both of them have at least this number of
+     *  characters (smaller problems are not worth the overhead)
+     *  @var size_t
+     */
+    size_t forksize = 4096;
+
+    /**
+     *  When a patch is updated after an edit, the diffs in this number of bytes
+     *  around the edit are recalculated too (the rest of the patch is kept)
+     *  @var size_t
+     */
+    size_t editcontext = 64;
+
 
 
   // At what point is no match declared (0.0 = perfection, 1.0 = very loose).
@@ -56,8 +139,10 @@ public:
   // Chunk size for context length.
   short Patch_Margin = 4;
 
-  // The number of bits in an int.
-  short Match_MaxBits = 32;
+  // Max size of a pattern that is matched as a whole, bigger hunks are matched
+  // at both ends. Any size is supported, patterns over 64 bytes use multiple
+  // 64-bit words in the bitap algorithm.
+  short Match_MaxBits = 64;
 
 
 public:
@@ -72,16 +157,16 @@ public:
     virtual ~Limits() = default;
     
     /**
-     *  Get the deadline for the algorithm, given the current time
-     *  @return clock_t
+     *  Get the deadline for the algorithm, starting from the current time
+     *  @return Deadline
      */
-    clock_t deadline() const
+    Deadline deadline() const
     {
         // if there is no limit
-        if (timeout <= 0) return std::numeric_limits<clock_t>::max();
-        
-        // get current time
-        return clock() + (clock_t)(timeout * CLOCKS_PER_SEC);
+        if (timeout <= 0) return Deadline();
+
+        // the timeout may be a fraction of a second
+        return Deadline(timeout);
     }
 };
 
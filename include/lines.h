@@ -0,0 +1,167 @@
+/**
+ *  Lines.h
+ *
+ *  Class that splits a buffer into lines, and that converts each line into
+ *  a token. Identical lines (also when they come from different buffers that
+ *  share the same dictionary) get identical tokens, so that a diff can be
+ *  calculated over the tokens instead of over the characters.
+ *
+ *  The buffer is split on bytes: a newline byte never appears inside a
+ *  multi-byte utf8 sequence, so this is safe for all text types.
+ *
+ *  Instead of lines, the buffer can also be split into the tokens of a
+ *  tokenizer (like words or html tags).
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "buffer.h"
+#include "tokens.h"
+#include "dictionary.h"
+#include "tokenizer.h"
+#include "arena.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Lines
+{
+private:
+    /**
+     *  The token of each line
+     *  @var std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> _tokens;
+
+    /**
+     *  Byte offset of the start of each line, followed by the total size
+     *  @var std::vector
+     */
+    std::vector<size_t, Allocator<size_t>> _offsets;
+
+public:
+    /**
+     *  Constructor
+     *  @param  arena       arena to allocate from (nullptr for the heap)
+     */
+    Lines(Arena *arena = nullptr) :
+        _tokens(Allocator<uint32_t>(arena)),
+        _offsets(Allocator<size_t>(arena)) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Lines() = default;
+
+    /**
+     *  Split a buffer into lines (this removes the lines that were assigned before,
+     *  but the allocated memory is reused)
+     *  @param  buffer      the buffer to split
+     *  @param  dictionary  dictionary to look up the tokens
+     */
+    void assign(const Buffer &buffer, Dictionary &dictionary)
+    {
+        // forget the previous lines
+        _tokens.clear();
+        _offsets.clear();
+
+        // the data to split
+        const char *data = buffer.data();
+        size_t size = buffer.bytes();
+
+        // walk over the lines
+        for (size_t pos = 0; pos < size;)
+        {
+            // find the end of the line (the newline is part of the line)
+            const char *newline = (const char *)memchr(data + pos, '\n', size - pos);
+            size_t end = newline ? newline - data + 1 : size;
+
+            // store the line
+            _offsets.push_back(pos);
+            _tokens.push_back(dictionary.intern(data + pos, end - pos));
+
+            // proceed with the next line
+            pos = end;
+        }
+
+        // the end offset of the final line
+        _offsets.push_back(size);
+    }
+
+    /**
+     *  Split a buffer into the tokens of a tokenizer (this removes the tokens
+     *  that were assigned before, but the allocated memory is reused)
+     *  @param  buffer      the buffer to split
+     *  @param  dictionary  dictionary to look up the tokens
+     *  @param  tokenizer   the tokenizer
+     */
+    void assign(const Buffer &buffer, Dictionary &dictionary, const Tokenizer &tokenizer)
+    {
+        // forget the previous tokens
+        _tokens.clear();
+        _offsets.clear();
+
+        // the data to split
+        const char *data = buffer.data();
+        size_t size = buffer.bytes();
+
+        // walk over the tokens
+        for (size_t pos = 0; pos < size;)
+        {
+            // the size of the token (we make sure that there is progress)
+            size_t length = std::max(size_t(1), std::min(tokenizer.next(data + pos, size - pos), size - pos));
+
+            // store the token
+            _offsets.push_back(pos);
+            _tokens.push_back(dictionary.intern(data + pos, length));
+
+            // proceed with the next token
+            pos += length;
+        }
+
+        // the end offset of the final token
+        _offsets.push_back(size);
+    }
+
+    /**
+     *  Number of lines
+     *  @return size_t
+     */
+    size_t size() const { return _tokens.size(); }
+
+    /**
+     *  The tokens
+     *  @return Tokens
+     */
+    Tokens tokens() const { return Tokens(_tokens.data(), _tokens.size()); }
+
+    /**
+     *  Byte offset where a line starts (passing the number of lines
+     *  returns the total size of the buffer)
+     *  @param  line        line number
+     *  @return size_t
+     */
+    size_t offset(size_t line) const { return _offsets[line]; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,158 @@
+/**
+ *  MappedFile.h
+ *
+ *  Read-only memory mapping of a file. The mapping is exposed as a Buffer
+ *  view that can be wrapped in any of the text types, so that files can be
+ *  compared without reading them into memory first. The pages are loaded
+ *  on demand and are shared with other processes that map the same file.
+ *
+ *  The mapping is advised as sequential, because the diff algorithm starts
+ *  by scanning the common prefix and suffix. Callers that access the text
+ *  differently can change this with advise().
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include "ascii.h"
+#include "buffer.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class MappedFile
+{
+private:
+    /**
+     *  The mapped memory (nullptr for empty files, they can not be mapped)
+     *  @var void *
+     */
+    void *_data = nullptr;
+
+    /**
+     *  Size of the mapping
+     *  @var size_t
+     */
+    size_t _size = 0;
+
+    /**
+     *  Map a file
+     *  @param  fd          the file descriptor
+     *  @param  filename    name of the file (for error messages)
+     *  @throws std::system_error
+     */
+    void map(int fd, const char *filename)
+    {
+        // find out the size of the file
+        struct stat info;
+        if (fstat(fd, &info) < 0) throw std::system_error(errno, std::generic_category(), filename);
+
+        // empty files can not be mapped
+        if (info.st_size == 0) return;
+
+        // map the file
+        void *data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) throw std::system_error(errno, std::generic_category(), filename);
+
+        // store the mapping
+        _data = data;
+        _size = info.st_size;
+
+        // the prefix and suffix are scanned first
+        advise(MADV_SEQUENTIAL);
+    }
+
+public:
+    /**
+     *  Constructor to map a file
+     *  @param  filename
+     *  @throws std::system_error
+     */
+    explicit MappedFile(const char *filename)
+    {
+        // open the file
+        int fd = open(filename, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) throw std::system_error(errno, std::generic_category(), filename);
+
+        // map it, the file descriptor is no longer needed afterwards
+        try { map(fd, filename); } catch (...) { close(fd); throw; }
+        close(fd);
+    }
+
+    /**
+     *  Constructor to map a file that is already open, the caller remains responsible for closing it
+     *  @param  fd
+     *  @throws std::system_error
+     */
+    explicit MappedFile(int fd) { map(fd, "mmap"); }
+
+    /**
+     *  Mappings can not be copied
+     *  @param  that
+     */
+    MappedFile(const MappedFile &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~MappedFile()
+    {
+        // remove the mapping
+        if (_data) munmap(_data, _size);
+    }
+
+    /**
+     *  Tell the kernel how the mapping is going to be accessed
+     *  @param  advice      one of the MADV_* constants
+     *  @return bool
+     */
+    bool advise(int advice)
+    {
+        // empty files have nothing to advise
+        return _data == nullptr || madvise(_data, _size, advice) == 0;
+    }
+
+    /**
+     *  The mapped data (a view that is valid as long as this object exists)
+     *  @return Buffer
+     */
+    Buffer buffer() const { return Buffer((const char *)_data, _size, false); }
+
+    /**
+     *  Size of the file
+     *  @return size_t
+     */
+    size_t bytes() const { return _size; }
+
+    /**
+     *  The mapped data as text (a view that is valid as long as this object exists)
+     *  @return text_t
+     *  @throws std::invalid_argument   for utf8 text that is not valid
+     */
+    template <typename text_t = Ascii>
+    text_t text() const { return text_t(buffer(), false); }
+};
+
+/**
+ *  End of namespace
+ */
+}
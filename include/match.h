@@ -0,0 +1,389 @@
+/**
+ *  Match.h
+ *
+ *  Class that finds the best fuzzy match of a pattern in a text, close to
+ *  an expected location. This uses the bitap algorithm, which keeps track
+ *  of the matches with up to 'd' errors in bit vectors. The bit vectors
+ *  are made up of 64-bit words, so patterns of any length are supported:
+ *  patterns that are longer than 64 bits use multiple words per vector.
+ *
+ *  The quality of a match depends on the number of errors and on the
+ *  distance to the expected location, see Limits::Match_Threshold and
+ *  Limits::Match_Distance. The text and pattern are compared as bytes.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+#include <algorithm>
+#include <vector>
+#include "limits.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Match
+{
+private:
+    /**
+     *  Position of the match, -1 if there is none
+     *  @var ssize_t
+     */
+    ssize_t _position = -1;
+
+    /**
+     *  Find the first exact match at or after a position
+     *  @param  text        the text to search
+     *  @param  size        size of the text
+     *  @param  pattern     the pattern to look for
+     *  @param  length      size of the pattern
+     *  @param  from        first position to check
+     *  @return ssize_t
+     */
+    static ssize_t first(const char *text, size_t size, const char *pattern, size_t length, size_t from)
+    {
+        // nothing to find if the pattern does not fit
+        if (from > size) return -1;
+
+        // an empty pattern matches right away
+        if (length == 0) return from;
+
+        // search the memory (memmem() is not available everywhere)
+        const char *result = std::search(text + from, text + size, pattern, pattern + length);
+        return result == text + size ? -1 : result - text;
+    }
+
+    /**
+     *  Find the last exact match that starts at or before a position
+     *  @param  text        the text to search
+     *  @param  size        size of the text
+     *  @param  pattern     the pattern to look for
+     *  @param  length      size of the pattern
+     *  @param  until       last position to check
+     *  @return ssize_t
+     */
+    static ssize_t last(const char *text, size_t size, const char *pattern, size_t length, size_t until)
+    {
+        // nothing to find if the pattern does not fit
+        if (length > size) return -1;
+
+        // check the positions back to front
+        for (size_t i = std::min(until, size - length) + 1; i-- > 0;) if (length == 0 || memcmp(text + i, pattern, length) == 0) return i;
+
+        // not found
+        return -1;
+    }
+
+    /**
+     *  Helper class with the state of the bitap search
+     */
+    class Bitap
+    {
+    private:
+        /**
+         *  Max number of errors relative to the size of the pattern, and the
+         *  distance at which a match gets one extra error
+         *  @var float
+         *  @var int
+         */
+        float _threshold;
+        int _distance;
+
+        /**
+         *  The text that is searched
+         *  @var const char *
+         *  @var size_t
+         */
+        const char *_text;
+        size_t _size;
+
+        /**
+         *  The size of the pattern
+         *  @var size_t
+         */
+        size_t _length;
+
+        /**
+         *  The expected location
+         *  @var size_t
+         */
+        size_t _location;
+
+        /**
+         *  Number of 64-bit words in each bit vector
+         *  @var size_t
+         */
+        size_t _words;
+
+        /**
+         *  The bit vector of each byte value: the bits of the positions in the pattern where the byte appears
+         *  @var std::vector
+         */
+        std::vector<uint64_t> _alphabet;
+
+        /**
+         *  The bit vectors for the current and the previous number of errors, one vector for each position in the text
+         *  @var std::vector
+         */
+        std::vector<uint64_t> _current;
+        std::vector<uint64_t> _previous;
+
+        /**
+         *  Score of a match with a number of errors at a certain position (lower is better)
+         *  @param  errors      number of errors
+         *  @param  position    position of the match
+         *  @return double
+         */
+        double score(size_t errors, size_t position) const
+        {
+            // the accuracy depends on the number of errors
+            double accuracy = (double)errors / _length;
+
+            // the proximity depends on the distance to the expected location
+            size_t proximity = position > _location ? position - _location : _location - position;
+
+            // without a distance, only matches at the exact location are allowed
+            if (_distance == 0) return proximity ? 1.0 : accuracy;
+
+            // the score is a combination of both
+            return accuracy + (double)proximity / _distance;
+        }
+
+        /**
+         *  Calculate a bit vector: the vector of the next position shifted by one bit, and
+         *  masked with the bits of the character (and combined with the previous vectors)
+         *  @param  result      the vector to calculate
+         *  @param  next        the vector of the next position
+         *  @param  mask        the bits of the character
+         *  @param  previous    vector at this position with one error less (nullptr for zero errors)
+         *  @param  after       vector at the next position with one error less (nullptr for zero errors)
+         */
+        void calculate(uint64_t *result, const uint64_t *next, const uint64_t *mask, const uint64_t *previous, const uint64_t *after) const
+        {
+            // the bits that are shifted from the lower word into the higher word
+            uint64_t carry1 = 1, carry2 = 1;
+
+            // process all words
+            for (size_t w = 0; w < _words; ++w)
+            {
+                // an exact match of the character
+                uint64_t value = ((next[w] << 1) | carry1) & mask[w];
+                carry1 = next[w] >> 63;
+
+                // an insertion, deletion or substitution
+                if (previous)
+                {
+                    // combine the vectors with one error less
+                    uint64_t combined = previous[w] | after[w];
+                    value |= (combined << 1) | carry2 | after[w];
+                    carry2 = combined >> 63;
+                }
+
+                // store the result
+                result[w] = value;
+            }
+        }
+
+    public:
+        /**
+         *  Constructor
+         *  @param  limits      the limits with the match settings
+         *  @param  text        the text to search
+         *  @param  size        size of the text
+         *  @param  pattern     the pattern to look for
+         *  @param  length      size of the pattern (at least one)
+         *  @param  location    the expected location
+         */
+        Bitap(const Limits &limits, const char *text, size_t size, const char *pattern, size_t length, size_t location) :
+            _threshold(limits.Match_Threshold), _distance(limits.Match_Distance),
+            _text(text), _size(size), _length(length), _location(location), _words((length + 63) / 64),
+            _alphabet(256 * _words, 0)
+        {
+            // the first character of the pattern is the highest bit
+            for (size_t i = 0; i < length; ++i)
+            {
+                // the bit of this position
+                size_t bit = length - i - 1;
+                _alphabet[(unsigned char)pattern[i] * _words + bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+        }
+
+        /**
+         *  Destructor
+         */
+        virtual ~Bitap() = default;
+
+        /**
+         *  Run the search
+         *  @param  pattern     the pattern to look for
+         *  @return ssize_t     position of the best match, -1 if there is none
+         */
+        ssize_t search(const char *pattern)
+        {
+            // the highest score that is accepted
+            double threshold = _threshold;
+
+            // if there is an exact match, this is the highest score we accept
+            ssize_t best = first(_text, _size, pattern, _length, _location);
+            if (best >= 0)
+            {
+                // there could be a better exact match in front of the location
+                threshold = std::min(score(0, best), threshold);
+                best = last(_text, _size, pattern, _length, _location + _length);
+                if (best >= 0) threshold = std::min(score(0, best), threshold);
+            }
+
+            // the bit of a complete match (the last character of the pattern)
+            size_t matchword = (_length - 1) / 64;
+            uint64_t matchbit = uint64_t(1) << ((_length - 1) % 64);
+
+            // vector of zero bits for positions beyond the end of the text
+            std::vector<uint64_t> zeros(_words, 0);
+
+            // the best location found so far
+            best = -1;
+
+            // the range that is searched for the previous number of errors
+            size_t range = _length + _size;
+
+            // try an increasing number of errors
+            for (size_t d = 0; d < _length; ++d)
+            {
+                // use a binary search to find out how far from the location we can go with this number of errors
+                size_t low = 0, middle = range;
+                while (low < middle)
+                {
+                    // is the score at this distance still acceptable?
+                    if (score(d, _location + middle) <= threshold) low = middle; else range = middle;
+                    middle = (range - low) / 2 + low;
+                }
+
+                // use this distance for the next number of errors
+                range = middle;
+
+                // the positions to search
+                size_t start = _location + 1 > middle ? _location - middle + 1 : 1;
+                size_t finish = std::min(_location + middle, _size) + _length;
+
+                // the vectors for this number of errors (all bits are cleared, just like the positions that are not searched)
+                _current.assign((finish + 2) * _words, 0);
+
+                // the vector after the last position has the lowest 'd' bits set
+                uint64_t *initial = _current.data() + (finish + 1) * _words;
+                for (size_t bit = 0; bit < d; ++bit) initial[bit / 64] |= uint64_t(1) << (bit % 64);
+
+                // walk backwards over the text
+                for (size_t j = finish; j >= start; --j)
+                {
+                    // the bits of the character before this position
+                    const uint64_t *mask = j - 1 < _size ? _alphabet.data() + (unsigned char)_text[j - 1] * _words : zeros.data();
+
+                    // the vectors with one error less (the previous vectors may be shorter)
+                    const uint64_t *previous = nullptr, *after = nullptr;
+                    if (d > 0 && (j + 1) * _words < _previous.size()) previous = _previous.data() + j * _words, after = previous + _words;
+                    else if (d > 0) previous = after = zeros.data();
+
+                    // calculate the vector
+                    uint64_t *vector = _current.data() + j * _words;
+                    calculate(vector, vector + _words, mask, previous, after);
+
+                    // skip the position if the pattern does not match here
+                    if ((vector[matchword] & matchbit) == 0) continue;
+
+                    // the score of this match
+                    double value = score(d, j - 1);
+
+                    // skip the match if it is not better than the best match so far
+                    if (value > threshold) continue;
+
+                    // this is the best match so far
+                    threshold = value;
+                    best = j - 1;
+
+                    // we are done if the match is before the location (everything that follows is even further away)
+                    if ((size_t)best <= _location) break;
+
+                    // there is no need to go further back than the same distance on the other side of the location
+                    start = std::max(size_t(1), 2 * _location > (size_t)best ? 2 * _location - best : 1);
+                }
+
+                // no hope for a better match with more errors
+                if (score(d + 1, _location) > threshold) break;
+
+                // the vectors are used for the next number of errors
+                std::swap(_current, _previous);
+            }
+
+            // done
+            return best;
+        }
+    };
+
+public:
+    /**
+     *  Constructor
+     *  @param  limits      the limits with the match settings
+     *  @param  text        the text to search
+     *  @param  size        size of the text
+     *  @param  pattern     the pattern to look for
+     *  @param  length      size of the pattern
+     *  @param  location    the expected location
+     */
+    Match(const Limits &limits, const char *text, size_t size, const char *pattern, size_t length, size_t location)
+    {
+        // the location must be inside the text
+        location = std::min(location, size);
+
+        // an identical text is a match at the start
+        if (size == length && (length == 0 || memcmp(text, pattern, length) == 0)) { _position = 0; return; }
+
+        // nothing can be found in an empty text
+        if (size == 0) return;
+
+        // a perfect match at the location (an empty pattern always matches here)
+        if (location + length <= size && (length == 0 || memcmp(text + location, pattern, length) == 0)) { _position = location; return; }
+
+        // do a fuzzy search
+        Bitap bitap(limits, text, size, pattern, length, location);
+        _position = bitap.search(pattern);
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Match() = default;
+
+    /**
+     *  Position of the match
+     *  @return ssize_t     -1 if no match was found
+     */
+    ssize_t position() const { return _position; }
+
+    /**
+     *  Cast to boolean, was a match found?
+     *  @return bool
+     */
+    operator bool () const { return _position >= 0; }
+    bool operator! () const { return _position < 0; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,411 @@
+/**
+ *  Merge3.h
+ *
+ *  Class for a three-way merge: two versions of a base text (ours and
+ *  theirs) that were edited independently are merged into one text. The
+ *  patches from the base text to both versions are calculated (at the same
+ *  time if there is a thread pool), and their changes are then aligned on
+ *  the offsets in the base text in a single sweep over both patches.
+ *
+ *  A range of the base text that was only changed by one side gets the text
+ *  of that side, and a range that both sides changed in exactly the same way
+ *  gets that text. Changes of both sides that overlap or touch each other
+ *  are a conflict: the merged text then holds our version of the range, and
+ *  the ranges of all three texts are reported, so that the caller can
+ *  resolve it.
+ *
+ *  Only the two patches are calculated concurrently. The sweep that aligns
+ *  them and builds the merged text always runs in the calling thread, after
+ *  both patches are ready, so a pool does not speed up that part.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "ascii.h"
+#include "buffer.h"
+#include "conflict.h"
+#include "limits.h"
+#include "patch.h"
+#include "pool.h"
+#include "task.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t = Ascii>
+class Merge3
+{
+private:
+    /**
+     *  A change of one side: a range of the base text that was replaced by a
+     *  range of the other text (the ranges are byte offsets)
+     */
+    struct Change
+    {
+        /**
+         *  Start and end in the base text
+         *  @var size_t
+         */
+        size_t begin1;
+        size_t end1;
+
+        /**
+         *  Start and end in the version of the side
+         *  @var size_t
+         */
+        size_t begin2;
+        size_t end2;
+    };
+
+    /**
+     *  Task to calculate the patch of their side in an other thread
+     */
+    class Side : public Task
+    {
+    private:
+        /**
+         *  Object with limits / settings for the algorithm
+         *  @var Limits
+         */
+        const Limits &_limits;
+
+        /**
+         *  The texts to compare
+         *  @var text_t
+         */
+        const text_t &_base;
+        const text_t &_version;
+
+        /**
+         *  The thread pool (the patch runs its sub-problems in it too)
+         *  @var Pool
+         */
+        Pool &_pool;
+
+        /**
+         *  Speedup flag
+         *  @var bool
+         */
+        bool _checklines;
+
+        /**
+         *  The calculated patch
+         *  @var std::unique_ptr
+         */
+        std::unique_ptr<Patch<text_t>> _patch;
+
+    protected:
+        /**
+         *  Calculate the patch
+         */
+        virtual void execute() { _patch.reset(new Patch<text_t>(_limits, _base, _version, _pool, _checklines)); }
+
+    public:
+        /**
+         *  Constructor
+         *  @param  limits      object with limits / settings for the algorithm
+         *  @param  base        the base text
+         *  @param  version     the version of the side
+         *  @param  pool        the thread pool
+         *  @param  checklines  speedup flag
+         */
+        Side(const Limits &limits, const text_t &base, const text_t &version, Pool &pool, bool checklines) :
+            _limits(limits), _base(base), _version(version), _pool(pool), _checklines(checklines) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Side() = default;
+
+        /**
+         *  The calculated patch (only valid after the task has finished)
+         *  @return Patch
+         */
+        const Patch<text_t> &patch() const { return *_patch; }
+    };
+
+    /**
+     *  The merged text
+     *  @var std::vector
+     */
+    std::vector<char> _result;
+
+    /**
+     *  The conflicts, in the order of the base text
+     *  @var std::vector
+     */
+    std::vector<Conflict> _conflicts;
+
+    /**
+     *  Number of changes that were merged without a conflict
+     *  @var size_t
+     */
+    size_t _resolved = 0;
+
+    /**
+     *  Collect the changes of a patch: the ranges between its equalities
+     *  @param  patch       the patch from the base text to a version
+     *  @param  changes     the array to fill
+     */
+    static void collect(const Patch<text_t> &patch, std::vector<Change> &changes)
+    {
+        // the position in both texts, and the change that is being collected
+        size_t position1 = 0, position2 = 0;
+        Change change{0, 0, 0, 0};
+
+        // is a change being collected?
+        bool collecting = false;
+
+        // walk over the diffs
+        for (const auto &diff : patch)
+        {
+            // an equality ends the change in front of it
+            if (diff.operation() == Operation::EQUAL)
+            {
+                // store the change
+                if (collecting) { change.end1 = position1; change.end2 = position2; changes.push_back(change); collecting = false; }
+
+                // skip the equal data
+                position1 += diff.bytes(); position2 += diff.bytes();
+                continue;
+            }
+
+            // this could be the start of a change
+            if (!collecting) { change.begin1 = position1; change.begin2 = position2; collecting = true; }
+
+            // update the positions
+            if (diff.operation() == Operation::DELETE) position1 += diff.bytes(); else position2 += diff.bytes();
+        }
+
+        // the change at the end
+        if (collecting) { change.end1 = position1; change.end2 = position2; changes.push_back(change); }
+    }
+
+    /**
+     *  Add data to the merged text
+     *  @param  text        the text with the data
+     *  @param  begin       start of the data
+     *  @param  end         end of the data
+     */
+    void add(const text_t &text, size_t begin, size_t end)
+    {
+        // copy the bytes
+        const char *data = text.buffer().data();
+        _result.insert(_result.end(), data + begin, data + end);
+    }
+
+    /**
+     *  Find the range in the version of a side that corresponds with a range of
+     *  the base text that contains the changes [first, last) of the side
+     *  @param  changes     the changes of the side
+     *  @param  first       index of the first change in the range
+     *  @param  last        index after the last change in the range
+     *  @param  begin1      start of the range in the base text
+     *  @param  end1        end of the range in the base text
+     *  @param  begin2      start of the range in the version (output)
+     *  @param  end2        end of the range in the version (output)
+     */
+    static void range(const std::vector<Change> &changes, size_t first, size_t last, size_t begin1, size_t end1, size_t &begin2, size_t &end2)
+    {
+        // the end of the previous change of the side (the texts are equal from there on)
+        size_t previous1 = first == 0 ? 0 : changes[first - 1].end1;
+        size_t previous2 = first == 0 ? 0 : changes[first - 1].end2;
+
+        // without changes, the range is equal in both texts
+        if (first == last) { begin2 = previous2 + begin1 - previous1; end2 = previous2 + end1 - previous1; return; }
+
+        // the texts are equal in front of the first change and behind the last change
+        begin2 = changes[first].begin2 - (changes[first].begin1 - begin1);
+        end2 = changes[last - 1].end2 + (end1 - changes[last - 1].end1);
+    }
+
+    /**
+     *  Merge the patches of both sides
+     *  @param  base        the base text
+     *  @param  ours        our version
+     *  @param  theirs      their version
+     *  @param  patch1      the patch from the base text to our version
+     *  @param  patch2      the patch from the base text to their version
+     */
+    void merge(const text_t &base, const text_t &ours, const text_t &theirs, const Patch<text_t> &patch1, const Patch<text_t> &patch2)
+    {
+        // the changes of both sides
+        std::vector<Change> changes1, changes2;
+        collect(patch1, changes1);
+        collect(patch2, changes2);
+
+        // room for the result
+        _result.reserve(std::max(ours.bytes(), theirs.bytes()));
+
+        // the next change of both sides, and the position in the base text up to which the merged text is ready
+        size_t next1 = 0, next2 = 0, position = 0;
+
+        // sweep over the changes of both sides in the order of the base text
+        while (next1 < changes1.size() || next2 < changes2.size())
+        {
+            // the group of changes starts at the first remaining change
+            size_t begin = std::min(next1 < changes1.size() ? changes1[next1].begin1 : base.bytes(), next2 < changes2.size() ? changes2[next2].begin1 : base.bytes());
+            size_t end = begin;
+
+            // the changes of both sides that are in the group
+            size_t first1 = next1, first2 = next2;
+
+            // the group grows as long as changes overlap or touch it
+            for (bool grown = true; grown;)
+            {
+                // nothing is added yet
+                grown = false;
+
+                // add the changes of both sides
+                while (next1 < changes1.size() && changes1[next1].begin1 <= end) { end = std::max(end, changes1[next1++].end1); grown = true; }
+                while (next2 < changes2.size() && changes2[next2].begin1 <= end) { end = std::max(end, changes2[next2++].end1); grown = true; }
+            }
+
+            // the base text in front of the group is unchanged
+            add(base, position, begin);
+            position = end;
+
+            // the ranges of the group in both versions
+            size_t begin1, end1, begin2, end2;
+            range(changes1, first1, next1, begin, end, begin1, end1);
+            range(changes2, first2, next2, begin, end, begin2, end2);
+
+            // changes of one side are taken over, and so are identical changes of both sides
+            bool changed1 = next1 > first1, changed2 = next2 > first2;
+            if (!changed2 || (changed1 && end1 - begin1 == end2 - begin2 && memcmp(ours.buffer().data() + begin1, theirs.buffer().data() + begin2, end1 - begin1) == 0))
+            {
+                // take our version
+                add(ours, begin1, end1);
+                _resolved += 1;
+            }
+            else if (!changed1)
+            {
+                // take their version
+                add(theirs, begin2, end2);
+                _resolved += 1;
+            }
+            else
+            {
+                // conflicting changes, our version is put in the merged text
+                _conflicts.emplace_back(begin, end - begin, begin1, end1 - begin1, begin2, end2 - begin2, _result.size());
+                add(ours, begin1, end1);
+            }
+        }
+
+        // the rest of the base text is unchanged
+        add(base, position, base.bytes());
+    }
+
+public:
+    /**
+     *  Merge two versions of a base text
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  base        the base text
+     *  @param  ours        our version
+     *  @param  theirs      their version
+     *  @param  checklines  tuning flag
+     */
+    Merge3(const Limits &limits, const text_t &base, const text_t &ours, const text_t &theirs, bool checklines = true)
+    {
+        // calculate the patches one after the other
+        Patch<text_t> patch1(limits, base, ours, checklines);
+        Patch<text_t> patch2(limits, base, theirs, checklines);
+
+        // merge them
+        merge(base, ours, theirs, patch1, patch2);
+    }
+
+    /**
+     *  Merge two versions of a base text, the patches of both sides are
+     *  calculated at the same time, and their sub-problems run in the pool too
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  base        the base text
+     *  @param  ours        our version
+     *  @param  theirs      their version
+     *  @param  pool        the thread pool
+     *  @param  checklines  tuning flag
+     */
+    Merge3(const Limits &limits, const text_t &base, const text_t &ours, const text_t &theirs, Pool &pool, bool checklines = true)
+    {
+        // their side is handed over to the pool
+        Side side(limits, base, theirs, pool, checklines);
+        pool.push(&side);
+
+        // the task must not outlive this constructor, not even if an exception is thrown
+        try
+        {
+            // calculate our side in the meantime
+            Patch<text_t> patch1(limits, base, ours, pool, checklines);
+
+            // wait for their side (or calculate it ourselves if no other thread picked it up)
+            pool.wait(&side);
+
+            // merge the patches
+            merge(base, ours, theirs, patch1, side.patch());
+        }
+        catch (...)
+        {
+            // wait for the task before the exception is passed on (its own exception is ignored)
+            try { pool.wait(&side); } catch (...) {}
+            throw;
+        }
+    }
+
+    /**
+     *  Merge3 objects are not supposed to be copied
+     *  @param  that
+     */
+    Merge3(const Merge3 &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Merge3() = default;
+
+    /**
+     *  The merged text (with our version of the conflicting ranges)
+     *  @return Buffer
+     */
+    Buffer buffer() const { return Buffer(_result.data(), _result.size(), false); }
+
+    /**
+     *  Were the versions merged without conflicts?
+     *  @return bool
+     */
+    bool clean() const { return _conflicts.empty(); }
+
+    /**
+     *  The conflicts, in the order of the base text
+     *  @return std::vector
+     */
+    const std::vector<Conflict> &conflicts() const { return _conflicts; }
+
+    /**
+     *  Number of changes (or groups of touching changes) that were merged without a conflict
+     *  @return size_t
+     */
+    size_t resolved() const { return _resolved; }
+};
+
+/**
+ *  End of namespace
+ */
+}
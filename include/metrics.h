@@ -0,0 +1,197 @@
+/**
+ *  Metrics.h
+ *
+ *  Class with the numbers of a patch: the number of inserted, deleted and
+ *  equal bytes, and the Levenshtein distance (the number of bytes that are
+ *  inserted, deleted or substituted, an insertion and a deletion at the same
+ *  place count as substitution). These can be calculated directly from two
+ *  texts, without storing the patch: the algorithm runs just like it does for
+ *  a patch, but the diffs only live in the arena, and they are counted
+ *  instead of copied. With the arena of a DiffEngine, this does not allocate
+ *  any memory once the engine has grown to its working size.
+ *
+ *  The numbers are in bytes, also for utf8 texts.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <algorithm>
+#include "arena.h"
+#include "ascii.h"
+#include "diff.h"
+#include "limits.h"
+#include "patch.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Metrics
+{
+private:
+    /**
+     *  Number of inserted, deleted and equal bytes
+     *  @var size_t
+     */
+    size_t _inserted = 0;
+    size_t _deleted = 0;
+    size_t _equal = 0;
+
+    /**
+     *  The Levenshtein distance of the edits before the last equality
+     *  @var size_t
+     */
+    size_t _levenshtein = 0;
+
+    /**
+     *  Number of bytes that were inserted and deleted after the last equality
+     *  @var size_t
+     */
+    size_t _insertion = 0;
+    size_t _deletion = 0;
+
+    /**
+     *  Engines calculate the metrics with their own arena
+     */
+    template <typename> friend class DiffEngine;
+
+    /**
+     *  Count the diffs of a patch
+     *  @param  begin       the first diff
+     *  @param  end         the end of the diffs
+     */
+    template <typename iterator_t>
+    void add(iterator_t begin, iterator_t end)
+    {
+        // count all diffs
+        for (auto iter = begin; iter != end; ++iter) add(iter->operation(), iter->bytes());
+    }
+
+    /**
+     *  Calculate the metrics of two texts
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  tuning flag
+     *  @param  arena       arena for temporary memory (and for the diffs)
+     *  @param  pool        optional thread pool
+     */
+    template <typename text_t>
+    void calculate(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines, Arena &arena, Pool *pool = nullptr)
+    {
+        // run the algorithm, and count the diffs while they are still in the arena
+        Patch<text_t>::calculate(limits, input1, input2, checklines, arena, pool, [this](const std::vector<Diff, Allocator<Diff>> &diffs) {
+            add(diffs.begin(), diffs.end());
+        });
+    }
+
+public:
+    /**
+     *  Constructor for empty metrics, diffs can be added one by one
+     */
+    Metrics() = default;
+
+    /**
+     *  Calculate the metrics of two texts
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  tuning flag
+     */
+    template <typename text_t>
+    Metrics(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines = true)
+    {
+        // arena for all temporary memory
+        Arena arena;
+
+        // run the algorithm
+        calculate(limits, input1, input2, checklines, arena);
+    }
+
+    /**
+     *  Calculate the metrics of two texts, while allocating all temporary memory from an arena
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  arena       arena for temporary memory
+     *  @param  checklines  tuning flag
+     */
+    template <typename text_t>
+    Metrics(const Limits &limits, const text_t &input1, const text_t &input2, Arena &arena, bool checklines = true)
+    {
+        // run the algorithm
+        calculate(limits, input1, input2, checklines, arena);
+    }
+
+    /**
+     *  Calculate the metrics of a patch that already exists
+     *  @param  patch       the patch
+     */
+    template <typename text_t>
+    Metrics(const Patch<text_t> &patch)
+    {
+        // count the diffs
+        add(patch.begin(), patch.end());
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Metrics() = default;
+
+    /**
+     *  Add a diff
+     *  @param  operation   the operation of the diff
+     *  @param  bytes       number of bytes of the diff
+     */
+    void add(Operation operation, size_t bytes)
+    {
+        // check the operation
+        switch (operation) {
+        case Operation::INSERT: _inserted += bytes; _insertion += bytes; break;
+        case Operation::DELETE: _deleted += bytes; _deletion += bytes; break;
+        case Operation::EQUAL:
+            // an equality ends the edits in front of it
+            _equal += bytes; _levenshtein += std::max(_insertion, _deletion); _insertion = _deletion = 0;
+            break;
+        }
+    }
+
+    /**
+     *  Number of inserted, deleted and equal bytes
+     *  @return size_t
+     */
+    size_t inserted() const { return _inserted; }
+    size_t deleted() const { return _deleted; }
+    size_t equal() const { return _equal; }
+
+    /**
+     *  The Levenshtein distance
+     *  @return size_t
+     */
+    size_t levenshtein() const { return _levenshtein + std::max(_insertion, _deletion); }
+
+    /**
+     *  Are the texts identical?
+     *  @return bool
+     */
+    bool identical() const { return _inserted == 0 && _deleted == 0; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,504 @@
+/**
+ *  MiddleSnake.h
+ *
+ *  Class that finds the 'middle snake' of two texts, using the linear space
+ *  algorithm that was described by Eugene Myers in "An O(ND) Difference
+ *  Algorithm and Its Variations". The middle snake splits the problem in
+ *  two halves that can be solved independently.
+ *
+ *  The search works on arrays of fixed-width elements, and it is compiled
+ *  separately for each element type. Snakes are followed one element at a
+ *  time, but once a snake turns out to be longer than a couple of elements,
+ *  the rest is compared with the vectorized mismatch kernels.
+ *
+ *  If the deadline is reached before the snake is found, the search does not
+ *  simply give up, but it reports the furthest points that the front path and
+ *  the reverse path reached. The texts in front of the first point and behind
+ *  the second point can then be diffed separately (these are cheap problems),
+ *  and only the range in between remains unsolved. Once the deadline has
+ *  passed, the searches are limited to a small number of edit steps, so that
+ *  the rest of the patch is still found quickly, although it is not optimal.
+ *
+ *  A search can also pause at the deadline instead of giving up: all state
+ *  of the search is then kept in the object, and the search can be resumed
+ *  later with a new deadline, as if it was never interrupted.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <algorithm>
+#include "deadline.h"
+#include "mismatch.h"
+#include "scratch.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename char_t>
+class MiddleSnake
+{
+private:
+    /**
+     *  Number of diagonals that are processed before the deadline is checked
+     *  @var size_t
+     */
+    static const size_t interval = 4096;
+
+    /**
+     *  Number of elements of a snake that are compared one by one, before the mismatch kernels take over
+     *  @var size_t
+     */
+    static const size_t scalar = 8;
+
+    /**
+     *  Position in the first text where the texts should be split
+     *  @var size_t
+     */
+    size_t _x = 0;
+
+    /**
+     *  Position in the second text where the texts should be split
+     *  @var size_t
+     */
+    size_t _y = 0;
+
+    /**
+     *  Was a middle snake found?
+     *  @var bool
+     */
+    bool _found = false;
+
+    /**
+     *  Where the reverse path ended, if only the furthest points are known
+     *  @var size_t
+     */
+    size_t _endx = 0;
+    size_t _endy = 0;
+
+    /**
+     *  Are only the furthest points known, instead of a real middle snake?
+     *  @var bool
+     */
+    bool _partial = false;
+
+    /**
+     *  Number of edit steps (the D value) that were walked
+     *  @var size_t
+     */
+    size_t _steps = 0;
+
+    /**
+     *  Number of times that the deadline was checked
+     *  @var size_t
+     */
+    size_t _checks = 0;
+
+    /**
+     *  The texts and their number of elements (these are needed to resume the search)
+     *  @var const char_t *
+     *  @var ssize_t
+     */
+    const char_t *_text1;
+    const char_t *_text2;
+    ssize_t _size1;
+    ssize_t _size2;
+
+    /**
+     *  Is the number of edit steps limited because the deadline has passed, and
+     *  the max number of edit steps after the deadline
+     *  @var bool
+     *  @var size_t
+     */
+    bool _limited;
+    size_t _anytime;
+
+    /**
+     *  Max number of edit steps of the search
+     *  @var ssize_t
+     */
+    ssize_t _maxsteps = 0;
+
+    /**
+     *  The V-arrays in the scratch memory, the index of diagonal zero, and their size
+     *  @var ssize_t
+     */
+    ssize_t *_v1 = nullptr;
+    ssize_t *_v2 = nullptr;
+    ssize_t _offset = 0;
+    ssize_t _length = 0;
+
+    /**
+     *  The edit step where the search continues, and the diagonals that are skipped
+     *  at both ends of the k loops because they run beyond the grid
+     *  @var ssize_t
+     */
+    ssize_t _d = 0;
+    ssize_t _k1start = 0;
+    ssize_t _k1end = 0;
+    ssize_t _k2start = 0;
+    ssize_t _k2end = 0;
+
+    /**
+     *  Does the search pause at the deadline instead of giving up, and is it paused?
+     *  @var bool
+     */
+    bool _pausable;
+    bool _paused = false;
+
+    /**
+     *  Remember the split position
+     *  @param  x           position in the first text
+     *  @param  y           position in the second text
+     */
+    void found(ssize_t x, ssize_t y)
+    {
+        // store the position
+        _x = _endx = x; _y = _endy = y; _found = true;
+    }
+
+    /**
+     *  Remember the furthest points that the paths reached, when the search is
+     *  cut short before the middle snake was found. All stored points of the
+     *  V-arrays can be reached (from the begin or from the end), so the best
+     *  one of each of the arrays is used.
+     *  @param  v1          V-array of the front path
+     *  @param  v2          V-array of the reverse path
+     *  @param  offset      index of diagonal zero in the V-arrays
+     *  @param  length      size of the V-arrays
+     *  @param  size1       number of elements of the first text
+     *  @param  size2       number of elements of the second text
+     */
+    void furthest(const ssize_t *v1, const ssize_t *v2, ssize_t offset, ssize_t length, ssize_t size1, ssize_t size2)
+    {
+        // the best points, and the number of elements that they cover
+        ssize_t x1 = 0, y1 = 0, x2 = size1, y2 = size2, best1 = 0, best2 = 0;
+
+        // check all diagonals
+        for (ssize_t i = 0; i < length; ++i)
+        {
+            // the end point of the front path on this diagonal (if it is visited and inside the graph)
+            ssize_t fx = v1[i], fy = fx - (i - offset);
+            if (fx >= 0 && fx <= size1 && fy >= 0 && fy <= size2 && fx + fy > best1) { x1 = fx; y1 = fy; best1 = fx + fy; }
+
+            // the end point of the reverse path (this is counted from the end of the texts)
+            ssize_t rx = v2[i], ry = rx - (i - offset);
+            if (rx >= 0 && rx <= size1 && ry >= 0 && ry <= size2 && rx + ry > best2) { x2 = size1 - rx; y2 = size2 - ry; best2 = rx + ry; }
+        }
+
+        // if the paths met or crossed each other, only the best one is used
+        if (x1 > x2 || y1 > y2 || (x1 == x2 && y1 == y2)) { if (best1 >= best2) { x2 = size1; y2 = size2; } else { x1 = 0; y1 = 0; } }
+
+        // the texts can not be split if the paths did not get anywhere, or if one of them covers everything
+        if (best1 + best2 == 0 || x1 + y1 == size1 + size2 || x2 + y2 == 0) return;
+
+        // store the points
+        _x = x1; _y = y1; _endx = x2; _endy = y2; _found = true; _partial = true;
+    }
+
+    /**
+     *  Count the number of identical elements at the start of two arrays
+     *  @param  data1       first array
+     *  @param  data2       second array
+     *  @param  size        max number of elements to compare
+     *  @return size_t
+     */
+    static size_t forward(const char_t *data1, const char_t *data2, size_t size)
+    {
+        // most snakes are short, so the first elements are compared one by one
+        size_t count = size < scalar ? size : (size_t)scalar;
+        for (size_t i = 0; i < count; ++i) if (data1[i] != data2[i]) return i;
+
+        // the rest of a long snake is compared with the mismatch kernel (this counts bytes)
+        return count + Mismatch::forward((const char *)(data1 + count), (const char *)(data2 + count), (size - count) * sizeof(char_t)) / sizeof(char_t);
+    }
+
+    /**
+     *  Count the number of identical elements at the end of two arrays
+     *  @param  end1        end of the first array
+     *  @param  end2        end of the second array
+     *  @param  size        max number of elements to compare
+     *  @return size_t
+     */
+    static size_t backward(const char_t *end1, const char_t *end2, size_t size)
+    {
+        // most snakes are short, so the last elements are compared one by one
+        size_t count = size < scalar ? size : (size_t)scalar;
+        for (size_t i = 1; i <= count; ++i) if (end1[-(ssize_t)i] != end2[-(ssize_t)i]) return i - 1;
+
+        // the rest of a long snake is compared with the mismatch kernel (this counts bytes)
+        return count + Mismatch::backward((const char *)(end1 - count), (const char *)(end2 - count), (size - count) * sizeof(char_t)) / sizeof(char_t);
+    }
+
+    /**
+     *  Walk the paths, starting at the edit step where the previous call stopped
+     *  @param  deadline    when to give up (or to pause)
+     */
+    void search(const Deadline &deadline)
+    {
+        // the texts and the V-arrays are copied to local variables (the compiler can then keep
+        // them in registers, members could be changed by the stores into the V-arrays)
+        const char_t *text1 = _text1, *text2 = _text2;
+        ssize_t size1 = _size1, size2 = _size2, offset = _offset, length = _length;
+        ssize_t *v1 = _v1, *v2 = _v2;
+
+        // if the total number of characters is odd, the front path will collide
+        // with the reverse path, otherwise the reverse path collides with the front
+        ssize_t delta = size1 - size2;
+        bool front = (delta % 2 != 0);
+
+        // offsets for start and end of k loops, this prevents mapping of space beyond the grid
+        ssize_t k1start = _k1start, k1end = _k1end, k2start = _k2start, k2end = _k2end;
+
+        // number of diagonals processed since the last deadline check
+        size_t work = 0;
+
+        // walk the front path and the reverse path one step at a time
+        for (ssize_t d = _d; d < _maxsteps; ++d)
+        {
+            // one more edit step
+            _steps = d + 1;
+
+            // check the deadline only every now and then, because checking it is expensive
+            if (!_limited && work >= interval)
+            {
+                // count the check
+                ++_checks;
+
+                // is the deadline reached?
+                if (deadline.reached())
+                {
+                    // a search that can be paused remembers where it is, so that it can be resumed later
+                    if (_pausable) { _d = d; _k1start = k1start; _k1end = k1end; _k2start = k2start; _k2end = k2end; _paused = true; return; }
+
+                    // otherwise it gives up (possibly with the furthest points)
+                    if (_anytime > 0) furthest(v1, v2, offset, length, size1, size2);
+                    return;
+                }
+
+                // reset the counter
+                work = 0;
+            }
+
+            // walk the front path one step
+            for (ssize_t k1 = -d + k1start; k1 <= d - k1end; k1 += 2, ++work)
+            {
+                // position in the V-array
+                ssize_t k1offset = offset + k1;
+
+                // do we extend the path from the diagonal above or below?
+                ssize_t x1 = (k1 == -d || (k1 != d && v1[k1offset - 1] < v1[k1offset + 1])) ? v1[k1offset + 1] : v1[k1offset - 1] + 1;
+                ssize_t y1 = x1 - k1;
+
+                // follow the snake as long as the characters are identical
+                if (x1 < size1 && y1 < size2) { ssize_t same = forward(text1 + x1, text2 + y1, std::min(size1 - x1, size2 - y1)); x1 += same; y1 += same; }
+
+                // store the result
+                v1[k1offset] = x1;
+
+                // did we run off the right or the bottom of the graph?
+                if (x1 > size1) k1end += 2;
+                else if (y1 > size2) k1start += 2;
+
+                // do we have to check for an overlap with the reverse path?
+                else if (front)
+                {
+                    // the corresponding diagonal of the reverse path
+                    ssize_t k2offset = offset + delta - k1;
+
+                    // is that diagonal already visited?
+                    if (k2offset < 0 || k2offset >= length || v2[k2offset] == -1) continue;
+
+                    // mirror x2 onto the top-left coordinate system
+                    ssize_t x2 = size1 - v2[k2offset];
+
+                    // leap out if the paths do not overlap
+                    if (x1 < x2) continue;
+
+                    // we found the middle snake
+                    found(x1, y1);
+
+                    // done
+                    return;
+                }
+            }
+
+            // walk the reverse path one step
+            for (ssize_t k2 = -d + k2start; k2 <= d - k2end; k2 += 2, ++work)
+            {
+                // position in the V-array
+                ssize_t k2offset = offset + k2;
+
+                // do we extend the path from the diagonal above or below?
+                ssize_t x2 = (k2 == -d || (k2 != d && v2[k2offset - 1] < v2[k2offset + 1])) ? v2[k2offset + 1] : v2[k2offset - 1] + 1;
+                ssize_t y2 = x2 - k2;
+
+                // follow the snake backwards as long as the characters are identical
+                if (x2 < size1 && y2 < size2) { ssize_t same = backward(text1 + size1 - x2, text2 + size2 - y2, std::min(size1 - x2, size2 - y2)); x2 += same; y2 += same; }
+
+                // store the result
+                v2[k2offset] = x2;
+
+                // did we run off the left or the top of the graph?
+                if (x2 > size1) k2end += 2;
+                else if (y2 > size2) k2start += 2;
+
+                // do we have to check for an overlap with the front path?
+                else if (!front)
+                {
+                    // the corresponding diagonal of the front path
+                    ssize_t k1offset = offset + delta - k2;
+
+                    // is that diagonal already visited?
+                    if (k1offset < 0 || k1offset >= length || v1[k1offset] == -1) continue;
+
+                    // the end point of the front path
+                    ssize_t x1 = v1[k1offset];
+                    ssize_t y1 = offset + x1 - k1offset;
+
+                    // leap out if the paths do not overlap (x2 is mirrored onto the top-left coordinate system)
+                    if (x1 < size1 - x2) continue;
+
+                    // we found the middle snake
+                    found(x1, y1);
+
+                    // done
+                    return;
+                }
+            }
+        }
+
+        // if the number of steps was limited, we only know how far the paths got
+        if (_maxsteps < (size1 + size2 + 1) / 2) furthest(v1, v2, offset, length, size1, size2);
+
+        // if we reach this point, the number of diffs equals the number of characters, no commonality at all
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  text1       elements of the first text
+     *  @param  characters1 number of elements of the first text
+     *  @param  text2       elements of the second text
+     *  @param  characters2 number of elements of the second text
+     *  @param  deadline    when to give up
+     *  @param  scratch     memory for the V-arrays
+     *  @param  anytime     max number of edit steps after the deadline has passed (zero to give up without the furthest points)
+     *  @param  pausable    pause at the deadline instead of giving up, so that the search can be resumed
+     */
+    MiddleSnake(const char_t *text1, size_t characters1, const char_t *text2, size_t characters2, const Deadline &deadline, Scratch &scratch, size_t anytime = 0, bool pausable = false) :
+        _text1(text1), _text2(text2), _size1(characters1), _size2(characters2),
+        _limited(anytime > 0 && deadline.expired()), _anytime(anytime), _pausable(pausable)
+    {
+        // max number of edits that we have to look at (in each direction)
+        ssize_t maxd = (_size1 + _size2 + 1) / 2;
+
+        // once the deadline has passed, only a limited number of edit steps are walked (and the clock is no longer checked)
+        _maxsteps = _limited ? std::min(maxd, (ssize_t)anytime) : maxd;
+
+        // the V-arrays are indexed by diagonal k, which runs from -steps to +steps
+        _offset = _maxsteps;
+        _length = 2 * _maxsteps + 2;
+
+        // get the V-arrays from the scratch memory, and mark all diagonals as unvisited
+        _v1 = scratch.forward(_length);
+        _v2 = scratch.reverse(_length);
+        std::fill(_v1, _v1 + _length, -1);
+        std::fill(_v2, _v2 + _length, -1);
+        _v1[_offset + 1] = 0;
+        _v2[_offset + 1] = 0;
+
+        // walk the front path and the reverse path one step at a time
+        search(deadline);
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~MiddleSnake() = default;
+
+    /**
+     *  Resume a search that was paused at the deadline, the V-arrays are still in the
+     *  scratch memory, so that memory must not have been used in the meantime
+     *  @param  deadline    when to pause again
+     */
+    void resume(const Deadline &deadline)
+    {
+        // leap out if the search is not paused
+        if (!_paused) return;
+
+        // walk on from the edit step where the search was paused
+        _paused = false;
+        search(deadline);
+    }
+
+    /**
+     *  Is the search paused at the deadline? It is then not yet known whether
+     *  there is a middle snake
+     *  @return bool
+     */
+    bool paused() const { return _paused; }
+
+    /**
+     *  Was a middle snake found? If not, the texts have nothing in common,
+     *  or the deadline was reached before the paths got anywhere
+     *  @return bool
+     */
+    bool valid() const { return _found; }
+
+    /**
+     *  Cast to boolean
+     *  @return bool
+     */
+    operator bool () const { return valid(); }
+    bool operator! () const { return !valid(); }
+
+    /**
+     *  The positions (in characters) where the two texts should be split
+     *  @return size_t
+     */
+    size_t x() const { return _x; }
+    size_t y() const { return _y; }
+
+    /**
+     *  Was the search cut short? The texts are then not split in two, but in
+     *  three: the part up to x() and y() can be reached by the front path, the
+     *  part from endx() and endy() by the reverse path, and the part in between
+     *  is still unknown
+     *  @return bool
+     */
+    bool partial() const { return _partial; }
+
+    /**
+     *  The positions (in characters) where the reverse path ended, for a real
+     *  middle snake these are the same as x() and y()
+     *  @return size_t
+     */
+    size_t endx() const { return _endx; }
+    size_t endy() const { return _endy; }
+
+    /**
+     *  Number of edit steps that were walked, and the number of deadline checks
+     *  @return size_t
+     */
+    size_t steps() const { return _steps; }
+    size_t checks() const { return _checks; }
+};
+
+/**
+ *  End of namespace
+ */
+}
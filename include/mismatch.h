@@ -0,0 +1,412 @@
+/**
+ *  Mismatch.h
+ *
+ *  Kernels to count the number of identical bytes at the start or at the
+ *  end of two byte buffers. These are used to calculate the common prefix
+ *  and common suffix of text types that store their characters in a
+ *  contiguous buffer. Depending on the CPU, the buffers are compared 64, 32
+ *  or 16 bytes at a time with vector instructions, or 8 bytes at a time
+ *  with ordinary 64-bit integers. The best kernel is selected at runtime.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+/**
+ *  Vector instructions that we can use
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DIFF_MISMATCH_X86 1
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define DIFF_MISMATCH_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Mismatch
+{
+private:
+    /**
+     *  Signature of a kernel
+     *  @param  data1       first buffer
+     *  @param  data2       second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    typedef size_t (*kernel_t)(const char *data1, const char *data2, size_t size);
+
+    /**
+     *  Load 8 bytes from memory
+     *  @param  data
+     *  @return uint64_t
+     */
+    static uint64_t load(const char *data)
+    {
+        // memcpy() takes care of unaligned access, and is optimized away
+        uint64_t result; memcpy(&result, data, sizeof(result)); return result;
+    }
+
+    /**
+     *  Number of identical bytes at the start of two 64 bit words that differ
+     *  @param  difference  the two words xor'ed
+     *  @return size_t
+     */
+    static size_t leading(uint64_t difference)
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return __builtin_ctzll(difference) / 8;
+#else
+        return __builtin_clzll(difference) / 8;
+#endif
+    }
+
+    /**
+     *  Number of identical bytes at the end of two 64 bit words that differ
+     *  @param  difference  the two words xor'ed
+     *  @return size_t
+     */
+    static size_t trailing(uint64_t difference)
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return __builtin_clzll(difference) / 8;
+#else
+        return __builtin_ctzll(difference) / 8;
+#endif
+    }
+
+    /**
+     *  The portable kernel that compares the start of two buffers 8 bytes at a time
+     *  @param  data1       first buffer
+     *  @param  data2       second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    static size_t forwardWords(const char *data1, const char *data2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 8 bytes at a time
+        for (; result + 8 <= size; result += 8)
+        {
+            // compare the words
+            uint64_t difference = load(data1 + result) ^ load(data2 + result);
+
+            // leap out on the first difference
+            if (difference != 0) return result + leading(difference);
+        }
+
+        // compare the remaining bytes one at a time
+        while (result < size && data1[result] == data2[result]) ++result;
+
+        // done
+        return result;
+    }
+
+    /**
+     *  The portable kernel that compares the end of two buffers 8 bytes at a time
+     *  @param  end1        end of the first buffer
+     *  @param  end2        end of the second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    static size_t backwardWords(const char *end1, const char *end2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 8 bytes at a time
+        for (; result + 8 <= size; result += 8)
+        {
+            // compare the words
+            uint64_t difference = load(end1 - result - 8) ^ load(end2 - result - 8);
+
+            // leap out on the first difference
+            if (difference != 0) return result + trailing(difference);
+        }
+
+        // compare the remaining bytes one at a time
+        while (result < size && end1[-1 - (ssize_t)result] == end2[-1 - (ssize_t)result]) ++result;
+
+        // done
+        return result;
+    }
+
+#if DIFF_MISMATCH_X86
+    /**
+     *  The SSE2 kernel that compares the start of two buffers 16 bytes at a time
+     *  @param  data1       first buffer
+     *  @param  data2       second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    __attribute__((target("sse2")))
+    static size_t forwardSSE2(const char *data1, const char *data2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 16 bytes at a time
+        for (; result + 16 <= size; result += 16)
+        {
+            // compare the bytes, and get a bitmask with a bit set for each identical byte
+            __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data1 + result)), _mm_loadu_si128((const __m128i *)(data2 + result)));
+            unsigned mask = _mm_movemask_epi8(equal) ^ 0xffff;
+
+            // leap out on the first difference
+            if (mask != 0) return result + __builtin_ctz(mask);
+        }
+
+        // process the remaining bytes
+        return result + forwardWords(data1 + result, data2 + result, size - result);
+    }
+
+    /**
+     *  The SSE2 kernel that compares the end of two buffers 16 bytes at a time
+     *  @param  end1        end of the first buffer
+     *  @param  end2        end of the second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    __attribute__((target("sse2")))
+    static size_t backwardSSE2(const char *end1, const char *end2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 16 bytes at a time
+        for (; result + 16 <= size; result += 16)
+        {
+            // compare the bytes, and get a bitmask with a bit set for each different byte
+            __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(end1 - result - 16)), _mm_loadu_si128((const __m128i *)(end2 - result - 16)));
+            unsigned mask = _mm_movemask_epi8(equal) ^ 0xffff;
+
+            // leap out on the first difference (the mask has 16 meaningful bits)
+            if (mask != 0) return result + __builtin_clz(mask) - 16;
+        }
+
+        // process the remaining bytes
+        return result + backwardWords(end1 - result, end2 - result, size - result);
+    }
+
+    /**
+     *  The AVX2 kernel that compares the start of two buffers 64 bytes at a time
+     *  @param  data1       first buffer
+     *  @param  data2       second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    __attribute__((target("avx2")))
+    static size_t forwardAVX2(const char *data1, const char *data2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 64 bytes at a time
+        for (; result + 64 <= size; result += 64)
+        {
+            // compare two times 32 bytes
+            __m256i equal1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data1 + result)), _mm256_loadu_si256((const __m256i *)(data2 + result)));
+            __m256i equal2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data1 + result + 32)), _mm256_loadu_si256((const __m256i *)(data2 + result + 32)));
+
+            // combine into one bitmask with a bit set for each different byte
+            uint64_t mask = ~(((uint64_t)(uint32_t)_mm256_movemask_epi8(equal2) << 32) | (uint32_t)_mm256_movemask_epi8(equal1));
+
+            // leap out on the first difference
+            if (mask != 0) return result + __builtin_ctzll(mask);
+        }
+
+        // compare 32 bytes
+        if (result + 32 <= size)
+        {
+            // compare the bytes, and get a bitmask with a bit set for each different byte
+            __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data1 + result)), _mm256_loadu_si256((const __m256i *)(data2 + result)));
+            uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(equal);
+
+            // leap out on the first difference
+            if (mask != 0) return result + __builtin_ctz(mask);
+
+            // the bytes were identical
+            result += 32;
+        }
+
+        // process the remaining bytes
+        return result + forwardSSE2(data1 + result, data2 + result, size - result);
+    }
+
+    /**
+     *  The AVX2 kernel that compares the end of two buffers 64 bytes at a time
+     *  @param  end1        end of the first buffer
+     *  @param  end2        end of the second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    __attribute__((target("avx2")))
+    static size_t backwardAVX2(const char *end1, const char *end2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 64 bytes at a time
+        for (; result + 64 <= size; result += 64)
+        {
+            // compare two times 32 bytes (the second comparison is closest to the end)
+            __m256i equal1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(end1 - result - 64)), _mm256_loadu_si256((const __m256i *)(end2 - result - 64)));
+            __m256i equal2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(end1 - result - 32)), _mm256_loadu_si256((const __m256i *)(end2 - result - 32)));
+
+            // combine into one bitmask with a bit set for each different byte
+            uint64_t mask = ~(((uint64_t)(uint32_t)_mm256_movemask_epi8(equal2) << 32) | (uint32_t)_mm256_movemask_epi8(equal1));
+
+            // leap out on the first difference
+            if (mask != 0) return result + __builtin_clzll(mask);
+        }
+
+        // process the remaining bytes
+        return result + backwardSSE2(end1 - result, end2 - result, size - result);
+    }
+
+    /**
+     *  Select the best kernel for the CPU that we run on
+     *  @return kernel_t
+     */
+    static kernel_t selectForward() { return __builtin_cpu_supports("avx2") ? forwardAVX2 : forwardSSE2; }
+    static kernel_t selectBackward() { return __builtin_cpu_supports("avx2") ? backwardAVX2 : backwardSSE2; }
+
+#elif DIFF_MISMATCH_NEON
+    /**
+     *  Get a bitmask with four bits set for each different byte
+     *  @param  equal       result of a vector comparison
+     *  @return uint64_t
+     */
+    static uint64_t differences(uint8x16_t equal)
+    {
+        // narrow each byte to four bits
+        return ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(equal), 4)), 0);
+    }
+
+    /**
+     *  The NEON kernel that compares the start of two buffers 16 bytes at a time
+     *  @param  data1       first buffer
+     *  @param  data2       second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    static size_t forwardNEON(const char *data1, const char *data2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 16 bytes at a time
+        for (; result + 16 <= size; result += 16)
+        {
+            // compare the bytes
+            uint64_t mask = differences(vceqq_u8(vld1q_u8((const uint8_t *)data1 + result), vld1q_u8((const uint8_t *)data2 + result)));
+
+            // leap out on the first difference
+            if (mask != 0) return result + __builtin_ctzll(mask) / 4;
+        }
+
+        // process the remaining bytes
+        return result + forwardWords(data1 + result, data2 + result, size - result);
+    }
+
+    /**
+     *  The NEON kernel that compares the end of two buffers 16 bytes at a time
+     *  @param  end1        end of the first buffer
+     *  @param  end2        end of the second buffer
+     *  @param  size        number of bytes to compare
+     *  @return size_t      number of identical bytes
+     */
+    static size_t backwardNEON(const char *end1, const char *end2, size_t size)
+    {
+        // number of identical bytes
+        size_t result = 0;
+
+        // compare 16 bytes at a time
+        for (; result + 16 <= size; result += 16)
+        {
+            // compare the bytes
+            uint64_t mask = differences(vceqq_u8(vld1q_u8((const uint8_t *)end1 - result - 16), vld1q_u8((const uint8_t *)end2 - result - 16)));
+
+            // leap out on the first difference
+            if (mask != 0) return result + __builtin_clzll(mask) / 4;
+        }
+
+        // process the remaining bytes
+        return result + backwardWords(end1 - result, end2 - result, size - result);
+    }
+
+    /**
+     *  Select the best kernel for the CPU that we run on (every aarch64 cpu has neon)
+     *  @return kernel_t
+     */
+    static kernel_t selectForward() { return forwardNEON; }
+    static kernel_t selectBackward() { return backwardNEON; }
+
+#else
+    /**
+     *  Select the best kernel for the CPU that we run on (no vector instructions available)
+     *  @return kernel_t
+     */
+    static kernel_t selectForward() { return forwardWords; }
+    static kernel_t selectBackward() { return backwardWords; }
+#endif
+
+public:
+    /**
+     *  Count the number of identical bytes at the start of two buffers
+     *  @param  data1       first buffer
+     *  @param  data2       second buffer
+     *  @param  size        max number of bytes to compare
+     *  @return size_t
+     */
+    static size_t forward(const char *data1, const char *data2, size_t size)
+    {
+        // the kernel is selected only once
+        static const kernel_t kernel = selectForward();
+
+        // run the kernel
+        return kernel(data1, data2, size);
+    }
+
+    /**
+     *  Count the number of identical bytes at the end of two buffers
+     *  @param  end1        end of the first buffer
+     *  @param  end2        end of the second buffer
+     *  @param  size        max number of bytes to compare
+     *  @return size_t
+     */
+    static size_t backward(const char *end1, const char *end2, size_t size)
+    {
+        // the kernel is selected only once
+        static const kernel_t kernel = selectBackward();
+
+        // run the kernel
+        return kernel(end1, end2, size);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -21,7 +21,7 @@ namespace DIFF {
 /**
  *  The enumeration class
  */
-enum class Operation {
+enum class Operation : unsigned char {
     INSERT,
     DELETE,
     EQUAL
@@ -1,7 +1,10 @@
 /**
  *  Patch.h
  *
- *  A patch is a list of diffs.
+ *  A patch is a list of diffs, stored in a contiguous array. The diffs do
+ *  not hold any data themselves, they refer to ranges in the two inputs of
+ *  the patch. This means that the inputs should stay in scope for as long
+ *  as the data of the diffs is accessed.
  *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
@@ -15,14 +18,35 @@
 /**
  *  Dependencies
  */
-#include <list>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "arena.h"
 #include "ascii.h"
+#include "bitparallel.h"
+#include "cleanup.h"
 #include "diff.h"
+#include "dirtyrange.h"
+#include "limits.h"
 #include "commonprefix.h"
 #include "commonsuffix.h"
 #include "commonoverlap.h"
 #include "deadline.h"
+#include "elements.h"
+#include "fingerprint.h"
 #include "halfmatch.h"
+#include "histogram.h"
+#include "middlesnake.h"
+#include "patience.h"
+#include "pool.h"
+#include "prescreen.h"
+#include "scratch.h"
+#include "stats.h"
+#include "tokenizer.h"
+#include "tokens.h"
+#include "utf8.h"
 
 /**
  *  Begin of namespace
@@ -32,16 +56,145 @@ namespace DIFF {
 /**
  *  Class definition
  */
-template <typename text_t = Ascii, typename char_t = char>
+template <typename text_t = Ascii, typename char_t = typename Elements<text_t>::type>
 class Patch
 {
 private:
     /**
-     *  A patch consists of a serie of diffs
-     *  @var std::list
+     *  The middle snake search compares elements of this type
      */
-    std::list<Diff> _diffs;
-    
+    static_assert(std::is_same<char_t, typename Elements<text_t>::type>::value, "char_t must be the element type of the text");
+
+    /**
+     *  The base input (this is not a copy, but a view on the original data, a
+     *  utf8 input also shares the index of the original text)
+     *  @var text_t
+     */
+    text_t _input1;
+
+    /**
+     *  The input to compare (this is not a copy either)
+     *  @var text_t
+     */
+    text_t _input2;
+
+    /**
+     *  A patch consists of a serie of diffs (for sub-patches, these are allocated
+     *  from the arena, for the top-level patch from the heap)
+     *  @var std::vector
+     */
+    std::vector<Diff, Allocator<Diff>> _diffs;
+
+    /**
+     *  Number of bytes of the first and second input that are covered by the diffs
+     *  that were added so far (this is where the next diff is going to start)
+     *  @var size_t
+     */
+    size_t _size1 = 0;
+    size_t _size2 = 0;
+
+    /**
+     *  Patches over other text types (like the line tokens) are our friends
+     */
+    template <typename, typename> friend class Patch;
+
+    /**
+     *  Batches calculate many sub-patches, and copy their diffs
+     */
+    template <typename> friend class BatchDiff;
+
+    /**
+     *  Engines construct empty patches, and calculate them with their own arena
+     */
+    template <typename> friend class DiffEngine;
+
+    /**
+     *  Resumable diffs build their patch step by step
+     */
+    template <typename> friend class ResumableDiff;
+
+    /**
+     *  Metrics count the diffs without copying them
+     */
+    friend class Metrics;
+
+    /**
+     *  Task to calculate a sub-patch in an other thread. Each task has its own
+     *  working memory, because the scratch memory of the parent is still in use.
+     */
+    class Part : public Task
+    {
+    private:
+        /**
+         *  Object with limits / settings for the algorithm
+         *  @var Limits
+         */
+        const Limits &_limits;
+
+        /**
+         *  The texts to compare
+         *  @var text_t
+         */
+        text_t _text1;
+        text_t _text2;
+
+        /**
+         *  Speedup flag
+         *  @var bool
+         */
+        bool _checklines;
+
+        /**
+         *  Time when the algorithm should stop
+         *  @var Deadline
+         */
+        const Deadline &_deadline;
+
+        /**
+         *  Working memory of the task
+         *  @var Arena
+         *  @var Scratch
+         */
+        Arena _arena;
+        Scratch _scratch;
+
+        /**
+         *  The calculated patch
+         *  @var std::unique_ptr
+         */
+        std::unique_ptr<Patch> _patch;
+
+    protected:
+        /**
+         *  Calculate the patch
+         */
+        virtual void execute() { _patch.reset(new Patch(_limits, _text1, _text2, _checklines, _deadline, _scratch)); }
+
+    public:
+        /**
+         *  Constructor
+         *  @param  limits      object with limits / settings for the algorithm
+         *  @param  text1       the base string
+         *  @param  text2       the string to compare
+         *  @param  checklines  speedup flag
+         *  @param  deadline    time when the algorithm should stop
+         *  @param  parent      working memory of the parent (for the pool, the stats and the level of the recursion)
+         */
+        Part(const Limits &limits, const text_t &text1, const text_t &text2, bool checklines, const Deadline &deadline, Scratch &parent) :
+            _limits(limits), _text1(text1), _text2(text2), _checklines(checklines), _deadline(deadline), _scratch(_arena, parent.pool(), parent.stats(), parent.depth()) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Part() = default;
+
+        /**
+         *  The calculated patch (only valid after the task has finished)
+         *  @return Patch
+         */
+        const Patch &patch() const { return *_patch; }
+    };
+
 
 private:
     /**
@@ -52,92 +205,824 @@ private:
      *  @param  input2      the string to compare
      *  @param  checklines  speedup flag
      *  @param  deadline    time when the algorithm should stop
+     *  @param  scratch     working memory shared with the parent patch
+     */
+    Patch(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines, const Deadline &deadline, Scratch &scratch) :
+        _input1(input1),
+        _input2(input2),
+        _diffs(Allocator<Diff>(&scratch.arena()))
+    {
+        // one level deeper into the recursion
+        scratch.descend();
+
+        // run the algorithm
+        initialize(limits, input1, input2, checklines, deadline, scratch);
+
+        // back to the level of the parent
+        scratch.ascend();
+    }
+
+    /**
+     *  Constructor for a patch that is not yet calculated
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     */
+    Patch(const text_t &input1, const text_t &input2) :
+        _input1(input1),
+        _input2(input2) {}
+
+    /**
+     *  Record how a (sub)patch was resolved
+     *  @param  scratch     working memory with the optional stats
+     *  @param  shortcut    the shortcut that resolved the patch
+     */
+    static void resolved(Scratch &scratch, Stats::Shortcut shortcut)
+    {
+        // only if there is a stats object
+        if (Stats *stats = scratch.stats()) stats->resolve(shortcut);
+    }
+
+    /**
+     *  Record the stats of a top-level patch that are only known when it is ready
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  deadline    the deadline of the patch
+     *  @param  copying     the number of bytes copied by the buffers of this thread when the patch started
+     */
+    static void finished(const Limits &limits, const Deadline &deadline, size_t copying)
+    {
+        // leap out if nothing is recorded
+        if (limits.stats == nullptr) return;
+
+        // did the deadline fire?
+        if (deadline.expired()) limits.stats->expire();
+
+        // the bytes that were copied in the meantime
+        limits.stats->copy(Stats::copying() - copying);
+    }
+
+    /**
+     *  Calculate the diff, this is called from the constructors of all (sub)patches
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  speedup flag
+     *  @param  deadline    time when the algorithm should stop
+     *  @param  scratch     working memory for the algorithm
      */
-    Patch(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines, const Deadline &deadline)
+    void initialize(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines, const Deadline &deadline, Scratch &scratch)
     {
-        // are the two inputs identical?
+        // are the two inputs identical? (if both texts are empty, than the diff can be empty)
         if (input1 == input2)
         {
-            // if both texts are empty, than the diff can be empty
-            if (input1.bytes() == 0) return;
-            
-            // there is one operation
-            _diffs.emplace_back(Operation::EQUAL, input1.buffer());
+            // record how the patch was resolved
+            resolved(scratch, Stats::Shortcut::IDENTICAL);
+
+            // the texts are equal
+            return append(Operation::EQUAL, input1.bytes());
         }
-        else
+
+        // calculate the common prefix of the two texts
+        CommonPrefix<text_t> prefix(input1, input2);
+
+        // the texts that remain after the prefix is removed
+        text_t remain1(input1.substr(prefix.characters()));
+        text_t remain2(input2.substr(prefix.characters()));
+
+        // calculate the common suffix of the remaining texts
+        CommonSuffix<text_t> suffix(remain1, remain2);
+
+        // if there is a common prefix, it should be added to the  diffs
+        append(Operation::EQUAL, prefix.bytes());
+
+        // run the algorithm for the strings inside the common prefix and suffix
+        compute(limits, remain1.substr(0, remain1.characters() - suffix.characters()), remain2.substr(0, remain2.characters() - suffix.characters()), checklines, deadline, scratch);
+
+        // common suffix should also be added
+        append(Operation::EQUAL, suffix.bytes());
+
+        // normalize the _diffs member
+        normalize(scratch.stats());
+    }
+
+    /**
+     *  Calculate the diff of the top-level patch
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  speedup flag
+     *  @param  arena       arena for temporary memory
+     *  @param  pool        optional thread pool to run sub-problems in parallel
+     */
+    void calculate(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines, Arena &arena, Pool *pool = nullptr)
+    {
+        // run the algorithm, and copy the diffs to the heap (with a single allocation), so that the arena can be reset
+        calculate(limits, input1, input2, checklines, arena, pool, [this](const std::vector<Diff, Allocator<Diff>> &diffs) {
+            _diffs.assign(diffs.begin(), diffs.end());
+        });
+    }
+
+    /**
+     *  Calculate the diffs of a top-level patch, and pass them to a callback
+     *  while they are still in the arena (they are not stored anywhere else)
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  speedup flag
+     *  @param  arena       arena for temporary memory
+     *  @param  pool        optional thread pool to run sub-problems in parallel
+     *  @param  callback    function that is called with the diffs
+     */
+    template <typename callback_t>
+    static void calculate(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines, Arena &arena, Pool *pool, const callback_t &callback)
+    {
+        // working memory that is shared by all recursive steps
+        Scratch scratch(arena, pool, limits.stats);
+
+        // the time when the algorithm should stop, and the bytes copied so far
+        Deadline deadline(limits.deadline());
+        size_t copying = Stats::copying();
+
+        // run the algorithm, the result is stored in the arena too
+        Patch<text_t> result(limits, input1, input2, checklines, deadline, scratch);
+
+        // run the optional cleanup passes (these are not needed for the sub-patches)
+        result.cleanup(limits);
+
+        // pass on the diffs
+        callback(result._diffs);
+
+        // record the stats
+        finished(limits, deadline, copying);
+    }
+
+    /**
+     *  Try to calculate the top-level patch with the fingerprints of the texts:
+     *  unrelated texts are replaced as a whole (see Prescreen)
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  fingerprint1    fingerprint of the base string
+     *  @param  fingerprint2    fingerprint of the string to compare
+     *  @return bool        was the patch calculated?
+     */
+    bool prescreen(const Limits &limits, const text_t &input1, const text_t &input2, const Fingerprint &fingerprint1, const Fingerprint &fingerprint2)
+    {
+        // the algorithm runs for texts that are not known to be unrelated
+        if (!Prescreen(limits, input1.bytes(), fingerprint1, input2.bytes(), fingerprint2).unrelated()) return false;
+
+        // record how the patch was resolved
+        if (limits.stats) limits.stats->resolve(Stats::Shortcut::DISSIMILAR);
+
+        // the texts are unrelated
+        append(Operation::DELETE, input1.bytes());
+        append(Operation::INSERT, input2.bytes());
+        return true;
+    }
+
+    /**
+     *  Calculate the diff of the top-level patch over the tokens of a tokenizer
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  tokenizer   the tokenizer that splits the texts
+     *  @param  arena       arena for temporary memory
+     */
+    void calculate(const Limits &limits, const text_t &input1, const text_t &input2, const Tokenizer &tokenizer, Arena &arena)
+    {
+        // working memory for the algorithm
+        Scratch scratch(arena, nullptr, limits.stats);
+
+        // the time when the algorithm should stop, and the bytes copied so far
+        Deadline deadline(limits.deadline());
+        size_t copying = Stats::copying();
+
+        // the tokens of the two texts (they share the dictionary, so that identical tokens get identical ids)
+        Lines &tokens1 = scratch.lines1();
+        Lines &tokens2 = scratch.lines2();
+
+        // split the texts
+        tokens1.assign(input1.buffer(), scratch.dictionary(), tokenizer);
+        tokens2.assign(input2.buffer(), scratch.dictionary(), tokenizer);
+
+        // calculate the diff over the tokens
+        Patch<Tokens> tokens(limits, tokens1.tokens(), tokens2.tokens(), false, deadline, scratch);
+
+        // run the optional cleanup passes over the tokens
+        tokens.cleanup(limits);
+
+        // room for the result
+        _diffs.reserve(tokens._diffs.size());
+
+        // current token in both texts
+        size_t token1 = 0, token2 = 0;
+
+        // convert the token-diffs into byte ranges
+        for (const auto &diff : tokens._diffs)
         {
-            // calculate the comming prefix and common suffix of the two texts
-            CommonPrefix<text_t> prefix(input1, input2);
-            CommonSuffix<text_t> suffix(input1.substr(prefix.characters()), input2.substr(prefix.characters()));
-        
-            // if there is a common prefix, it should be added to the  diffs
-            if (prefix.characters() > 0) _diffs.emplace_back(Operation::EQUAL, prefix.buffer());
-            
-            // amount of common data
-            size_t common = prefix.characters() + suffix.characters();
-            
-            // run the algorithm for the strings inside the common prefix and suffix
-            compute(limits, input1.substr(prefix.characters(), common), input2.substr(prefix.characters(), common), checklines, deadline);
-        
-            // common suffix should also be added
-            if (suffix.characters() > 0) _diffs.emplace_back(Operation::EQUAL, suffix.buffer());
-            
-            // optimize the _diffs member
-            optimize();
+            // number of tokens in this diff
+            size_t count = diff.bytes() / sizeof(uint32_t);
+
+            // inserted tokens come from the second text, the others from the first
+            if (diff.operation() == Operation::INSERT) append(diff.operation(), tokens2.offset(token2 + count) - tokens2.offset(token2));
+            else append(diff.operation(), tokens1.offset(token1 + count) - tokens1.offset(token1));
+
+            // update the positions
+            if (diff.operation() != Operation::INSERT) token1 += count;
+            if (diff.operation() != Operation::DELETE) token2 += count;
         }
+
+        // record the stats
+        finished(limits, deadline, copying);
     }
-    
+
+    /**
+     *  Add a diff to the end of the patch, and merge it with the previous diff if
+     *  that has the same operation
+     *  @param  operation   the operation
+     *  @param  bytes       number of bytes
+     */
+    void extend(Operation operation, size_t bytes)
+    {
+        // empty diffs are not stored, and other operations are appended
+        if (bytes == 0 || _diffs.empty() || _diffs.back().operation() != operation) return append(operation, bytes);
+
+        // grow the previous diff
+        _diffs.back().append(bytes);
+
+        // update the number of bytes that have been covered
+        if (operation != Operation::INSERT) _size1 += bytes;
+        if (operation != Operation::DELETE) _size2 += bytes;
+    }
+
+    /**
+     *  Calculate the diff of the top-level patch after an edit, by updating the
+     *  diffs of the patch before the edit
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  patch       the patch before the edit
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare (after the edit)
+     *  @param  offset      byte offset of the edit in the second input
+     *  @param  removed     number of bytes that were removed from the second input
+     *  @param  inserted    number of bytes that were inserted instead
+     *  @param  checklines  speedup flag
+     *  @param  arena       arena for temporary memory
+     */
+    void update(const Limits &limits, const Patch &patch, const text_t &input1, const text_t &input2, size_t offset, size_t removed, size_t inserted, bool checklines, Arena &arena)
+    {
+        // the diffs before the edit
+        const auto &diffs = patch._diffs;
+
+        // the part of the patch that has to be recalculated
+        DirtyRange<text_t> range(diffs, input2, input1.bytes(), patch._input2.bytes(), offset, removed, inserted, limits.editcontext);
+
+        // room for the result
+        _diffs.reserve(diffs.size() + 8);
+
+        // the diffs in front of the dirty range are kept
+        if (range.last() < diffs.size())
+        {
+            // copy the diffs, and the part of the equal diff that was cut off
+            for (size_t i = 0; i < range.last(); ++i) extend(diffs[i].operation(), diffs[i].bytes());
+            extend(Operation::EQUAL, range.cut());
+        }
+
+        // working memory for the dirty range
+        Scratch scratch(arena, nullptr, limits.stats);
+
+        // the time when the algorithm should stop, and the bytes copied so far
+        Deadline deadline(limits.deadline());
+        size_t copying = Stats::copying();
+
+        // recalculate the dirty range (the optional cleanup passes only run over this range)
+        Patch<text_t> dirty(limits, Elements<text_t>::substring(input1, range.begin1(), range.end1() - range.begin1()), Elements<text_t>::substring(input2, range.begin2(), range.end2() - range.begin2()), checklines, deadline, scratch);
+        dirty.cleanup(limits);
+
+        // record the stats
+        finished(limits, deadline, copying);
+
+        // add to the result
+        for (const auto &diff : dirty._diffs) extend(diff.operation(), diff.bytes());
+
+        // leap out if there is nothing after the dirty range
+        if (range.first() == diffs.size()) return;
+
+        // the rest of the equal diff that was cut off, and the diffs after it are kept
+        extend(Operation::EQUAL, diffs[range.first()].bytes() - range.resume());
+        for (size_t i = range.first() + 1; i < diffs.size(); ++i) extend(diffs[i].operation(), diffs[i].bytes());
+    }
+
 public:
     /**
      *  Calculate the patch to transform one string into an other string
-     * 
+     *
      *  If checklines is set to true, we run a slighly less optimal algorithm
      *  that is a little faster. If set to false, we first run a line-level
      *  diff to identify changed areas.
-     * 
+     *
      *  @param  limits      object with limits / settings for the algorithm
      *  @param  input1      the base string
      *  @param  input2      the string to compare
      *  @param  checklines  tuning flag
      */
     Patch(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines = true) :
-        Patch(limits, input1, input2, checklines, limits.deadline()) {}
-    
+        _input1(input1),
+        _input2(input2)
+    {
+        // arena for all temporary memory
+        Arena arena;
+
+        // run the algorithm
+        calculate(limits, input1, input2, checklines, arena);
+    }
+
+    /**
+     *  Calculate the patch, while allocating all temporary memory from an arena
+     *
+     *  The diffs of the patch itself are not stored in the arena, so the arena can
+     *  be reset (or reused for the next patch) as soon as the constructor returns.
+     *
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  arena       arena for temporary memory
+     *  @param  checklines  tuning flag
+     */
+    Patch(const Limits &limits, const text_t &input1, const text_t &input2, Arena &arena, bool checklines = true) :
+        _input1(input1),
+        _input2(input2)
+    {
+        // run the algorithm
+        calculate(limits, input1, input2, checklines, arena);
+    }
+
+    /**
+     *  Calculate the patch, and run the independent sub-problems in parallel
+     *
+     *  The halves that remain after a half-match or after the middle snake has been
+     *  found are pushed to the thread pool if both are at least limits.forksize
+     *  characters big. The result is the same as when no pool is used.
+     *
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  pool        the thread pool
+     *  @param  checklines  tuning flag
+     */
+    Patch(const Limits &limits, const text_t &input1, const text_t &input2, Pool &pool, bool checklines = true) :
+        _input1(input1),
+        _input2(input2)
+    {
+        // arena for all temporary memory of the current thread
+        Arena arena;
+
+        // run the algorithm
+        calculate(limits, input1, input2, checklines, arena, &pool);
+    }
+
+    /**
+     *  Calculate the patch with the fingerprints of the inputs. If they estimate
+     *  that the texts are less similar than limits.similarity, the first text is
+     *  replaced by the second one as a whole. Otherwise the normal algorithm runs
+     *  (this also happens if a fingerprint has the wrong size).
+     *
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  fingerprint1    fingerprint of the base string
+     *  @param  input2      the string to compare
+     *  @param  fingerprint2    fingerprint of the string to compare
+     *  @param  checklines  tuning flag
+     */
+    Patch(const Limits &limits, const text_t &input1, const Fingerprint &fingerprint1, const text_t &input2, const Fingerprint &fingerprint2, bool checklines = true) :
+        _input1(input1),
+        _input2(input2)
+    {
+        // leap out if the fingerprints are enough
+        if (prescreen(limits, input1, input2, fingerprint1, fingerprint2)) return;
+
+        // arena for all temporary memory
+        Arena arena;
+
+        // run the algorithm
+        calculate(limits, input1, input2, checklines, arena);
+    }
+
+    /**
+     *  Calculate the patch over tokens instead of characters, for example over
+     *  words or html tags. The diffs hold the byte ranges of the tokens in the
+     *  original texts, so an inserted or deleted token is never split up.
+     *
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  tokenizer   the tokenizer that splits the texts
+     */
+    Patch(const Limits &limits, const text_t &input1, const text_t &input2, const Tokenizer &tokenizer) :
+        _input1(input1),
+        _input2(input2)
+    {
+        // arena for all temporary memory
+        Arena arena;
+
+        // run the algorithm
+        calculate(limits, input1, input2, tokenizer, arena);
+    }
+
+    /**
+     *  Calculate the patch over tokens, while allocating all temporary memory from an arena
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  tokenizer   the tokenizer that splits the texts
+     *  @param  arena       arena for temporary memory
+     */
+    Patch(const Limits &limits, const text_t &input1, const text_t &input2, const Tokenizer &tokenizer, Arena &arena) :
+        _input1(input1),
+        _input2(input2)
+    {
+        // run the algorithm
+        calculate(limits, input1, input2, tokenizer, arena);
+    }
+
+    /**
+     *  Update a patch after a small edit of the second input. Only the diffs
+     *  around the edit (see limits.editcontext) are recalculated, the others are
+     *  taken from the patch before the edit. If the edit does not match the
+     *  sizes of the inputs, the patch is simply recalculated completely.
+     *
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  patch       the patch before the edit (the same first input, and the second input before the edit)
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare (after the edit)
+     *  @param  offset      byte offset of the edit in the second input
+     *  @param  removed     number of bytes that were removed from the second input
+     *  @param  inserted    number of bytes that were inserted instead
+     *  @param  checklines  tuning flag
+     */
+    Patch(const Limits &limits, const Patch &patch, const text_t &input1, const text_t &input2, size_t offset, size_t removed, size_t inserted, bool checklines = true) :
+        _input1(input1),
+        _input2(input2)
+    {
+        // arena for all temporary memory
+        Arena arena;
+
+        // does the edit match the inputs?
+        bool valid = input1.bytes() == patch._input1.bytes() && offset + removed <= patch._input2.bytes() && input2.bytes() + removed == patch._input2.bytes() + inserted;
+
+        // update the patch, or run the complete algorithm if that is not possible
+        if (valid) update(limits, patch, input1, input2, offset, removed, inserted, checklines, arena);
+        else calculate(limits, input1, input2, checklines, arena);
+    }
+
     /**
      *  Destructor
      */
     virtual ~Patch() = default;
 
-private:
     /**
-     *  Compute the algorithm for two strings
-     *  This method is called by the constructor after the common prefix and common suffix
-     *  have been removed from the input strings
-     *  @param  limits      object with algorithm limits
-     *  @param  text1       base input string
-     *  @param  text2       the other input string
-     *  @param  checklines  tuning flag
-     *  @param  deadline    timestamp when to stop
+     *  Number of diffs in the patch
+     *  @return size_t
+     */
+    size_t size() const { return _diffs.size(); }
+
+    /**
+     *  Iterate over the diffs
+     *  @return iterator
+     */
+    std::vector<Diff, Allocator<Diff>>::const_iterator begin() const { return _diffs.begin(); }
+    std::vector<Diff, Allocator<Diff>>::const_iterator end() const { return _diffs.end(); }
+
+    /**
+     *  The inputs (these are not copies, but views on the original data)
+     *  @return Buffer
+     */
+    const Buffer &input1() const { return _input1.buffer(); }
+    const Buffer &input2() const { return _input2.buffer(); }
+
+    /**
+     *  Get access to the data of a diff. This is not a copy, but a view on the
+     *  original input. If you need a copy, you can construct a Buffer with the
+     *  deepcopy flag set.
+     *  @param  diff        the diff
+     *  @return Buffer
+     */
+    Buffer buffer(const Diff &diff) const { return Buffer(data(diff), diff.bytes(), false); }
+
+    /**
+     *  Get access to the data of a diff as text
+     *  @param  diff        the diff
+     *  @return text_t
+     */
+    text_t text(const Diff &diff) const { return Elements<text_t>::substring(diff.operation() == Operation::INSERT ? _input2 : _input1, diff.offset(), diff.bytes()); }
+
+private:
+    /**
+     *  Pointer to the data of a diff
+     *  @param  diff        the diff
+     *  @return const char *
+     */
+    const char *data(const Diff &diff) const
+    {
+        // inserted data comes from the second input, the rest from the first one
+        return (diff.operation() == Operation::INSERT ? _input2 : _input1).buffer().data() + diff.offset();
+    }
+
+    /**
+     *  Add a diff to the end of the patch, the diff starts where the previous diff stopped
+     *  @param  operation   the operation
+     *  @param  bytes       number of bytes
+     */
+    void append(Operation operation, size_t bytes)
+    {
+        // empty diffs are not stored
+        if (bytes == 0) return;
+
+        // add the diff
+        _diffs.emplace_back(operation, operation == Operation::INSERT ? _size2 : _size1, bytes);
+
+        // update the number of bytes that have been covered
+        if (operation != Operation::INSERT) _size1 += bytes;
+        if (operation != Operation::DELETE) _size2 += bytes;
+    }
+
+    /**
+     *  Add all the diffs of a sub-patch that was calculated over the texts that
+     *  start where the previous diff stopped
+     *  @param  that        the other patch
+     */
+    template <typename other_t>
+    void append(const Patch<other_t> &that)
+    {
+        // make sure that there is enough room (this is grown exponentially, because this
+        // is called over and over again for the same patch, and the arena never frees)
+        size_t needed = _diffs.size() + that._diffs.size();
+        if (needed > _diffs.capacity()) _diffs.reserve(std::max(needed, _diffs.capacity() * 2));
+
+        // add all diffs
+        for (const auto &diff : that._diffs) append(diff.operation(), diff.bytes());
+    }
+
+    /**
+     *  Compute the algorithm for two strings
+     *  This method is called by the constructor after the common prefix and common suffix
+     *  have been removed from the input strings
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       base input string
+     *  @param  text2       the other input string
+     *  @param  checklines  tuning flag
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     */
+    void compute(const Limits &limits, const text_t &text1, const text_t &text2, bool checklines, const Deadline &deadline, Scratch &scratch)
+    {
+        // if one of the texts is empty, the diff is really simple
+        if (text1.characters() == 0 || text2.characters() == 0)
+        {
+            // record how the patch was resolved
+            resolved(scratch, Stats::Shortcut::EMPTY);
+
+            // one of these is empty, and is not stored
+            append(Operation::DELETE, text1.bytes());
+            return append(Operation::INSERT, text2.bytes());
+        }
+
+        // get the long and short texts to see if the shorter one is completely included in the other
+        if (overlap(text1, text2, scratch)) return;
+
+        // patches over tokens can be aligned on rare tokens (but not after the deadline, because that scans the texts)
+        if (!deadline.expired() && anchored(limits, text1, text2, deadline, scratch)) return;
+
+        // short texts are solved right away with the bit-parallel algorithm (this is cheap enough after the deadline too)
+        if (bitparallel(limits, text1, text2, scratch)) return;
+
+        // once the deadline has passed, the limited bisect is the cheapest way to finish (the other
+        // algorithms scan and index the entire texts, which is too expensive for every range)
+        if (deadline.expired() && limits.anytime > 0)
+        {
+            // utf8 texts are decoded first
+            if (limited(limits, text1, text2, deadline, scratch)) return;
+
+            // the others are bisected right away
+            return bisect(limits, text1, text2, deadline, scratch);
+        }
+
+        // if we have a deadline we are going to check first if we can find a fast, but non-optimal, solution
+        if (deadline && halfmatch(limits, text1, text2, checklines, deadline, scratch)) return;
+
+        // do the real diff
+        if (checklines && text1.characters() > 100 && text2.characters() > 100) return linemode(limits, text1, text2, deadline, scratch);
+
+        // run the entire algorithm
+        return bisect(limits, text1, text2, deadline, scratch);
+    }
+
+    /**
+     *  Calculate the patch of texts that are not made of tokens with an anchor based
+     *  algorithm, this is never done (those algorithms only make sense for tokens)
+     *  @return bool        was the patch calculated?
+     */
+    template <typename input_t>
+    bool anchored(const Limits &, const input_t &, const input_t &, const Deadline &, Scratch &)
+    {
+        // characters are diffed with the other algorithms
+        return false;
+    }
+
+    /**
+     *  Calculate the patch of two texts made of tokens with the anchor based
+     *  algorithm that is selected in the limits
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @return bool        was the patch calculated?
+     */
+    bool anchored(const Limits &limits, const Tokens &text1, const Tokens &text2, const Deadline &deadline, Scratch &scratch)
+    {
+        // check the algorithm
+        switch (limits.algorithm) {
+        case Algorithm::PATIENCE:   return patience(limits, text1, text2, deadline, scratch);
+        case Algorithm::HISTOGRAM:  return histogram(limits, text1, text2, deadline, scratch);
+        default:                    return false;
+        }
+    }
+
+    /**
+     *  Run the patience algorithm: the texts are split at the tokens that appear
+     *  once in both texts, and the parts in between are calculated separately
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @return bool        was this a success?
+     */
+    bool patience(const Limits &limits, const Tokens &text1, const Tokens &text2, const Deadline &deadline, Scratch &scratch)
+    {
+        // find the anchors
+        Patience anchors(Elements<Tokens>::data(text1), text1.characters(), Elements<Tokens>::data(text2), text2.characters(), &scratch.arena());
+
+        // stop if there are none
+        if (!anchors) return false;
+
+        // record how the patch was resolved
+        resolved(scratch, Stats::Shortcut::PATIENCE);
+
+        // the position in both texts after the previous anchor
+        size_t position1 = 0, position2 = 0;
+
+        // calculate the parts in front of the anchors
+        for (size_t i = 0; i < anchors.size(); ++i)
+        {
+            // the part in front of the anchor (this splits the part again at its own unique tokens)
+            Patch<Tokens> part(limits, text1.substr(position1, anchors.x(i) - position1), text2.substr(position2, anchors.y(i) - position2), false, deadline, scratch);
+
+            // add the part and the anchor to the result
+            append(part);
+            append(Operation::EQUAL, sizeof(uint32_t));
+
+            // proceed after the anchor
+            position1 = anchors.x(i) + 1; position2 = anchors.y(i) + 1;
+        }
+
+        // the part behind the last anchor
+        Patch<Tokens> part(limits, text1.substr(position1), text2.substr(position2), false, deadline, scratch);
+        append(part);
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Run the histogram algorithm: the texts are split around the longest common
+     *  run with the rarest token, and the parts in front of it and behind it are
+     *  calculated separately
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @return bool        was this a success?
+     */
+    bool histogram(const Limits &limits, const Tokens &text1, const Tokens &text2, const Deadline &deadline, Scratch &scratch)
+    {
+        // find the anchor
+        Histogram anchor(Elements<Tokens>::data(text1), text1.characters(), Elements<Tokens>::data(text2), text2.characters(), &scratch.arena());
+
+        // stop if there is none
+        if (!anchor) return false;
+
+        // record how the patch was resolved
+        resolved(scratch, Stats::Shortcut::HISTOGRAM);
+
+        // calculate the parts in front of the anchor and behind it
+        parts(limits, text1.substr(0, anchor.x()), text2.substr(0, anchor.y()), anchor.length() * sizeof(uint32_t), text1.substr(anchor.x() + anchor.length()), text2.substr(anchor.y() + anchor.length()), false, deadline, scratch);
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Is a pair of texts short enough for the bit-parallel algorithm?
+     *  @param  limits      object with algorithm limits
+     *  @param  size1       number of characters of the first text
+     *  @param  size2       number of characters of the second text
+     *  @return bool
+     */
+    static bool shortenough(const Limits &limits, size_t size1, size_t size2)
+    {
+        // both texts must be within the limit, and the first one must fit in the words of the algorithm
+        return size1 <= limits.bitparallel && size2 <= limits.bitparallel && size1 <= BitParallel<char>::maxsize;
+    }
+
+    /**
+     *  Calculate the patch of two short texts with fixed-width characters with
+     *  the bit-parallel algorithm, which is faster than the bisect for short texts
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  scratch     working memory
+     *  @return bool        was the patch calculated?
+     */
+    template <typename input_t>
+    bool bitparallel(const Limits &limits, const input_t &text1, const input_t &text2, Scratch &scratch)
+    {
+        // the texts must be short enough
+        if (!shortenough(limits, text1.characters(), text2.characters())) return false;
+
+        // calculate the longest common subsequence, straight from the characters
+        BitParallel<typename Elements<input_t>::type> lcs(Elements<input_t>::data(text1), text1.characters(), Elements<input_t>::data(text2), text2.characters(), scratch);
+
+        // add the edit script to the patch
+        return script(lcs, text1, text2, scratch);
+    }
+
+    /**
+     *  Calculate the patch of two short utf8 texts with the bit-parallel algorithm,
+     *  the texts are decoded into code points first
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  scratch     working memory
+     *  @return bool        was the patch calculated?
+     */
+    bool bitparallel(const Limits &limits, const Utf8 &text1, const Utf8 &text2, Scratch &scratch)
+    {
+        // the texts must be short enough
+        if (!shortenough(limits, text1.characters(), text2.characters())) return false;
+
+        // the arrays for the code points
+        auto &codepoints1 = scratch.codepoints1();
+        auto &codepoints2 = scratch.codepoints2();
+
+        // decode the texts
+        codepoints1.clear(); for (auto codepoint : text1) codepoints1.push_back(codepoint);
+        codepoints2.clear(); for (auto codepoint : text2) codepoints2.push_back(codepoint);
+
+        // calculate the longest common subsequence over the code points
+        BitParallel<uint32_t> lcs(codepoints1.data(), codepoints1.size(), codepoints2.data(), codepoints2.size(), scratch);
+
+        // add the edit script to the patch
+        return script(lcs, text1, text2, scratch);
+    }
+
+    /**
+     *  Add the edit script of the bit-parallel algorithm to the patch
+     *  @param  lcs         the longest common subsequence with its edit script
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  scratch     working memory
+     *  @return bool        always true
      */
-    void compute(const Limits &limits, const text_t &text1, const text_t &text2, bool checklines, const Deadline &deadline)
+    template <typename element_t>
+    bool script(const BitParallel<element_t> &lcs, const text_t &text1, const text_t &text2, Scratch &scratch)
     {
-        // if one of the texts is empty, the diff is really simple
-        if (text1.characters() == 0) return _diffs.emplace_back(Operation::INSERT, text2.buffer());
-        if (text2.characters() == 0) return _diffs.emplace_back(Operation::DELETE, text1.buffer());
-        
-        // get the long and short texts to see if the shorter one is completely included in the other
-        if (overlap(text1, text2)) return;
-        
-        // if we have a deadline we are going to check first if we can find a fast, but non-optimal, solution
-        if (deadline && halfmatch(limits, text1, text2, checklines, deadline)) return;
-        
-        // do the real diff
-        if (checklines && text1.characters() > 100 && text2.characters() > 100) return linemode(text1, text2, deadline);
+        // record how the patch was resolved
+        resolved(scratch, Stats::Shortcut::BITPARALLEL);
 
-        // run the entire algorithm
-        return bisect(text1, text2, deadline);
+        // current position in both texts (in characters)
+        size_t position1 = 0, position2 = 0;
+
+        // convert the operations into diffs over bytes
+        for (size_t i = 0; i < lcs.size(); ++i)
+        {
+            // the operation and its number of characters
+            Operation operation = lcs.operation(i);
+            size_t count = lcs.count(i);
+
+            // inserted characters come from the second text, the others from the first one
+            if (operation == Operation::INSERT) append(operation, text2.substr(position2, count).bytes());
+            else append(operation, text1.substr(position1, count).bytes());
+
+            // update the positions
+            if (operation != Operation::INSERT) position1 += count;
+            if (operation != Operation::DELETE) position2 += count;
+        }
+
+        // done
+        return true;
     }
-    
+
     /**
      *  Run the half-match algorithm to find a non-optimal result
      *  @param  limits      object with algorithm limits
@@ -145,9 +1030,10 @@ private:
      *  @param  text2       text to reach
      *  @param  checklines  tuning flag
      *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
      *  @return bool        was this a success?
      */
-    bool halfmatch(const Limits &limits, const text_t &text1, const text_t &text2, bool checklines, const Deadline &deadline)
+    bool halfmatch(const Limits &limits, const text_t &text1, const text_t &text2, bool checklines, const Deadline &deadline, Scratch &scratch)
     {
         // find the long and short texts
         const text_t &longtext = text1.characters() > text2.characters() ? text1 : text2;
@@ -155,321 +1041,684 @@ private:
 
         // check if this algorithm can succeed in the first place
         if (longtext.characters() < 4 || shorttext.characters() * 2 < longtext.characters()) return false;
-        
+
         // construct the half-match result
-        HalfMatch<text_t> result(longtext, shorttext);
-        
+        HalfMatch<text_t> result(longtext, shorttext, &scratch.arena());
+
         // stop if no match
         if (!result) return false;
-        
-        // check
-        if (&longtext == &text1)
+
+        // record how the patch was resolved
+        resolved(scratch, Stats::Shortcut::HALFMATCH);
+
+        // find the diffs inside the non-common stuff
+        if (&longtext == &text1) parts(limits, result.longPrefix(), result.shortPrefix(), result.common().bytes(), result.longSuffix(), result.shortSuffix(), checklines, deadline, scratch);
+        else parts(limits, result.shortPrefix(), result.longPrefix(), result.common().bytes(), result.shortSuffix(), result.longSuffix(), checklines, deadline, scratch);
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Run the linemode algorithm, this first does a line-based diff to locate the areas
+     *  that are most effective to spend time on to look for an efficient diff
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     */
+    void linemode(const Limits &limits, const text_t &text1, const text_t &text2, const Deadline &deadline, Scratch &scratch)
+    {
+        // record how the patch was resolved
+        resolved(scratch, Stats::Shortcut::LINEMODE);
+
+        // the lines of the two texts (they share the dictionary, so that identical lines get identical tokens)
+        Lines &lines1 = scratch.lines1();
+        Lines &lines2 = scratch.lines2();
+
+        // convert the texts into lines
+        scratch.dictionary().clear();
+        lines1.assign(text1.buffer(), scratch.dictionary());
+        lines2.assign(text2.buffer(), scratch.dictionary());
+
+        // calculate the diff over the lines
+        Patch<Tokens> lines(limits, lines1.tokens(), lines2.tokens(), false, deadline, scratch);
+
+        // current line in both texts, and the number of lines that are deleted and inserted
+        size_t line1 = 0, line2 = 0, deleted = 0, inserted = 0;
+
+        // convert the line-diffs into character diffs
+        for (const auto &diff : lines._diffs)
+        {
+            // number of lines in this diff
+            size_t count = diff.bytes() / sizeof(uint32_t);
+
+            // check the operation
+            switch (diff.operation()) {
+            case Operation::DELETE:
+                // this is part of a replacement
+                deleted += count;
+                break;
+
+            case Operation::INSERT:
+                // this is part of a replacement
+                inserted += count;
+                break;
+
+            case Operation::EQUAL:
+                // the replaced lines in front of this operation are rediffed character by character
+                rediff(limits, text1, text2, lines1.offset(line1), lines1.offset(line1 + deleted), lines2.offset(line2), lines2.offset(line2 + inserted), deadline, scratch);
+
+                // the replaced lines have been processed
+                line1 += deleted; line2 += inserted; deleted = inserted = 0;
+
+                // the equal lines are taken from the first text
+                append(Operation::EQUAL, lines1.offset(line1 + count) - lines1.offset(line1));
+
+                // update the positions
+                line1 += count; line2 += count;
+                break;
+            }
+        }
+
+        // the texts could end with replaced lines
+        rediff(limits, text1, text2, lines1.offset(line1), lines1.offset(line1 + deleted), lines2.offset(line2), lines2.offset(line2 + inserted), deadline, scratch);
+    }
+
+    /**
+     *  Helper method for the linemode algorithm that calculates the character based
+     *  diff for a block of lines that was replaced by an other block of lines
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  begin1      byte offset of the deleted lines in the first text
+     *  @param  end1        end offset of the deleted lines in the first text
+     *  @param  begin2      byte offset of the inserted lines in the second text
+     *  @param  end2        end offset of the inserted lines in the second text
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     */
+    void rediff(const Limits &limits, const text_t &text1, const text_t &text2, size_t begin1, size_t end1, size_t begin2, size_t end2, const Deadline &deadline, Scratch &scratch)
+    {
+        // if lines were only deleted or only inserted, there is nothing to rediff
+        if (begin1 == end1) return append(Operation::INSERT, end2 - begin2);
+        if (begin2 == end2) return append(Operation::DELETE, end1 - begin1);
+
+        // calculate the character based diff of the replaced lines
+        Patch<text_t> part(limits, Elements<text_t>::substring(text1, begin1, end1 - begin1), Elements<text_t>::substring(text2, begin2, end2 - begin2), false, deadline, scratch);
+
+        // add to the result
+        append(part);
+    }
+
+    /**
+     *  The entire algorithm (without the linemode stuff): find the middle snake,
+     *  split the texts at that position, and calculate the diffs of the two halves.
+     *  If the deadline cuts the search short, the parts that the paths reached
+     *  are calculated, and the range in between is searched again (this is
+     *  done in a loop, so that the recursion does not get deeper every time)
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     */
+    void bisect(const Limits &limits, const text_t &text1, const text_t &text2, const Deadline &deadline, Scratch &scratch)
+    {
+        // record how the patch was resolved
+        resolved(scratch, Stats::Shortcut::BISECT);
+
+        // the range of characters that is not yet solved
+        size_t begin1 = 0, begin2 = 0, end1 = text1.characters(), end2 = text2.characters();
+
+        // the diffs at the end of the texts that were already found, in reverse order
+        std::vector<Diff, Allocator<Diff>> tail{Allocator<Diff>(&scratch.arena())};
+
+        // go split the range
+        while (true)
+        {
+            // the texts that are not yet solved
+            text_t range1(text1.substr(begin1, end1 - begin1));
+            text_t range2(text2.substr(begin2, end2 - begin2));
+
+            // the position of the middle snake, and where the reverse path ended
+            size_t x, y, endx, endy;
+
+            // if there is no snake, the deadline was reached or there is nothing in common
+            if (!split(range1, range2, limits.anytime, deadline, scratch, x, y, endx, endy))
+            {
+                // the entire range has to be replaced
+                append(Operation::DELETE, range1.bytes());
+                append(Operation::INSERT, range2.bytes());
+                break;
+            }
+
+            // for a real snake, we calculate the diffs of the two halves, the scratch memory is
+            // no longer used by the snake, so the halves are allowed to reuse it
+            if (x == endx && y == endy)
+            {
+                parts(limits, range1.substr(0, x), range2.substr(0, y), 0, range1.substr(x), range2.substr(y), false, deadline, scratch);
+                break;
+            }
+
+            // the search was cut short, the parts that the paths reached are calculated right away
+            Patch<text_t> front(limits, range1.substr(0, x), range2.substr(0, y), false, deadline, scratch);
+            Patch<text_t> back(limits, range1.substr(endx), range2.substr(endy), false, deadline, scratch);
+
+            // the front is added to the result, and the back is added when the rest is done
+            append(front);
+            tail.insert(tail.end(), back._diffs.rbegin(), back._diffs.rend());
+
+            // the range in between is searched again
+            end1 = begin1 + endx; end2 = begin2 + endy;
+            begin1 += x; begin2 += y;
+
+            // utf8 texts would be decoded over and over again, so they are handed over to a patch over the code points
+            if (limited(limits, text1.substr(begin1, end1 - begin1), text2.substr(begin2, end2 - begin2), deadline, scratch)) break;
+        }
+
+        // add the diffs at the end
+        for (auto iter = tail.rbegin(); iter != tail.rend(); ++iter) append(iter->operation(), iter->bytes());
+    }
+
+    /**
+     *  Calculate the patch of texts with fixed-width characters after the deadline
+     *  has passed, this is left to the normal bisect (which can access the characters directly)
+     *  @return bool        was the patch calculated?
+     */
+    template <typename input_t>
+    bool limited(const Limits &, const input_t &, const input_t &, const Deadline &, Scratch &)
+    {
+        // the bisect can access the characters directly
+        return false;
+    }
+
+    /**
+     *  Calculate the patch of two utf8 texts after the deadline has passed. The
+     *  limited bisect splits the texts many times, and it would have to decode
+     *  the rest of the texts for every split. That is why the code points are
+     *  decoded only once, and the patch is calculated over them.
+     *  @param  limits      object with algorithm limits
+     *  @param  text1       first input text
+     *  @param  text2       text to reach
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @return bool        was the patch calculated?
+     */
+    bool limited(const Limits &limits, const Utf8 &text1, const Utf8 &text2, const Deadline &deadline, Scratch &scratch)
+    {
+        // the arrays for the code points (a patch over fixed-width characters does not use them)
+        auto &codepoints1 = scratch.codepoints1();
+        auto &codepoints2 = scratch.codepoints2();
+
+        // decode the texts
+        codepoints1.clear(); for (auto codepoint : text1) codepoints1.push_back(codepoint);
+        codepoints2.clear(); for (auto codepoint : text2) codepoints2.push_back(codepoint);
+
+        // calculate the patch over the code points
+        Patch<Tokens> codepoints(limits, Tokens(codepoints1.data(), codepoints1.size()), Tokens(codepoints2.data(), codepoints2.size()), false, deadline, scratch);
+
+        // current position in both texts (in code points)
+        size_t position1 = 0, position2 = 0;
+
+        // convert the diffs over code points into diffs over bytes
+        for (const auto &diff : codepoints._diffs)
+        {
+            // number of code points in this diff
+            size_t count = diff.bytes() / sizeof(uint32_t);
+
+            // inserted code points come from the second text, the others from the first one
+            if (diff.operation() == Operation::INSERT) append(diff.operation(), text2.substr(position2, count).bytes());
+            else append(diff.operation(), text1.substr(position1, count).bytes());
+
+            // update the positions
+            if (diff.operation() != Operation::INSERT) position1 += count;
+            if (diff.operation() != Operation::DELETE) position2 += count;
+        }
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Calculate the diffs of two independent parts, and add them to the patch
+     *  with an optional common text in between. If there is a thread pool and
+     *  both parts are big enough, the second part is calculated by a task.
+     *  @param  limits      object with algorithm limits
+     *  @param  first1      first part of the first text
+     *  @param  first2      first part of the second text
+     *  @param  common      number of common bytes between the parts
+     *  @param  second1     second part of the first text
+     *  @param  second2     second part of the second text
+     *  @param  checklines  tuning flag
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     */
+    void parts(const Limits &limits, const text_t &first1, const text_t &first2, size_t common, const text_t &second1, const text_t &second2, bool checklines, const Deadline &deadline, Scratch &scratch)
+    {
+        // the thread pool
+        Pool *pool = scratch.pool();
+
+        // small problems are calculated in the current thread
+        if (pool == nullptr || std::min(first1.characters() + first2.characters(), second1.characters() + second2.characters()) < limits.forksize)
         {
-            // find the diffs inside the non-common stuff
-            Patch<text_t> part1(limits, result.longPrefix(), result.shortPrefix(), checklines, deadline);
-            Patch<text_t> part2(limits, result.longSuffix(), result.shortSuffix(), checklines, deadline);
-            
+            // calculate the parts one after the other
+            Patch<text_t> part1(limits, first1, first2, checklines, deadline, scratch);
+            Patch<text_t> part2(limits, second1, second2, checklines, deadline, scratch);
+
             // add to the result
-            _diffs.splice(_diffs.end(), part1._diffs, part1._diffs.begin(), part1._diffs.end());
-            _diffs.emplace_back(Operation::EQUAL, result.common().buffer());
-            _diffs.splice(_diffs.end(), part2._diffs, part2._diffs.begin(), part2._diffs.end());
+            append(part1);
+            append(Operation::EQUAL, common);
+            append(part2);
         }
         else
         {
-            // find the diffs inside the non-common-stuff
-            Patch<text_t> part1(limits, result.shortPrefix(), result.longPrefix(), checklines, deadline);
-            Patch<text_t> part2(limits, result.shortSuffix(), result.longSuffix(), checklines, deadline);
-            
-            // add to the result
-            _diffs.splice(_diffs.end(), part1._diffs, part1._diffs.begin(), part1._diffs.end());
-            _diffs.emplace_back(Operation::EQUAL, result.common().buffer());
-            _diffs.splice(_diffs.end(), part2._diffs, part2._diffs.begin(), part2._diffs.end());
+            // the second part is handed over to the pool
+            Part part2(limits, second1, second2, checklines, deadline, scratch);
+            pool->push(&part2);
+
+            // the task must not outlive this function, not even if an exception is thrown
+            try
+            {
+                // calculate the first part in the meantime
+                Patch<text_t> part1(limits, first1, first2, checklines, deadline, scratch);
+
+                // wait for the second part (or calculate it ourselves if no other thread picked it up)
+                pool->wait(&part2);
+
+                // add to the result
+                append(part1);
+                append(Operation::EQUAL, common);
+                append(part2.patch());
+            }
+            catch (...)
+            {
+                // wait for the task before the exception is passed on (its own exception is ignored)
+                try { pool->wait(&part2); } catch (...) {}
+                throw;
+            }
         }
-        
+    }
+
+    /**
+     *  Find the middle snake of two arrays of elements
+     *  @param  text1       elements of the first input text
+     *  @param  size1       number of elements of the first text
+     *  @param  text2       elements of the text to reach
+     *  @param  size2       number of elements of the second text
+     *  @param  anytime     max number of edit steps once the deadline has passed
+     *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @param  x           position of the snake in the first text
+     *  @param  y           position of the snake in the second text
+     *  @param  endx        where the reverse path ended in the first text (the same as x for a real snake)
+     *  @param  endy        where the reverse path ended in the second text (the same as y for a real snake)
+     *  @return bool        was a snake found?
+     */
+    template <typename element_t>
+    static bool split(const element_t *text1, size_t size1, const element_t *text2, size_t size2, size_t anytime, const Deadline &deadline, Scratch &scratch, size_t &x, size_t &y, size_t &endx, size_t &endy)
+    {
+        // find the middle snake
+        MiddleSnake<element_t> snake(text1, size1, text2, size2, deadline, scratch, anytime);
+
+        // record the work that the search did
+        if (Stats *stats = scratch.stats()) stats->search(snake.steps(), snake.checks());
+
+        // leap out if there is none
+        if (!snake) return false;
+
+        // expose the positions
+        x = snake.x(); y = snake.y();
+        endx = snake.endx(); endy = snake.endy();
+
         // done
         return true;
     }
-    
+
     /**
-     *  Run the linemode algorithm, this first does a line-based diff to locate the areas
-     *  that are most effective to spend time on to look for an efficient diff
+     *  Find the middle snake of two texts with fixed-width characters
      *  @param  text1       first input text
      *  @param  text2       text to reach
+     *  @param  anytime     max number of edit steps once the deadline has passed
      *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @param  x           position of the snake in the first text
+     *  @param  y           position of the snake in the second text
+     *  @param  endx        where the reverse path ended in the first text
+     *  @param  endy        where the reverse path ended in the second text
+     *  @return bool        was a snake found?
      */
-    void linemode(const text_t &text1, const text_t &text2, const Deadline &deadline)
+    template <typename input_t>
+    static bool split(const input_t &text1, const input_t &text2, size_t anytime, const Deadline &deadline, Scratch &scratch, size_t &x, size_t &y, size_t &endx, size_t &endy)
     {
-        // @todo implement this algorithm
+        // search the arrays of elements
+        return split(Elements<input_t>::data(text1), text1.characters(), Elements<input_t>::data(text2), text2.characters(), anytime, deadline, scratch, x, y, endx, endy);
     }
-    
+
     /**
-     *  The entire algorithm (without the linemode stuff)
+     *  Find the middle snake of two utf8 texts, the search needs random access
+     *  to the characters, so the code points are decoded first
      *  @param  text1       first input text
      *  @param  text2       text to reach
+     *  @param  anytime     max number of edit steps once the deadline has passed
      *  @param  deadline    timestamp when to stop
+     *  @param  scratch     working memory
+     *  @param  x           position of the snake in the first text
+     *  @param  y           position of the snake in the second text
+     *  @param  endx        where the reverse path ended in the first text
+     *  @param  endy        where the reverse path ended in the second text
+     *  @return bool        was a snake found?
      */
-    void bisect(const text_t &text1, const text_t &text2, const Deadline &deadline)
+    static bool split(const Utf8 &text1, const Utf8 &text2, size_t anytime, const Deadline &deadline, Scratch &scratch, size_t &x, size_t &y, size_t &endx, size_t &endy)
     {
-        // @todo implement this algorithm
+        // the arrays for the code points (the snake does not use these arrays, so they may be reused by the recursion)
+        auto &codepoints1 = scratch.codepoints1();
+        auto &codepoints2 = scratch.codepoints2();
+
+        // decode the texts
+        codepoints1.clear(); for (auto codepoint : text1) codepoints1.push_back(codepoint);
+        codepoints2.clear(); for (auto codepoint : text2) codepoints2.push_back(codepoint);
+
+        // find the snake in the code points
+        return split(codepoints1.data(), codepoints1.size(), codepoints2.data(), codepoints2.size(), anytime, deadline, scratch, x, y, endx, endy);
     }
-    
+
     /**
      *  Algorithm that checks if one text is completely covered by the other
      *  @param  text1       the first text to check
      *  @param  text2       the other text
+     *  @param  scratch     working memory
      *  @return bool        was there an overlap (algorithm is ready if true)
      */
-    bool overlap(const text_t &text1, const text_t &text2)
+    bool overlap(const text_t &text1, const text_t &text2, Scratch &scratch)
     {
         // check if there is an overlap
         CommonOverlap<text_t> overlap(text1, text2);
-        
+
         // is there indeed this overlap?
         if (overlap)
         {
             // this is a simple optimization
-            _diffs.emplace_back(overlap.operation(), overlap.prefix());
-            _diffs.emplace_back(Operation::EQUAL, overlap.buffer());
-            _diffs.emplace_back(overlap.operation(), overlap.suffix());
-            
+            append(overlap.operation(), overlap.prefix().bytes());
+            append(Operation::EQUAL, overlap.buffer().bytes());
+            append(overlap.operation(), overlap.suffix().bytes());
+
+            // record how the patch was resolved
+            resolved(scratch, Stats::Shortcut::OVERLAP);
+
             // we have a match indeed
             return true;
         }
-        
+
         // no match, but we can still optimize if the short-string is only one char wide
         if (text1.characters() == 1 || text2.characters() == 1)
         {
             // after the previous check, we are sure that there is no EQUALS
-            _diffs.emplace_back(Operation::DELETE, text1.buffer());
-            _diffs.emplace_back(Operation::INSERT, text2.buffer());
-            
+            append(Operation::DELETE, text1.bytes());
+            append(Operation::INSERT, text2.bytes());
+
+            // record how the patch was resolved
+            resolved(scratch, Stats::Shortcut::SINGLECHAR);
+
             // we also have a match
             return true;
         }
-        
+
         // no overlap between the texts
         return false;
     }
-    
+
     /**
-     *  Helper method to optimize the _diffs member: subsequent operations that can be
-     *  combined or merged are grouped
+     *  The INSERT and DELETE operations between two EQUAL operations that are
+     *  collected while the diffs are normalized (the inserted data is contiguous
+     *  in the second input, and the deleted data is contiguous in the first input)
      */
-    void optimize()
+    struct Updates
     {
-        // keep optimizing until there is nothing left to optimize
-        do
+        /**
+         *  Offset in the second input and number of bytes of the inserted data
+         *  @var size_t
+         */
+        size_t insertOffset = 0;
+        size_t inserted = 0;
+
+        /**
+         *  Offset in the first input and number of bytes of the deleted data
+         *  @var size_t
+         */
+        size_t deleteOffset = 0;
+        size_t deleted = 0;
+
+        /**
+         *  Add an operation behind the collected updates
+         *  @param  operation   INSERT or DELETE
+         *  @param  offset      offset of the data
+         *  @param  bytes       number of bytes
+         */
+        void append(Operation operation, size_t offset, size_t bytes)
         {
-            // combined insert and remove operations
-            mergeUpdates();
-            
-            // combined equal operations
-            mergeEquals();
+            // the offset is only needed for the first operation
+            if (operation == Operation::INSERT) { if (inserted == 0) insertOffset = offset; inserted += bytes; }
+            else { if (deleted == 0) deleteOffset = offset; deleted += bytes; }
         }
-        while (shift() > 0);
-    }
-    
+
+        /**
+         *  Add an operation in front of the collected updates
+         *  @param  diff        the INSERT or DELETE operation
+         */
+        void prepend(const Diff &diff)
+        {
+            // the updates now start where the diff starts
+            if (diff.operation() == Operation::INSERT) { insertOffset = diff.offset(); inserted += diff.bytes(); }
+            else { deleteOffset = diff.offset(); deleted += diff.bytes(); }
+        }
+    };
+
     /**
-     *  Helper method to merge multiple INSERT and REMOVE operations in the _diffs member
-     *  into a single array
+     *  Helper method to normalize the _diffs member in a single pass, the array is
+     *  compacted in place. The diffs that were written form a stack that always
+     *  ends with an EQUAL operation, and the INSERT and DELETE operations behind it
+     *  are collected until the next EQUAL operation shows up. At that moment they
+     *  are merged into at most one DELETE and one INSERT operation, and their common
+     *  prefix and suffix are moved to the surrounding EQUAL operations. A single
+     *  edit is shifted over a surrounding EQUAL operation when the edit repeats it,
+     *  e.g: A<ins>BA</ins>C -> <ins>AB</ins>AC. Every shift removes an EQUAL
+     *  operation, so the total amount of work is linear.
+     *  @param  stats       optional stats that record the pass
+     *  @param  dropped     optional flags for EQUAL operations that should be replaced by a DELETE and an INSERT
      */
-    void mergeUpdates()
+    void normalize(Stats *stats, const std::vector<bool> *dropped = nullptr)
     {
-        // merged INSERT and DELETE operations
-        Diff mergedInsert(Operation::INSERT);
-        Diff mergedDelete(Operation::DELETE);
-        
-        // iterator to the begin of a serie of edit-operations
-        auto updates = _diffs.end();
-        
-        // go iterate
-        for (auto iter = _diffs.begin(); iter != _diffs.end(); ++iter)
-        {
-            // remember if this is the begin of a set of update operations
-            if (updates == _diffs.end() && iter->operation() != Operation::EQUAL) updates = iter;
-            
-            // check the operation at this position
-            switch (iter->operation()) {
-            case Operation::INSERT:
-                // track all inserted data
-                mergedInsert.append(*iter);
-                break;
+        // number of diffs, the position of the next diff to read and to write, and the number of shifted edits
+        size_t size = _diffs.size(), r = 0, w = 0, shifts = 0;
 
-            case Operation::DELETE:
-                // track all deleted data
-                mergedDelete.append(*iter);
-                break;
+        // the updates since the last EQUAL operation
+        Updates updates;
 
-            case Operation::EQUAL:
-                // have we just passed a set of update operations?
-                if (updates != _diffs.end()) break;
-
-                // remove these operations from the list
-                _diffs.erase(updates, iter);
-                
-                // forget that we have seen updates now that they have been removed
-                updates = _diffs.end();
-                
-                // check if the inserting and deleting start with the same text?
-                CommonPrefix<text_t> commonprefix(mergedInsert, mergedDelete);
-                
-                // is there indeed a common prefix?
-                if (commonprefix)
-                {
-                    // insert a new EQUAL operation for this prefix
-                    _diffs.emplace(iter, Operation::EQUAL, commonprefix.buffer());
-                    
-                    // remove the leading bytes
-                    mergedInsert.assign(mergedInsert.part(commonprefix.bytes()));
-                    mergedDelete.assign(mergedDelete.part(commonprefix.bytes()));
-                }
-                
-                // and is there a common suffic too?
-                CommonSuffix<text_t> commonsuffix(mergedInsert, mergedDelete);
-                
-                // check if it exists
-                if (commonsuffix)
-                {
-                    // the actual suffix as byte-array is inserted as EQUAL operation right 
-                    // in front of the current operation as EQUAL operation, and we update the
-                    // iterator so that the subsequent DELETE and INSERT operations will be 
-                    // placed in front
-                    iter = _diffs.emplace(iter, Operation::EQUAL, std::move(commonsuffix.buffer()));
-                     
-                    // remove the bytes that were in the common suffix
-                    mergedInsert.shrink(commonsuffix.bytes());
-                    mergedDelete.shrink(commonsuffix.bytes());
-                }
+        // position in the second input (equal data only holds its offset in the first input)
+        size_t position2 = 0;
 
-                // the merge update operations are no added to the diffs
-                if (mergedDelete.bytes() > 0) _diffs.emplace(iter, Operation::DELETE, std::move(mergedDelete));
-                if (mergedInsert.bytes() > 0) _diffs.emplace(iter, Operation::INSERT, std::move(mergedInsert));
-            
-                // reset the merged texts
-                mergedInsert.clear();
-                mergedDelete.clear();
-                break;
+        // go iterate (the index refers to the diffs as they were before this pass)
+        for (size_t index = 0; r < size; ++index)
+        {
+            // the diff to process (this is a copy, because its slot may be overwritten)
+            Diff diff = _diffs[r++];
+
+            // number of bytes of the diff, before its neighbours are merged into it
+            size_t bytes = diff.bytes();
+
+            // is this an update, or equal data that should be replaced?
+            if (diff.operation() != Operation::EQUAL) updates.append(diff.operation(), diff.offset(), bytes);
+            else if (dropped != nullptr && (*dropped)[index])
+            {
+                // the data is deleted from the first input, and inserted at the same place in the second input
+                updates.append(Operation::DELETE, diff.offset(), bytes);
+                updates.append(Operation::INSERT, position2, bytes);
             }
+
+            // otherwise the updates in front of the equal data are complete
+            else reduce(updates, &diff, w, r, size, shifts);
+
+            // update the position
+            if (diff.operation() != Operation::DELETE) position2 += bytes;
         }
+
+        // the diffs could end with updates
+        reduce(updates, nullptr, w, r, size, shifts);
+
+        // remove the leftovers
+        _diffs.resize(w, Diff(Operation::EQUAL, 0, 0));
+
+        // record the pass
+        if (stats) stats->normalize(shifts);
     }
-    
+
     /**
-     *  Method to merge subsequent EQUAL operations into a single EQUAL operation
+     *  Write the updates that were collected in front of an EQUAL operation
+     *  @param  updates     the collected updates (these are reset, unless the edit is shifted to the right)
+     *  @param  next        the EQUAL operation behind the updates (nullptr at the end of the diffs)
+     *  @param  w           position where the next diff is written
+     *  @param  r           position of the next diff that is read
+     *  @param  size        number of diffs
+     *  @param  shifts      number of edits that were shifted
      */
-    void mergeEquals()
+    void reduce(Updates &updates, Diff *next, size_t &w, size_t &r, size_t &size, size_t &shifts)
     {
-        // iterator to the begin of a serie of EQUAL-operations
-        auto begin = _diffs.end();
-        
-        // total size of all EQUAL operations
-        size_t size = 0;
-        
-        // number of operations
-        size_t count = 0;
-        
-        // go iterate
-        for (auto iter = _diffs.begin(); iter != _diffs.end(); ++iter)
-        {
-            // check the operation at this position
-            if (iter->operation() == Operation::EQUAL)
-            {
-                // is this the begin?
-                if (count == 0) begin = iter;
-                
-                // update counters
-                ++count; size += iter->bytes();
-            }
-            else if (count > 1)
-            {
-                // we are going to insert one big EQUAL operation that combines all others
-                _diffs.emplace(begin, Operation::EQUAL, size, begin, iter);
-                
-                // and remove the discovered set of operations
-                _diffs.erase(begin, iter);
-                
-                // erase the administration
-                begin = _diffs.end(); size = 0; count = 0;
-            }
-            else
-            {
-                // this was a range of only one operation, so can be kept
-                begin = _diffs.end(); size = 0; count = 0;
-            }
-        }
-        
-        // done if this was all
-        if (count < 2) return;
-        
-        // merge the final EQUAL's
-        _diffs.emplace(begin, Operation::EQUAL, size, begin, _diffs.end());
-        
-        // remove the range of EQUAL operations
-        _diffs.erase(begin, _diffs.end());
-    }
-    
-    /**
-     *  Shift single edits that are surrounded by EQUAL operations
-     *  e.g: A<ins>BA</ins>C -> <ins>AB</ins>AC
-     *  @return size_t      number of changes
-     */
-    size_t shift()
-    {
-        // number of changes
-        size_t changes = 0;
-        
-        // we need a couple of iterators
-        auto prev    = _diffs.begin();
-        auto current = std::next(prev);
-        auto next    = std::next(current);
-        
-        // iterate over all the diffs
-        while (next != _diffs.end())
+        // the updates are reduced again after every shift to the left
+        while (true)
         {
-            // we are looking for operations that are surrounded by equalities,
-            // and we do this by looking at the current iter position, and 
-            // position - 1 and position - 2, if current diff is not EQUALS,
-            // then checking the previous ones is pointless anywat
-            if (next->operation() != Operation::EQUAL) continue;
-            
-            // things are pointless if the operation is not an update, or when
-            // the start EQUALS is not even a real EQUAL operation
-            if (current->operation() == Operation::EQUAL) continue;
-            if (prev->operation() != Operation::EQUAL) continue;
-            
-            // do the comparison
-            if (current->bytes() >= prev->bytes() && current->compare(current->bytes() - prev->bytes(), prev->bytes(), *prev) == 0)
+            // number of bytes in the common suffix
+            size_t suffix = 0;
+
+            // the inserted and deleted data could start or end with the same text
+            if (updates.inserted > 0 && updates.deleted > 0)
             {
-                // shift the edit over the previous equals operation
-                current->shrink(prev->bytes());
-                current->prepend(*prev);
-                next->prepend(*prev);
-                
-                // remove the first EQUALS operation
-                _diffs.erase(prev);
-                
-                // remember that something changed
-                ++changes;
+                // wrap the texts
+                text_t text1(Elements<text_t>::substring(_input2, updates.insertOffset, updates.inserted));
+                text_t text2(Elements<text_t>::substring(_input1, updates.deleteOffset, updates.deleted));
+
+                // check if the inserting and deleting start with the same text?
+                CommonPrefix<text_t> commonprefix(text1, text2);
+
+                // the remaining texts once the prefix is removed
+                text_t remain1(text1.substr(commonprefix.characters()));
+                text_t remain2(text2.substr(commonprefix.characters()));
+
+                // and is there a common suffix too?
+                CommonSuffix<text_t> commonsuffix(remain1, remain2);
+
+                // number of bytes in the common prefix and suffix
+                size_t prefix = commonprefix.bytes();
+                suffix = commonsuffix.bytes();
+
+                // the common prefix is added to the previous EQUAL operation, or it becomes the first operation
+                if (prefix > 0 && w > 0) _diffs[w - 1].append(prefix);
+                else if (prefix > 0) push(Diff(Operation::EQUAL, updates.deleteOffset, prefix), w, r, size);
+
+                // the common suffix is added to the next EQUAL operation (at the end of the diffs it is written later)
+                if (suffix > 0 && next != nullptr) next->prepend(suffix);
+
+                // the prefix and suffix are no longer part of the updates
+                updates.insertOffset += prefix; updates.inserted -= prefix + suffix;
+                updates.deleteOffset += prefix; updates.deleted -= prefix + suffix;
             }
-            else if (current->bytes() >= next->bytes() && current->compare(0, next->bytes(), *next) == 0)
+
+            // a single edit between two EQUAL operations could be shifted
+            if (next != nullptr && w > 0 && (updates.inserted == 0) != (updates.deleted == 0))
             {
-                // shift the edit over the next equals operation
-                prev->append(*next);
-                current->skip(next->bytes());
-                current->append(*next);
-                
-                // remove the second EQUALS operation
-                next = _diffs.erase(next);
-                
-                // remember that something changed
-                ++changes;
+                // the edit, and the EQUAL operation in front of it
+                bool inserting = updates.inserted > 0;
+                Diff edit(inserting ? Operation::INSERT : Operation::DELETE, inserting ? updates.insertOffset : updates.deleteOffset, inserting ? updates.inserted : updates.deleted);
+                Diff &prev = _diffs[w - 1];
+
+                // does the edit end with the previous EQUAL operation? then it is shifted to the left
+                if (edit.bytes() >= prev.bytes() && memcmp(data(edit) + edit.bytes() - prev.bytes(), data(prev), prev.bytes()) == 0)
+                {
+                    // the next EQUAL operation takes over the data of the previous one
+                    size_t bytes = prev.bytes();
+                    ++shifts;
+                    next->prepend(bytes);
+
+                    // the previous EQUAL operation is removed, and the edit starts earlier
+                    if (inserting) updates.insertOffset -= bytes; else updates.deleteOffset -= bytes;
+                    --w;
+
+                    // the edit now connects to the updates in front of it, these are collected again
+                    for (; w > 0 && _diffs[w - 1].operation() != Operation::EQUAL; --w) updates.prepend(_diffs[w - 1]);
+
+                    // reduce the combined updates
+                    continue;
+                }
+
+                // does the edit start with the next EQUAL operation? then it is shifted to the right
+                if (edit.bytes() >= next->bytes() && memcmp(data(edit), data(*next), next->bytes()) == 0)
+                {
+                    // the previous EQUAL operation takes over the data of the next one, which is removed
+                    prev.append(next->bytes());
+                    ++shifts;
+
+                    // the edit starts later, and remains open because it connects to the updates behind it
+                    if (inserting) updates.insertOffset += next->bytes(); else updates.deleteOffset += next->bytes();
+
+                    // done
+                    return;
+                }
             }
-            
-            // move the iterators for the next iteration
-            prev = current; current = next; ++next;
+
+            // write the updates
+            if (updates.deleted > 0) push(Diff(Operation::DELETE, updates.deleteOffset, updates.deleted), w, r, size);
+            if (updates.inserted > 0) push(Diff(Operation::INSERT, updates.insertOffset, updates.inserted), w, r, size);
+
+            // at the end of the diffs, the common suffix is the last operation
+            if (next == nullptr && suffix > 0) push(Diff(Operation::EQUAL, updates.deleteOffset + updates.deleted, suffix), w, r, size);
+
+            // the next EQUAL operation is merged with the previous one if there were no updates in between
+            else if (next != nullptr && w > 0 && _diffs[w - 1].operation() == Operation::EQUAL) _diffs[w - 1].append(next->bytes());
+            else if (next != nullptr) push(*next, w, r, size);
+
+            // start collecting again
+            updates = Updates();
+
+            // done
+            return;
         }
-        
-        // done
-        return changes > 0;
+    }
+
+    /**
+     *  Write a diff while the array is normalized
+     *  @param  diff        the diff to write
+     *  @param  w           position where the diff is written
+     *  @param  r           position of the next diff that is read
+     *  @param  size        number of diffs
+     */
+    void push(const Diff &diff, size_t &w, size_t &r, size_t &size)
+    {
+        // in rare situations (at the begin or end of the patch) we need more room than we have
+        if (w == r) { _diffs.insert(_diffs.begin() + w, diff); ++r; ++size; }
+
+        // normally the diff overwrites one that has already been read
+        else _diffs[w] = diff;
+
+        // one more diff was written
+        ++w;
+    }
+
+    /**
+     *  Run the optional cleanup passes, this is only done for the top-level patch
+     *  @param  limits      object with limits / settings for the algorithm
+     */
+    void cleanup(const Limits &limits)
+    {
+        // the passes decide which equalities are dropped, normalizing merges them into the edits
+        Cleanup<text_t> cleanup(_input1, _input2);
+
+        // make the patch easier to read for humans, and extract the overlaps
+        if (limits.semantic && cleanup.semantic(_diffs)) normalize(limits.stats, &cleanup.dropped());
+        if (limits.semantic) cleanup.overlaps(_diffs);
+
+        // make the patch cheaper to store and apply
+        if (limits.efficient && cleanup.efficiency(_diffs, std::max(limits.editcost, (short)0))) normalize(limits.stats, &cleanup.dropped());
     }
 };
 
@@ -478,4 +1727,3 @@ private:
  *  End of namespace
  */
 }
-
@@ -0,0 +1,179 @@
+/**
+ *  Patience.h
+ *
+ *  Class that finds the anchors of the patience diff algorithm (as it was
+ *  described by Bram Cohen) in two arrays of tokens. The anchors are the
+ *  tokens that appear exactly once in both texts, and of these, the longest
+ *  serie that has the same order in both texts is used (this is found with
+ *  patience sorting, hence the name). The texts are split at the anchors,
+ *  and the parts in between are solved separately.
+ *
+ *  Tokens that appear more than once (like blank lines or closing tags) are
+ *  never used as anchor. If there are no unique common tokens at all, no
+ *  anchors are found, and the texts should be diffed with an other algorithm.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "arena.h"
+#include "tokentable.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Patience
+{
+private:
+    /**
+     *  Positions of the anchors in the first and second text, in ascending order
+     *  @var std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> _x;
+    std::vector<uint32_t, Allocator<uint32_t>> _y;
+
+public:
+    /**
+     *  Constructor
+     *  @param  text1       tokens of the first text
+     *  @param  size1       number of tokens of the first text
+     *  @param  text2       tokens of the second text
+     *  @param  size2       number of tokens of the second text
+     *  @param  arena       arena for the anchors and the temporary arrays (nullptr for the heap)
+     */
+    Patience(const uint32_t *text1, size_t size1, const uint32_t *text2, size_t size2, Arena *arena = nullptr) :
+        _x(Allocator<uint32_t>(arena)),
+        _y(Allocator<uint32_t>(arena))
+    {
+        // the distinct tokens of the first text
+        TokenTable table(size1, arena);
+
+        // the number of occurrences of each entry in both texts, and the position in the second text
+        std::vector<uint32_t, Allocator<uint32_t>> counts1{Allocator<uint32_t>(arena)};
+        std::vector<uint32_t, Allocator<uint32_t>> counts2{Allocator<uint32_t>(arena)};
+        std::vector<uint32_t, Allocator<uint32_t>> positions2{Allocator<uint32_t>(arena)};
+
+        // count the tokens of the first text
+        for (size_t i = 0; i < size1; ++i)
+        {
+            // the entry of the token
+            size_t entry = table.insert(text1[i]);
+
+            // a new entry needs room
+            if (entry == counts1.size()) { counts1.push_back(0); counts2.push_back(0); positions2.push_back(0); }
+
+            // count the token
+            ++counts1[entry];
+        }
+
+        // count the tokens of the second text (only the ones that appear in the first text)
+        for (size_t j = 0; j < size2; ++j)
+        {
+            // the entry of the token
+            ssize_t entry = table.find(text2[j]);
+            if (entry < 0) continue;
+
+            // count the token
+            ++counts2[entry];
+            positions2[entry] = j;
+        }
+
+        // the unique common tokens in the order of the first text (the candidates): their positions
+        // in both texts, and the candidate in front of them in the serie plus one (zero for none)
+        std::vector<uint32_t, Allocator<uint32_t>> candidates1{Allocator<uint32_t>(arena)};
+        std::vector<uint32_t, Allocator<uint32_t>> candidates2{Allocator<uint32_t>(arena)};
+        std::vector<uint32_t, Allocator<uint32_t>> previous{Allocator<uint32_t>(arena)};
+
+        // the candidate at the top of each pile (the positions of these candidates in the second text are ascending)
+        std::vector<uint32_t, Allocator<uint32_t>> piles{Allocator<uint32_t>(arena)};
+
+        // deal the candidates over the piles
+        for (size_t i = 0; i < size1; ++i)
+        {
+            // the entry of the token (it is known, because all tokens of the first text were inserted)
+            size_t entry = table.find(text1[i]);
+
+            // only unique common tokens are candidates
+            if (counts1[entry] != 1 || counts2[entry] != 1) continue;
+
+            // the position in the second text
+            uint32_t position = positions2[entry];
+
+            // the left-most pile with a bigger position at the top
+            size_t pile = std::upper_bound(piles.begin(), piles.end(), position, [&candidates2](uint32_t value, uint32_t candidate) { return value < candidates2[candidate]; }) - piles.begin();
+
+            // store the candidate, it is preceded by the top of the pile on the left
+            previous.push_back(pile == 0 ? 0 : piles[pile - 1] + 1);
+            candidates1.push_back(i);
+            candidates2.push_back(position);
+
+            // put the candidate on top of the pile
+            if (pile == piles.size()) piles.push_back(candidates1.size() - 1); else piles[pile] = candidates1.size() - 1;
+        }
+
+        // the longest serie has one anchor from every pile
+        _x.resize(piles.size());
+        _y.resize(piles.size());
+
+        // walk back over the serie, it ends at the top of the right-most pile
+        size_t index = piles.size();
+        for (uint32_t link = piles.empty() ? 0 : piles.back() + 1; link != 0; link = previous[link - 1])
+        {
+            // store the anchor
+            --index; _x[index] = candidates1[link - 1]; _y[index] = candidates2[link - 1];
+        }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Patience() = default;
+
+    /**
+     *  Were anchors found?
+     *  @return bool
+     */
+    bool valid() const { return !_x.empty(); }
+
+    /**
+     *  Cast to boolean
+     *  @return bool
+     */
+    operator bool () const { return valid(); }
+    bool operator! () const { return !valid(); }
+
+    /**
+     *  Number of anchors
+     *  @return size_t
+     */
+    size_t size() const { return _x.size(); }
+
+    /**
+     *  Position of an anchor in the two texts
+     *  @param  index       index of the anchor
+     *  @return size_t
+     */
+    size_t x(size_t index) const { return _x[index]; }
+    size_t y(size_t index) const { return _y[index]; }
+};
+
+/**
+ *  End of namespace
+ */
+}
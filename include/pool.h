@@ -0,0 +1,366 @@
+/**
+ *  Pool.h
+ *
+ *  Work-stealing thread pool. Each worker thread has its own queue of tasks:
+ *  tasks that are pushed by a worker end up in its own queue, so that they
+ *  are picked up by that same worker (newest first), unless an idle worker
+ *  steals them (oldest first, because these are normally the biggest).
+ *
+ *  A thread that waits for a task helps with the tasks that descend from it:
+ *  the task itself if it is still queued, and the tasks that it pushed while
+ *  it ran in an other thread. Other tasks are left alone, so that the waiting
+ *  thread is not held up by unrelated work when its task finishes. If there
+ *  is nothing to help with, the thread blocks until a task finishes or a new
+ *  one is pushed. A task only waits for the tasks that it pushed itself, so
+ *  tasks may push new tasks and wait for them without the risk of a deadlock,
+ *  even if all workers are busy.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "task.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Pool
+{
+private:
+    /**
+     *  The queue of a worker
+     */
+    struct Queue
+    {
+        /**
+         *  Lock to protect the tasks
+         *  @var std::mutex
+         */
+        std::mutex mutex;
+
+        /**
+         *  The tasks
+         *  @var std::deque
+         */
+        std::deque<Task *> tasks;
+    };
+
+    /**
+     *  The queues, one for each worker
+     *  @var std::vector
+     */
+    std::vector<std::unique_ptr<Queue>> _queues;
+
+    /**
+     *  The worker threads
+     *  @var std::vector
+     */
+    std::vector<std::thread> _threads;
+
+    /**
+     *  Number of tasks that are in the queues
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _pending;
+
+    /**
+     *  Index of the queue that gets the next task that is pushed by a thread that is not a worker
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _next;
+
+    /**
+     *  Is the pool being destructed?
+     *  @var bool
+     */
+    bool _stopped = false;
+
+    /**
+     *  Lock and condition variable to wake up idle workers
+     *  @var std::mutex
+     *  @var std::condition_variable
+     */
+    std::mutex _mutex;
+    std::condition_variable _condition;
+
+    /**
+     *  Condition variable to wake up the threads that wait for a task (this uses the same lock),
+     *  and the number of tasks that were pushed or finished (a waiting thread wakes up when it changes)
+     *  @var std::condition_variable
+     *  @var std::atomic
+     */
+    std::condition_variable _waiting;
+    std::atomic<size_t> _events;
+
+    /**
+     *  The worker that is running in the current thread
+     *  @return size_t      index of the worker, or the number of workers if the thread is not a worker of this pool
+     */
+    size_t current() const
+    {
+        // if this is a worker of this pool, the pool and the index are stored in thread local storage
+        return self() == this ? index() : _queues.size();
+    }
+
+    /**
+     *  Thread local storage with the pool and index of the worker in the current thread
+     *  @return Pool*
+     *  @return size_t
+     */
+    static const Pool *&self() { static thread_local const Pool *pool = nullptr; return pool; }
+    static size_t &index() { static thread_local size_t index = 0; return index; }
+
+    /**
+     *  Thread local storage with the task that is running in the current thread
+     *  @return Task*
+     */
+    static const Task *&running() { static thread_local const Task *task = nullptr; return task; }
+
+    /**
+     *  Something happened that a waiting thread could be interested in
+     */
+    void changed()
+    {
+        // count the event (the lock prevents that the wakeup is missed)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _events.fetch_add(1);
+        }
+
+        // wake up the waiting threads
+        _waiting.notify_all();
+    }
+
+    /**
+     *  Run a task in the current thread
+     *  @param  task
+     */
+    void execute(Task *task)
+    {
+        // the tasks that are pushed while this task runs descend from it
+        const Task *previous = running();
+        running() = task;
+
+        // run the task
+        task->run();
+
+        // back to the task that was running before
+        running() = previous;
+
+        // a thread could be waiting for it
+        changed();
+    }
+
+    /**
+     *  Take a task from one of the queues
+     *  @param  worker      the worker that is looking for a task (or the number of workers)
+     *  @param  awaited     only take a task that descends from this task (nullptr for any task)
+     *  @return Task*       the task, or nullptr if there is no such task
+     */
+    Task *take(size_t worker, const Task *awaited = nullptr)
+    {
+        // nothing to take if all queues are empty
+        if (_pending.load() == 0) return nullptr;
+
+        // the number of queues
+        size_t count = _queues.size();
+
+        // first try the own queue (newest task first), then steal from the others (oldest task first)
+        for (size_t i = 0; i < count; ++i)
+        {
+            // the queue to take from
+            size_t victim = (worker + i) % count;
+            Queue &queue = *_queues[victim];
+
+            // lock the queue
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            // the position of the task to take, the own queue is searched from the back
+            size_t size = queue.tasks.size(), position = 0;
+            for (; position < size; ++position)
+            {
+                // the candidate
+                Task *candidate = queue.tasks[victim == worker ? size - 1 - position : position];
+
+                // leap out if we can take this one
+                if (awaited == nullptr || candidate->descends(awaited)) break;
+            }
+
+            // skip queues without such a task
+            if (position == size) continue;
+
+            // take the task
+            auto iter = victim == worker ? queue.tasks.end() - 1 - position : queue.tasks.begin() + position;
+            Task *task = *iter;
+            queue.tasks.erase(iter);
+
+            // one task less
+            _pending.fetch_sub(1);
+
+            // done
+            return task;
+        }
+
+        // nothing found
+        return nullptr;
+    }
+
+    /**
+     *  Main function of a worker thread
+     *  @param  worker      index of the worker
+     */
+    void run(size_t worker)
+    {
+        // remember who we are
+        self() = this;
+        index() = worker;
+
+        // keep running tasks
+        while (true)
+        {
+            // run a task if there is one
+            if (Task *task = take(worker)) { execute(task); continue; }
+
+            // wait until there is work to do
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stopped || _pending.load() > 0; });
+
+            // leap out if the pool is stopped
+            if (_stopped) return;
+        }
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  threads     number of worker threads
+     */
+    Pool(size_t threads = std::thread::hardware_concurrency()) : _pending(0), _next(0), _events(0)
+    {
+        // we need at least one worker
+        if (threads == 0) threads = 1;
+
+        // create the queues before the threads are started
+        for (size_t i = 0; i < threads; ++i) _queues.emplace_back(new Queue());
+
+        // start the threads
+        for (size_t i = 0; i < threads; ++i) _threads.emplace_back(&Pool::run, this, i);
+    }
+
+    /**
+     *  Pools can not be copied
+     *  @param  that
+     */
+    Pool(const Pool &that) = delete;
+
+    /**
+     *  Destructor, all tasks must have finished before the pool is destructed
+     */
+    virtual ~Pool()
+    {
+        // tell the workers to stop
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopped = true;
+        }
+
+        // wake them up
+        _condition.notify_all();
+
+        // wait for them
+        for (auto &thread : _threads) thread.join();
+    }
+
+    /**
+     *  Number of worker threads
+     *  @return size_t
+     */
+    size_t size() const { return _threads.size(); }
+
+    /**
+     *  Push a task, it is picked up by one of the workers (or by the thread
+     *  that waits for it). The task object must stay valid until wait() returns.
+     *  @param  task
+     */
+    void push(Task *task)
+    {
+        // the task descends from the task that pushes it
+        task->_parent = running();
+
+        // the worker that pushes the task, or a round robin queue for other threads
+        size_t worker = current();
+        if (worker == _queues.size()) worker = _next.fetch_add(1) % _queues.size();
+
+        // add to the queue
+        {
+            std::lock_guard<std::mutex> lock(_queues[worker]->mutex);
+            _queues[worker]->tasks.push_back(task);
+        }
+
+        // one more task to run
+        _pending.fetch_add(1);
+
+        // wake up an idle worker (the lock prevents that the wakeup is missed)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+        }
+        _condition.notify_one();
+
+        // a waiting thread could help with it
+        changed();
+    }
+
+    /**
+     *  Wait for a task to finish, the task and the tasks that descend from it are
+     *  run in the meantime. If the task threw an exception, it is rethrown here.
+     *  The bytes that the task copied are counted for the current thread.
+     *  @param  task
+     */
+    void wait(Task *task)
+    {
+        // the worker that is waiting
+        size_t worker = current();
+
+        // help until the task is ready
+        while (!task->finished())
+        {
+            // the events so far (a task that is pushed or finished after this wakes us up)
+            size_t events = _events.load();
+
+            // run the task, or a task that it pushed
+            if (Task *other = take(worker, task)) { execute(other); continue; }
+
+            // otherwise wait until something happens
+            std::unique_lock<std::mutex> lock(_mutex);
+            _waiting.wait(lock, [this, task, events]() { return task->finished() || _events.load() != events; });
+        }
+
+        // pass on the exception
+        task->join();
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
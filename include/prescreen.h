@@ -0,0 +1,75 @@
+/**
+ *  Prescreen.h
+ *
+ *  Class that decides with the fingerprints of two texts whether the diff
+ *  can be skipped because the texts are unrelated: the first text is then
+ *  replaced by the second one as a whole.
+ *
+ *  The fingerprints are not used to recognize identical texts. Their hash is
+ *  not collision-resistant, so equal hashes prove nothing, and identical
+ *  texts are recognized by the algorithm itself in a single compare anyway.
+ *  A collision of the sketches only makes the texts look more similar, and
+ *  then the algorithm runs, so a wrong fingerprint never causes a wrong patch.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "fingerprint.h"
+#include "limits.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Prescreen
+{
+private:
+    /**
+     *  Are the texts unrelated?
+     *  @var bool
+     */
+    bool _unrelated;
+
+public:
+    /**
+     *  Constructor
+     *  @param  limits          object with limits / settings for the algorithm
+     *  @param  bytes1          number of bytes of the base string
+     *  @param  fingerprint1    fingerprint of the base string
+     *  @param  bytes2          number of bytes of the string to compare
+     *  @param  fingerprint2    fingerprint of the string to compare
+     */
+    Prescreen(const Limits &limits, size_t bytes1, const Fingerprint &fingerprint1, size_t bytes2, const Fingerprint &fingerprint2) :
+        // fingerprints of other texts are useless, and a zero threshold always runs the algorithm
+        _unrelated(fingerprint1.bytes() == bytes1 && fingerprint2.bytes() == bytes2 && limits.similarity > 0.0f &&
+                   fingerprint1.similarity(fingerprint2) < limits.similarity) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Prescreen() = default;
+
+    /**
+     *  Can the diff be skipped, because the texts are unrelated?
+     *  @return bool
+     */
+    bool unrelated() const { return _unrelated; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,668 @@
+/**
+ *  ResumableDiff.h
+ *
+ *  Class to calculate a patch in small steps, for programs that run an event
+ *  loop in a single thread: a big diff would otherwise block all other work
+ *  of the loop. Every call to step() works for about the given time, and then
+ *  returns, so that the loop can do other things in between. The object keeps
+ *  all state of the algorithm, so the next call continues where the previous
+ *  one stopped. The calculation can be cancelled between the steps.
+ *
+ *  The algorithm is the same as the one of a normal patch, but instead of
+ *  recursion it uses a stack with the ranges of the texts that still have to
+ *  be solved. The stack is processed from the front of the texts to the end,
+ *  so the diffs are found in order. Small ranges are solved right away with a
+ *  normal sub-patch. For bigger ranges the middle snake is searched, and that
+ *  search pauses at its deadline checks (every couple of thousand diagonals)
+ *  when the time of the step is up. With the checklines flag, the lines are
+ *  diffed first (in steps too), and the replaced lines are then diffed again
+ *  character by character.
+ *
+ *  The timeout of the limits is the total time that the steps may take (the
+ *  time in between is not counted). Once the timeout has passed, every range
+ *  that remains is solved with a sub-patch that is past its deadline, just
+ *  like a normal patch does. The patch is normalized and cleaned up in the
+ *  last step.
+ *
+ *  Only the middle snake search is split up. The linear passes over the texts
+ *  run in one go: decoding utf8 texts, splitting the texts into lines,
+ *  clearing the V-arrays when the search of a big range starts, and
+ *  normalizing the patch at the end. These take a couple of milliseconds per
+ *  megabyte.
+ *
+ *  A resumable diff can not be used by multiple threads at the same time, and
+ *  the texts must stay valid until it is finished.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "arena.h"
+#include "ascii.h"
+#include "deadline.h"
+#include "elements.h"
+#include "limits.h"
+#include "middlesnake.h"
+#include "mismatch.h"
+#include "patch.h"
+#include "scratch.h"
+#include "tokens.h"
+#include "utf8.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t = Ascii>
+class ResumableDiff
+{
+private:
+    /**
+     *  The elements that are compared (bytes, tokens or code points), and the
+     *  type of text over an array of these elements
+     */
+    typedef typename Elements<text_t>::type char_t;
+    typedef typename std::conditional<sizeof(char_t) == 1, Ascii, Tokens>::type array_t;
+
+    /**
+     *  Ranges that are at most this number of elements big (in both texts) are solved
+     *  right away with a normal sub-patch, this takes at most about a hundred microseconds
+     *  @var size_t
+     */
+    static const size_t smallsize = 256;
+
+    /**
+     *  Texts with more elements than this are first diffed line by line (if checklines is set)
+     *  @var size_t
+     */
+    static const size_t linesize = 100;
+
+    /**
+     *  A range of the texts on the stack (in elements)
+     */
+    struct Range
+    {
+        /**
+         *  Start and end in the first text
+         *  @var size_t
+         */
+        size_t begin1;
+        size_t end1;
+
+        /**
+         *  Start and end in the second text
+         *  @var size_t
+         */
+        size_t begin2;
+        size_t end2;
+
+        /**
+         *  Is the range known to be equal? (only the first text is used then)
+         *  @var bool
+         */
+        bool equal;
+
+        /**
+         *  Should the lines be diffed first?
+         *  @var bool
+         */
+        bool checklines;
+    };
+
+    /**
+     *  The stages of the algorithm
+     */
+    enum class Stage { PREPARE, LINES, RANGES, FINISHED, CANCELLED };
+
+    /**
+     *  Resumable diffs over the lines are our friends
+     */
+    template <typename> friend class ResumableDiff;
+
+    /**
+     *  Object with limits / settings for the algorithm
+     *  @var Limits
+     */
+    Limits _limits;
+
+    /**
+     *  The texts to compare
+     *  @var text_t
+     */
+    text_t _input1;
+    text_t _input2;
+
+    /**
+     *  Speedup flag
+     *  @var bool
+     */
+    bool _checklines;
+
+    /**
+     *  Working memory of the algorithm
+     *  @var Arena
+     *  @var Scratch
+     */
+    Arena _arena;
+    Scratch _scratch;
+
+    /**
+     *  The decoded code points of utf8 texts (not used for the other texts)
+     *  @var std::vector
+     */
+    std::vector<uint32_t> _codepoints1;
+    std::vector<uint32_t> _codepoints2;
+
+    /**
+     *  The elements of both texts, and their number
+     *  @var const char_t *
+     *  @var size_t
+     */
+    const char_t *_text1 = nullptr;
+    const char_t *_text2 = nullptr;
+    size_t _size1 = 0;
+    size_t _size2 = 0;
+
+    /**
+     *  The current stage
+     *  @var Stage
+     */
+    Stage _stage = Stage::PREPARE;
+
+    /**
+     *  The ranges that still have to be solved, the range at the front of the texts is at the top
+     *  @var std::vector
+     */
+    std::vector<Range> _stack;
+
+    /**
+     *  The middle snake search of a range that is paused, and that range
+     *  @var std::unique_ptr
+     *  @var Range
+     */
+    std::unique_ptr<MiddleSnake<char_t>> _snake;
+    Range _range;
+
+    /**
+     *  The diff over the lines (only during the lines stage), and the range of the
+     *  texts that it covers
+     *  @var std::unique_ptr
+     *  @var Range
+     */
+    std::unique_ptr<ResumableDiff<Tokens>> _lines;
+    Range _linerange;
+
+    /**
+     *  The time that the steps took so far, and is the timeout of the limits passed?
+     *  @var std::chrono::steady_clock::duration
+     *  @var bool
+     */
+    std::chrono::steady_clock::duration _elapsed;
+    bool _expired = false;
+
+    /**
+     *  A deadline that has already passed (for the searches after the timeout), and
+     *  one that never passes (for the small sub-patches before the timeout)
+     *  @var Deadline
+     */
+    Deadline _past;
+    Deadline _never;
+
+    /**
+     *  The positions (in elements) up to which the diffs were found
+     *  @var size_t
+     */
+    size_t _position1 = 0;
+    size_t _position2 = 0;
+
+    /**
+     *  The result
+     *  @var Patch
+     */
+    Patch<text_t> _patch;
+
+    /**
+     *  The array of elements of a text with fixed-width characters
+     *  @param  text        the text
+     *  @param  codepoints  array for decoded code points (not used)
+     *  @return const char_t *
+     */
+    template <typename input_t>
+    static const char_t *elements(const input_t &text, std::vector<uint32_t> &) { return Elements<input_t>::data(text); }
+
+    /**
+     *  The array of code points of an utf8 text, the text is decoded
+     *  @param  text        the text
+     *  @param  codepoints  array for the code points
+     *  @return const uint32_t *
+     */
+    static const uint32_t *elements(const Utf8 &text, std::vector<uint32_t> &codepoints)
+    {
+        // decode the text
+        codepoints.reserve(text.characters());
+        for (auto codepoint : text) codepoints.push_back(codepoint);
+
+        // expose the array
+        return codepoints.data();
+    }
+
+    /**
+     *  Byte offset of an element in a text with fixed-width characters
+     *  @param  text        the text
+     *  @param  element     index of the element
+     *  @return size_t
+     */
+    template <typename input_t>
+    static size_t offset(const input_t &, size_t element) { return element * sizeof(char_t); }
+    static size_t offset(const Utf8 &text, size_t element) { return text.offset(element); }
+
+    /**
+     *  Index of the element at a byte offset in a text with fixed-width characters
+     *  @param  text        the text
+     *  @param  offset      the byte offset
+     *  @return size_t
+     */
+    template <typename input_t>
+    static size_t element(const input_t &, size_t offset) { return offset / sizeof(char_t); }
+    static size_t element(const Utf8 &text, size_t offset) { return text.character(offset); }
+
+    /**
+     *  Add a diff to the result, the diffs are found in order
+     *  @param  operation   the operation
+     *  @param  count       number of elements
+     */
+    void add(Operation operation, size_t count)
+    {
+        // empty diffs are not stored
+        if (count == 0) return;
+
+        // inserted data comes from the second text, the rest from the first one
+        const text_t &text = operation == Operation::INSERT ? _input2 : _input1;
+        size_t position = operation == Operation::INSERT ? _position2 : _position1;
+
+        // add the bytes of the elements
+        _patch.extend(operation, offset(text, position + count) - offset(text, position));
+
+        // update the positions
+        if (operation != Operation::INSERT) _position1 += count;
+        if (operation != Operation::DELETE) _position2 += count;
+    }
+
+    /**
+     *  Push a range on the stack
+     *  @param  begin1      start in the first text
+     *  @param  end1        end in the first text
+     *  @param  begin2      start in the second text
+     *  @param  end2        end in the second text
+     *  @param  equal       is the range known to be equal?
+     *  @param  checklines  should the lines be diffed first?
+     */
+    void push(size_t begin1, size_t end1, size_t begin2, size_t end2, bool equal = false, bool checklines = false)
+    {
+        // add to the top of the stack
+        _stack.push_back(Range{begin1, end1, begin2, end2, equal, checklines});
+    }
+
+    /**
+     *  Solve a range with a normal sub-patch
+     *  @param  range       the range
+     */
+    void solve(const Range &range)
+    {
+        // the texts over the elements of the range
+        array_t text1(_text1 + range.begin1, range.end1 - range.begin1);
+        array_t text2(_text2 + range.begin2, range.end2 - range.begin2);
+
+        // calculate the patch (once the timeout has passed, the sub-patch is past its deadline too)
+        Patch<array_t> patch(_limits, text1, text2, false, _expired ? _past : _never, _scratch);
+
+        // add the diffs (the sizes of the diffs are in bytes)
+        for (const auto &diff : patch._diffs) add(diff.operation(), diff.bytes() / sizeof(char_t));
+    }
+
+    /**
+     *  Start the diff over the lines of a range
+     *  @param  range       the range
+     */
+    void linemode(const Range &range)
+    {
+        // the bytes of the range in both texts
+        size_t offset1 = offset(_input1, range.begin1), offset2 = offset(_input2, range.begin2);
+        Buffer buffer1(_input1.buffer().data() + offset1, offset(_input1, range.end1) - offset1, false);
+        Buffer buffer2(_input2.buffer().data() + offset2, offset(_input2, range.end2) - offset2, false);
+
+        // convert the texts into lines (they share the dictionary, so that identical lines get identical tokens)
+        _scratch.dictionary().clear();
+        _scratch.lines1().assign(buffer1, _scratch.dictionary());
+        _scratch.lines2().assign(buffer2, _scratch.dictionary());
+
+        // the cleanup passes are only run over the final patch
+        Limits limits(_limits);
+        limits.semantic = limits.efficient = false;
+
+        // the diff over the lines is calculated in steps too
+        _lines.reset(new ResumableDiff<Tokens>(limits, _scratch.lines1().tokens(), _scratch.lines2().tokens(), false));
+        _linerange = range;
+        _stage = Stage::LINES;
+    }
+
+    /**
+     *  Push the ranges of the diff over the lines onto the stack: the equal lines
+     *  are equal ranges, and the replaced lines are diffed character by character
+     */
+    void rediff()
+    {
+        // the lines of both texts, and the byte offsets of the range
+        const Lines &lines1 = _scratch.lines1(), &lines2 = _scratch.lines2();
+        size_t offset1 = offset(_input1, _linerange.begin1), offset2 = offset(_input2, _linerange.begin2);
+
+        // the ranges in the order of the texts
+        std::vector<Range> ranges;
+
+        // current line in both texts, and the number of lines that are deleted and inserted
+        size_t line1 = 0, line2 = 0, deleted = 0, inserted = 0;
+
+        // walk over the line-diffs (an equal diff at the end flushes the last replaced lines)
+        auto &diffs = _lines->_patch._diffs;
+        for (size_t i = 0; i <= diffs.size(); ++i)
+        {
+            // number of lines in this diff
+            size_t count = i == diffs.size() ? 0 : diffs[i].bytes() / sizeof(uint32_t);
+            Operation operation = i == diffs.size() ? Operation::EQUAL : diffs[i].operation();
+
+            // replaced lines are counted
+            if (operation == Operation::DELETE) { deleted += count; continue; }
+            if (operation == Operation::INSERT) { inserted += count; continue; }
+
+            // the elements where the replaced lines start and end, and where the equal lines end
+            size_t begin1 = element(_input1, offset1 + lines1.offset(line1)), end1 = element(_input1, offset1 + lines1.offset(line1 + deleted));
+            size_t begin2 = element(_input2, offset2 + lines2.offset(line2)), end2 = element(_input2, offset2 + lines2.offset(line2 + inserted));
+            size_t equal = element(_input1, offset1 + lines1.offset(line1 + deleted + count));
+
+            // the replaced lines are diffed again, the equal lines are taken from the first text
+            if (deleted + inserted > 0) ranges.push_back(Range{begin1, end1, begin2, end2, false, false});
+            if (count > 0) ranges.push_back(Range{end1, equal, end2, end2, true, false});
+
+            // update the positions
+            line1 += deleted + count; line2 += inserted + count; deleted = inserted = 0;
+        }
+
+        // the diff over the lines is no longer needed
+        _lines.reset();
+
+        // the ranges are pushed in reverse order, so that the first one is on top
+        _stack.insert(_stack.end(), ranges.rbegin(), ranges.rend());
+        _stage = Stage::RANGES;
+    }
+
+    /**
+     *  The middle snake search of a range is ready: the halves are pushed on the
+     *  stack, or the range is replaced if the texts have nothing in common
+     *  @param  snake       the finished search
+     *  @param  range       the range of the search
+     */
+    void split(const MiddleSnake<char_t> &snake, const Range &range)
+    {
+        // record the work that the search did
+        if (Stats *stats = _scratch.stats()) stats->search(snake.steps(), snake.checks());
+
+        // without a snake, the entire range has to be replaced
+        if (!snake)
+        {
+            add(Operation::DELETE, range.end1 - range.begin1);
+            return add(Operation::INSERT, range.end2 - range.begin2);
+        }
+
+        // the split positions in both texts, and where the reverse path ended
+        size_t x = range.begin1 + snake.x(), y = range.begin2 + snake.y();
+        size_t endx = range.begin1 + snake.endx(), endy = range.begin2 + snake.endy();
+
+        // the ranges are pushed from the back to the front, so that the first one is
+        // on top (if the search was cut short, the range in between is searched again)
+        push(endx, range.end1, endy, range.end2);
+        if (snake.partial()) push(x, endx, y, endy);
+        push(range.begin1, x, range.begin2, y);
+    }
+
+    /**
+     *  Process a range from the stack
+     *  @param  range       the range
+     *  @param  deadline    when the step ends
+     */
+    void process(Range range, const Deadline &deadline)
+    {
+        // equal ranges are simply added
+        if (range.equal) return add(Operation::EQUAL, range.end1 - range.begin1);
+
+        // the common prefix of the range
+        size_t prefix = Mismatch::forward((const char *)(_text1 + range.begin1), (const char *)(_text2 + range.begin2), std::min(range.end1 - range.begin1, range.end2 - range.begin2) * sizeof(char_t)) / sizeof(char_t);
+        add(Operation::EQUAL, prefix);
+        range.begin1 += prefix; range.begin2 += prefix;
+
+        // the common suffix of the rest, this is added after the rest is solved
+        size_t suffix = Mismatch::backward((const char *)(_text1 + range.end1), (const char *)(_text2 + range.end2), std::min(range.end1 - range.begin1, range.end2 - range.begin2) * sizeof(char_t)) / sizeof(char_t);
+        if (suffix > 0) push(range.end1 - suffix, range.end1, range.end2 - suffix, range.end2, true);
+        range.end1 -= suffix; range.end2 -= suffix;
+
+        // the number of elements that remain
+        size_t size1 = range.end1 - range.begin1, size2 = range.end2 - range.begin2;
+
+        // if one of the texts is empty, the diff is really simple
+        if (size1 == 0 || size2 == 0) { add(Operation::DELETE, size1); return add(Operation::INSERT, size2); }
+
+        // small ranges are solved right away
+        if (size1 <= smallsize && size2 <= smallsize) return solve(range);
+
+        // once the timeout has passed, the search is limited to a small number of edit steps
+        // (the parts that its paths reached are pushed on the stack, just like its halves)
+        if (_expired) return split(MiddleSnake<char_t>(_text1 + range.begin1, size1, _text2 + range.begin2, size2, _past, _scratch, _limits.anytime), range);
+
+        // texts of characters can be diffed line by line first (the lines stage calculates a patch over tokens)
+        if (range.checklines && !std::is_same<text_t, Tokens>::value && size1 > linesize && size2 > linesize) return linemode(range);
+
+        // search the middle snake (the search pauses when the step ends)
+        _snake.reset(new MiddleSnake<char_t>(_text1 + range.begin1, size1, _text2 + range.begin2, size2, deadline, _scratch, 0, true));
+        _range = range;
+
+        // if the search is ready, the range is split
+        if (!_snake->paused()) { split(*_snake, range); _snake.reset(); }
+    }
+
+    /**
+     *  Prepare the texts: the utf8 texts are decoded, and the entire texts are the first range
+     */
+    void prepare()
+    {
+        // the arrays of elements
+        _text1 = elements(_input1, _codepoints1);
+        _text2 = elements(_input2, _codepoints2);
+        _size1 = _input1.characters();
+        _size2 = _input2.characters();
+
+        // the entire texts have to be solved
+        push(0, _size1, 0, _size2, false, _checklines);
+        _stage = Stage::RANGES;
+    }
+
+    /**
+     *  All ranges were solved: the patch is normalized and cleaned up
+     */
+    void finish()
+    {
+        // normalize the diffs
+        _patch.normalize(_scratch.stats());
+
+        // run the optional cleanup passes
+        _patch.cleanup(_limits);
+
+        // the patch is ready
+        _stage = Stage::FINISHED;
+    }
+
+    /**
+     *  Run the algorithm until it is finished or until the step ends
+     *  @param  deadline    when the step ends
+     */
+    void run(const Deadline &deadline)
+    {
+        // keep going until the step ends (but always do some work)
+        do
+        {
+            // check the stage
+            switch (_stage) {
+            case Stage::PREPARE:
+                // decode the texts
+                prepare();
+                break;
+
+            case Stage::LINES:
+                // the diff over the lines runs in the same step, and it has the same timeout
+                _lines->_expired = _expired;
+                _lines->run(deadline);
+
+                // once it is finished, its ranges are processed
+                if (_lines->finished()) rediff();
+                break;
+
+            case Stage::RANGES:
+                // a paused search of a middle snake is resumed (or dropped once the timeout
+                // has passed, the range then goes back to the stack to be searched again)
+                if (_snake && _expired) { _snake.reset(); _stack.push_back(_range); }
+                else if (_snake) { _snake->resume(deadline); if (!_snake->paused()) { split(*_snake, _range); _snake.reset(); } }
+
+                // otherwise the range at the front of the texts is processed
+                else if (!_stack.empty()) { Range range = _stack.back(); _stack.pop_back(); process(range, deadline); }
+
+                // all ranges were processed
+                else finish();
+                break;
+
+            case Stage::FINISHED:
+            case Stage::CANCELLED:
+                // nothing to do
+                return;
+            }
+        }
+        while (!deadline.reached());
+    }
+
+public:
+    /**
+     *  Constructor, this does not do any work yet (that is done by the steps)
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base string
+     *  @param  input2      the string to compare
+     *  @param  checklines  tuning flag
+     */
+    ResumableDiff(const Limits &limits, const text_t &input1, const text_t &input2, bool checklines = true) :
+        _limits(limits), _input1(input1), _input2(input2), _checklines(checklines),
+        _scratch(_arena, nullptr, limits.stats),
+        _elapsed(std::chrono::steady_clock::duration::zero()),
+        _past(std::chrono::steady_clock::duration::zero()),
+        _patch(input1, input2)
+    {
+        // the deadline has to see that it passed, before the searches take notice
+        _past.reached();
+    }
+
+    /**
+     *  Resumable diffs are not supposed to be copied
+     *  @param  that
+     */
+    ResumableDiff(const ResumableDiff &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~ResumableDiff() = default;
+
+    /**
+     *  Calculate the next part of the patch. The step returns when the time is up,
+     *  the last bit of work that it does is at most a couple of thousand diagonals
+     *  of the middle snake search, a small sub-patch, or one of the linear passes.
+     *  @param  seconds     the time that the step may take (fractions are allowed, so 0.001 is 1 millisecond)
+     *  @return bool        is the patch finished?
+     */
+    bool step(double seconds)
+    {
+        // leap out if there is nothing to do
+        if (_stage == Stage::FINISHED || _stage == Stage::CANCELLED) return finished();
+
+        // the time when the step started
+        auto start = std::chrono::steady_clock::now();
+
+        // run the algorithm
+        run(Deadline(seconds > 0 ? seconds : 1e-9));
+
+        // the time of the step is counted
+        _elapsed += std::chrono::steady_clock::now() - start;
+
+        // check if the timeout of all the steps has passed
+        if (_limits.timeout > 0 && _elapsed >= std::chrono::duration<double>(_limits.timeout)) _expired = true;
+
+        // is the patch ready?
+        return finished();
+    }
+
+    /**
+     *  Stop the calculation, the patch is not finished (and stays empty)
+     */
+    void cancel()
+    {
+        // leap out if the patch is already finished
+        if (_stage == Stage::FINISHED) return;
+
+        // forget all state, and the diffs that were found so far
+        _stack.clear();
+        _snake.reset();
+        _lines.reset();
+        _patch._diffs.clear();
+        _stage = Stage::CANCELLED;
+    }
+
+    /**
+     *  Is the patch ready?
+     *  @return bool
+     */
+    bool finished() const { return _stage == Stage::FINISHED; }
+
+    /**
+     *  Was the calculation cancelled?
+     *  @return bool
+     */
+    bool cancelled() const { return _stage == Stage::CANCELLED; }
+
+    /**
+     *  The time that the steps took so far (the time between the steps is not counted)
+     *  @return double      number of seconds
+     */
+    double elapsed() const { return std::chrono::duration<double>(_elapsed).count(); }
+
+    /**
+     *  The calculated patch (this is only complete once the diff is finished)
+     *  @return Patch
+     */
+    const Patch<text_t> &patch() const { return _patch; }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,222 @@
+/**
+ *  Scratch.h
+ *
+ *  Working memory that is shared by all the recursive steps of a single
+ *  diff computation. The top-level patch creates one scratch object, and
+ *  passes it on to all sub-patches that it creates, so that the big arrays
+ *  that are needed by the algorithms are only allocated once and can be
+ *  reused by all levels of the recursion. The scratch object also holds
+ *  the arena from which its own arrays, and all other temporary memory
+ *  (like the diffs of the sub-patches) are allocated.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <vector>
+#include <sys/types.h>
+#include "arena.h"
+#include "dictionary.h"
+#include "lines.h"
+#include "pool.h"
+#include "stats.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Scratch
+{
+private:
+    /**
+     *  Arena for temporary memory
+     *  @var Arena
+     */
+    Arena &_arena;
+
+    /**
+     *  Thread pool for sub-problems that can run in parallel (or nullptr)
+     *  @var Pool
+     */
+    Pool *_pool;
+
+    /**
+     *  Object to record how the patch is calculated (or nullptr)
+     *  @var Stats
+     */
+    Stats *_stats;
+
+    /**
+     *  Current level of the recursion (only tracked when the stats are compiled in)
+     *  @var size_t
+     */
+    size_t _depth;
+
+    /**
+     *  The V-array for the forward search of the middle snake
+     *  @var std::vector
+     */
+    std::vector<ssize_t, Allocator<ssize_t>> _forward;
+
+    /**
+     *  The V-array for the reverse search of the middle snake
+     *  @var std::vector
+     */
+    std::vector<ssize_t, Allocator<ssize_t>> _reverse;
+
+    /**
+     *  Dictionary to convert lines into tokens (for linemode)
+     *  @var Dictionary
+     */
+    Dictionary _dictionary;
+
+    /**
+     *  The lines of the two texts (for linemode)
+     *  @var Lines
+     */
+    Lines _lines1;
+    Lines _lines2;
+
+    /**
+     *  The decoded code points of the two texts (for text types that do not
+     *  have random access to their characters, like utf8)
+     *  @var std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> _codepoints1;
+    std::vector<uint32_t, Allocator<uint32_t>> _codepoints2;
+
+    /**
+     *  The rows of bit-vectors of the bit-parallel algorithm (for short texts)
+     *  @var std::vector
+     */
+    std::vector<uint64_t, Allocator<uint64_t>> _bitvectors;
+
+    /**
+     *  Helper method to get access to an array of at least a certain size
+     *  @param  vector      the vector to grow
+     *  @param  size        required number of elements
+     *  @return type*
+     */
+    template <typename type>
+    static type *grow(std::vector<type, Allocator<type>> &vector, size_t size)
+    {
+        // the vector only grows, so that it can be reused for smaller inputs
+        if (vector.size() < size) vector.resize(size);
+
+        // expose the data
+        return vector.data();
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  arena       arena to allocate from
+     *  @param  pool        optional thread pool
+     *  @param  stats       optional object to record how the patch is calculated
+     *  @param  depth       level of the recursion where the patch starts
+     */
+    Scratch(Arena &arena, Pool *pool = nullptr, Stats *stats = nullptr, size_t depth = 0) :
+        _arena(arena),
+        _pool(pool),
+        _stats(stats),
+        _depth(depth),
+        _forward(Allocator<ssize_t>(&arena)),
+        _reverse(Allocator<ssize_t>(&arena)),
+        _dictionary(&arena),
+        _lines1(&arena),
+        _lines2(&arena),
+        _codepoints1(Allocator<uint32_t>(&arena)),
+        _codepoints2(Allocator<uint32_t>(&arena)),
+        _bitvectors(Allocator<uint64_t>(&arena)) {}
+
+    /**
+     *  Scratch objects are not supposed to be copied
+     *  @param  that
+     */
+    Scratch(const Scratch &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Scratch() = default;
+
+    /**
+     *  Get access to the forward and reverse V-arrays. The returned pointers
+     *  remain valid until the next call to the same method.
+     *  @param  size        number of elements that are needed
+     *  @return ssize_t*
+     */
+    ssize_t *forward(size_t size) { return grow(_forward, size); }
+    ssize_t *reverse(size_t size) { return grow(_reverse, size); }
+
+    /**
+     *  Get access to the array for the rows of the bit-parallel algorithm. The
+     *  returned pointer remains valid until the next call to this method.
+     *  @param  size        number of words that are needed
+     *  @return uint64_t*
+     */
+    uint64_t *bitvectors(size_t size) { return grow(_bitvectors, size); }
+
+    /**
+     *  The arena for temporary memory
+     *  @return Arena
+     */
+    Arena &arena() { return _arena; }
+
+    /**
+     *  The thread pool to run sub-problems in parallel (nullptr if everything runs in the current thread)
+     *  @return Pool
+     */
+    Pool *pool() { return _pool; }
+
+    /**
+     *  The object to record how the patch is calculated (nullptr if nothing is recorded)
+     *  @return Stats
+     */
+    Stats *stats() { return _stats; }
+
+    /**
+     *  The current level of the recursion
+     *  @return size_t
+     */
+    size_t depth() const { return _depth; }
+
+    /**
+     *  Go one level deeper into the recursion, and back
+     */
+    void descend() { if (Stats::enabled && _stats) _stats->descend(++_depth); }
+    void ascend() { if (Stats::enabled && _stats) --_depth; }
+
+    /**
+     *  Get access to the dictionary and the lines that are used by linemode
+     *  @return Dictionary
+     */
+    Dictionary &dictionary() { return _dictionary; }
+    Lines &lines1() { return _lines1; }
+    Lines &lines2() { return _lines2; }
+
+    /**
+     *  Get access to the arrays for decoded code points
+     *  @return std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> &codepoints1() { return _codepoints1; }
+    std::vector<uint32_t, Allocator<uint32_t>> &codepoints2() { return _codepoints2; }
+};
+
+/**
+ *  End of namespace
+ */
+}
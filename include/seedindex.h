@@ -0,0 +1,243 @@
+/**
+ *  SeedIndex.h
+ *
+ *  Index of all substrings with a certain length in a text, based on a
+ *  rolling hash (Rabin-Karp). The half-match algorithm uses this to find
+ *  the positions where a seed taken from the long text appears in the
+ *  short text: the short text is hashed only once, after which each seed
+ *  can be looked up without scanning the text again.
+ *
+ *  Most seeds appear at most once, and for these a normal search is faster
+ *  than hashing the entire text. That is why the index is only built when
+ *  a seed turns out to appear more than once.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+#include "arena.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t>
+class SeedIndex
+{
+private:
+    /**
+     *  Multiplier of the polynomial hash (the hash is calculated modulo 2^64)
+     *  @var uint64_t
+     */
+    static const uint64_t base = 0x100000001b3ULL;
+
+    /**
+     *  The text that is indexed
+     *  @var text_t
+     */
+    const text_t &_text;
+
+    /**
+     *  Length of the substrings in characters
+     *  @var size_t
+     */
+    size_t _length;
+
+    /**
+     *  Has the index been built?
+     *  @var bool
+     */
+    mutable bool _built = false;
+
+    /**
+     *  First position in each bucket, plus one (zero for empty buckets)
+     *  @var std::vector
+     */
+    mutable std::vector<uint32_t, Allocator<uint32_t>> _buckets;
+
+    /**
+     *  Next position in the same bucket, plus one (zero at the end of the chain)
+     *  @var std::vector
+     */
+    mutable std::vector<uint32_t, Allocator<uint32_t>> _next;
+
+    /**
+     *  The hash of the substring at each position
+     *  @var std::vector
+     */
+    mutable std::vector<uint64_t, Allocator<uint64_t>> _hashes;
+
+    /**
+     *  Value of a character in the hash
+     *  @param  character
+     *  @return uint64_t
+     */
+    template <typename char_t>
+    static uint64_t value(char_t character) { return (uint64_t)character + 1; }
+
+    /**
+     *  Bucket for a hash
+     *  @param  hash
+     *  @return size_t
+     */
+    size_t bucket(uint64_t hash) const { return (hash ^ (hash >> 29)) & (_buckets.size() - 1); }
+
+    /**
+     *  Build the index
+     */
+    void build() const
+    {
+        // the index is built only once
+        _built = true;
+
+        // number of characters in the text
+        size_t characters = _text.characters();
+
+        // leap out if the text is too short for a single substring
+        if (_length == 0 || _length > characters) return;
+
+        // number of substrings
+        size_t count = characters - _length + 1;
+
+        // base to the power of length-1, to remove the oldest character from the hash
+        uint64_t power = 1;
+        for (size_t i = 1; i < _length; ++i) power *= base;
+
+        // iterators to the first and last character of the window
+        auto head = _text.begin();
+        auto tail = _text.begin();
+
+        // hash of the first window
+        uint64_t hash = 0;
+        for (size_t i = 0; i < _length; ++i, ++head) hash = hash * base + value(*head);
+
+        // store the hashes of the windows
+        _hashes.reserve(count);
+        _hashes.push_back(hash);
+
+        // roll the window over the text
+        for (size_t i = 1; i < count; ++i, ++head, ++tail)
+        {
+            // remove the oldest character, and add the new one
+            hash = (hash - value(*tail) * power) * base + value(*head);
+
+            // store the hash
+            _hashes.push_back(hash);
+        }
+
+        // the number of buckets is a power of two, at least twice the number of positions
+        size_t buckets = 16;
+        while (buckets < count * 2) buckets *= 2;
+        _buckets.assign(buckets, 0);
+        _next.assign(count, 0);
+
+        // fill the buckets, back to front, so that the chains are in ascending order
+        for (size_t i = count; i-- > 0;)
+        {
+            // prepend to the chain
+            size_t index = bucket(_hashes[i]);
+            _next[i] = _buckets[index];
+            _buckets[index] = i + 1;
+        }
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  text        the text to index
+     *  @param  length      length of the substrings (in characters, must be at least one)
+     *  @param  arena       arena to allocate from (nullptr for the heap)
+     */
+    SeedIndex(const text_t &text, size_t length, Arena *arena = nullptr) :
+        _text(text),
+        _length(length),
+        _buckets(Allocator<uint32_t>(arena)),
+        _next(Allocator<uint32_t>(arena)),
+        _hashes(Allocator<uint64_t>(arena)) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~SeedIndex() = default;
+
+    /**
+     *  Length of the substrings
+     *  @return size_t
+     */
+    size_t length() const { return _length; }
+
+    /**
+     *  Calculate the hash of a seed
+     *  @param  seed        the seed (must be length() characters long)
+     *  @return uint64_t
+     */
+    uint64_t hash(const text_t &seed) const
+    {
+        // calculate the hash
+        uint64_t result = 0;
+        for (auto character : seed) result = result * base + value(character);
+        return result;
+    }
+
+    /**
+     *  Find the next position where a seed appears in the text
+     *  @param  seed        the seed (must be length() characters long)
+     *  @param  hash        hash of the seed (only used after the first position)
+     *  @param  position    the previous position that was returned for this seed, or -1 to start at the beginning
+     *  @return ssize_t     position in the text, -1 if there are no more positions
+     */
+    ssize_t find(const text_t &seed, uint64_t hash, ssize_t position) const
+    {
+        // the first position is found with a normal search
+        if (position < 0) return _text.find(seed);
+
+        // if there is no index yet, we first check if there is a second position at all
+        if (!_built)
+        {
+            // search the text
+            ssize_t result = _text.find(seed, position + 1);
+
+            // build the index if there was a second position (there might be more)
+            if (result >= 0) build();
+
+            // done
+            return result;
+        }
+
+        // nothing to find in an empty index
+        if (_buckets.empty()) return -1;
+
+        // walk over the chain of the bucket (starting after the previous position)
+        for (uint32_t next = _next[position]; next != 0; next = _next[next - 1])
+        {
+            // the position
+            ssize_t candidate = next - 1;
+
+            // the hash must match, and the text too (to rule out collisions)
+            if (_hashes[candidate] == hash && _text.substr(candidate, _length) == seed) return candidate;
+        }
+
+        // not found
+        return -1;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,53 @@
+/**
+ *  Sink.h
+ *
+ *  Interface for the receiver of the diffs of a streaming diff. The diffs
+ *  are passed on as soon as they are found, together with their data,
+ *  because the data only stays in memory while the diff is being processed.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stddef.h>
+#include "operation.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Sink
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Sink() = default;
+
+    /**
+     *  Process a diff. Consecutive calls may have the same operation (when a
+     *  change crosses the boundary of two windows). The data is only valid
+     *  during the call.
+     *  @param  operation   the operation
+     *  @param  data        the inserted, deleted or equal data
+     *  @param  size        number of bytes
+     */
+    virtual void write(Operation operation, const char *data, size_t size) = 0;
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,49 @@
+/**
+ *  Source.h
+ *
+ *  Interface for an input that is read incrementally, this is used by the
+ *  streaming diff for inputs that do not (have to) fit in memory.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stddef.h>
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Source
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Source() = default;
+
+    /**
+     *  Read data from the input
+     *  @param  buffer      where to store the data
+     *  @param  size        max number of bytes to read
+     *  @return size_t      number of bytes read, zero at the end of the input
+     */
+    virtual size_t read(char *buffer, size_t size) = 0;
+};
+
+/**
+ *  End of namespace
+ */
+}
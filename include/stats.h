@@ -0,0 +1,288 @@
+/**
+ *  Stats.h
+ *
+ *  Counters that explain how a patch was calculated: which shortcuts resolved
+ *  the (sub)patches, how deep the recursion went, how much work the middle
+ *  snake searches did and whether the deadline fired. A stats object is
+ *  filled in for all patches that are calculated with limits that point to
+ *  it, so it can be used to tune the limits per class of documents.
+ *
+ *  The bytes that buffers copy are counted per thread. The tasks that a patch
+ *  hands over to a thread pool pass their count on to the thread that waits
+ *  for them, so the count of a patch does not include the work of patches
+ *  that other threads calculate at the same time.
+ *
+ *  The counters are only compiled in if DIFF_STATS is defined. Without it,
+ *  all methods are empty and the calls to them are optimized away, and all
+ *  counters remain zero.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stddef.h>
+#include <atomic>
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Stats
+{
+public:
+    /**
+     *  The ways in which a (sub)patch can be resolved
+     */
+    enum class Shortcut : unsigned char {
+        EMPTY,
+        IDENTICAL,
+        OVERLAP,
+        SINGLECHAR,
+        HALFMATCH,
+        LINEMODE,
+        BISECT,
+        PATIENCE,
+        HISTOGRAM,
+        BITPARALLEL,
+        DISSIMILAR
+    };
+
+#ifdef DIFF_STATS
+    /**
+     *  Are the counters compiled in?
+     *  @var bool
+     */
+    static const bool enabled = true;
+
+private:
+    /**
+     *  Number of patches that were resolved by each shortcut
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _resolved[11];
+
+    /**
+     *  Deepest level of the recursion
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _depth;
+
+    /**
+     *  Number of middle snake searches, the number of edit steps (the D values)
+     *  that they walked, and the number of times that they checked the deadline
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _snakes;
+    std::atomic<size_t> _steps;
+    std::atomic<size_t> _checks;
+
+    /**
+     *  Number of top-level patches for which the deadline fired
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _expired;
+
+    /**
+     *  Number of bytes that were copied by buffers
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _copied;
+
+    /**
+     *  Number of normalizing passes over the diffs, and the number of edits that they shifted
+     *  @var std::atomic
+     */
+    std::atomic<size_t> _passes;
+    std::atomic<size_t> _shifts;
+
+    /**
+     *  Counter for the bytes that are copied by the buffers of the current thread
+     *  @return size_t
+     */
+    static size_t &copies() { static thread_local size_t copies = 0; return copies; }
+
+public:
+    /**
+     *  Constructor
+     */
+    Stats() { reset(); }
+
+    /**
+     *  Reset all counters
+     */
+    void reset()
+    {
+        // all shortcuts
+        for (auto &resolved : _resolved) resolved.store(0);
+
+        // the other counters
+        _depth.store(0); _snakes.store(0); _steps.store(0); _checks.store(0);
+        _expired.store(0); _copied.store(0); _passes.store(0); _shifts.store(0);
+    }
+
+    /**
+     *  Record that a (sub)patch was resolved by a shortcut
+     *  @param  shortcut
+     */
+    void resolve(Shortcut shortcut) { _resolved[(size_t)shortcut].fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     *  Record that the recursion reached a certain level
+     *  @param  depth
+     */
+    void descend(size_t depth)
+    {
+        // the deepest level so far
+        size_t deepest = _depth.load(std::memory_order_relaxed);
+
+        // store the new level if it is deeper (an other thread could do the same)
+        while (depth > deepest && !_depth.compare_exchange_weak(deepest, depth, std::memory_order_relaxed)) {}
+    }
+
+    /**
+     *  Record a middle snake search
+     *  @param  steps       number of edit steps that were walked
+     *  @param  checks      number of times that the deadline was checked
+     */
+    void search(size_t steps, size_t checks)
+    {
+        // update the counters
+        _snakes.fetch_add(1, std::memory_order_relaxed);
+        _steps.fetch_add(steps, std::memory_order_relaxed);
+        _checks.fetch_add(checks, std::memory_order_relaxed);
+    }
+
+    /**
+     *  Record that the deadline fired while a top-level patch was calculated
+     */
+    void expire() { _expired.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     *  Record the bytes that were copied by buffers
+     *  @param  bytes
+     */
+    void copy(size_t bytes) { _copied.fetch_add(bytes, std::memory_order_relaxed); }
+
+    /**
+     *  Record a normalizing pass over the diffs
+     *  @param  shifts      number of edits that were shifted
+     */
+    void normalize(size_t shifts)
+    {
+        // update the counters
+        _passes.fetch_add(1, std::memory_order_relaxed);
+        _shifts.fetch_add(shifts, std::memory_order_relaxed);
+    }
+
+    /**
+     *  Record that a buffer copied data, this is counted for the current thread
+     *  @param  bytes
+     */
+    static void copying(size_t bytes) { copies() += bytes; }
+
+    /**
+     *  Number of bytes that were copied by the buffers of the current thread
+     *  @return size_t
+     */
+    static size_t copying() { return copies(); }
+
+    /**
+     *  Take the bytes that the current thread copied since an earlier count off
+     *  its counter, so that they can be counted for an other thread instead
+     *  @param  since       the earlier count
+     *  @return size_t      the bytes copied since then
+     */
+    static size_t transfer(size_t since)
+    {
+        // the bytes copied in the meantime
+        size_t bytes = copies() - since;
+
+        // restore the counter
+        copies() = since;
+
+        // done
+        return bytes;
+    }
+
+    /**
+     *  The counters
+     *  @return size_t
+     */
+    size_t resolved(Shortcut shortcut) const { return _resolved[(size_t)shortcut].load(); }
+    size_t depth() const { return _depth.load(); }
+    size_t snakes() const { return _snakes.load(); }
+    size_t steps() const { return _steps.load(); }
+    size_t checks() const { return _checks.load(); }
+    size_t expired() const { return _expired.load(); }
+    size_t copied() const { return _copied.load(); }
+    size_t passes() const { return _passes.load(); }
+    size_t shifts() const { return _shifts.load(); }
+#else
+    /**
+     *  Are the counters compiled in?
+     *  @var bool
+     */
+    static const bool enabled = false;
+
+    /**
+     *  Constructor
+     */
+    Stats() = default;
+
+    /**
+     *  Without DIFF_STATS nothing is recorded
+     */
+    void reset() {}
+    void resolve(Shortcut) {}
+    void descend(size_t) {}
+    void search(size_t, size_t) {}
+    void expire() {}
+    void copy(size_t) {}
+    void normalize(size_t) {}
+    static void copying(size_t) {}
+    static size_t copying() { return 0; }
+    static size_t transfer(size_t) { return 0; }
+
+    /**
+     *  And all counters are zero
+     *  @return size_t
+     */
+    size_t resolved(Shortcut) const { return 0; }
+    size_t depth() const { return 0; }
+    size_t snakes() const { return 0; }
+    size_t steps() const { return 0; }
+    size_t checks() const { return 0; }
+    size_t expired() const { return 0; }
+    size_t copied() const { return 0; }
+    size_t passes() const { return 0; }
+    size_t shifts() const { return 0; }
+#endif
+
+    /**
+     *  Stats can not be copied, because they are shared by all threads of a patch
+     *  @param  that
+     */
+    Stats(const Stats &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Stats() = default;
+};
+
+/**
+ *  End of namespace
+ */
+}
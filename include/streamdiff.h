@@ -0,0 +1,392 @@
+/**
+ *  StreamDiff.h
+ *
+ *  Class to calculate the diff of two inputs that are read incrementally,
+ *  for inputs that are too big to be kept in memory. Both inputs are read
+ *  into a window of limited size. The windows are then split at an anchor:
+ *  a line that appears exactly once in each window. The anchor that is used
+ *  is the last one of the longest series of anchors that appear in the same
+ *  order in both windows (like the patience diff algorithm). The data up to
+ *  and including the anchor is passed to the normal diff algorithm, and the
+ *  diffs are passed on to a sink. The rest of the windows is kept, and the
+ *  windows are filled up again.
+ *
+ *  If no anchor can be found (because the windows have nothing in common),
+ *  the complete lines in the windows are compared as they are. The result
+ *  is always a correct diff, but it may be less optimal around the boundaries
+ *  of the windows than a diff over the entire inputs.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "arena.h"
+#include "ascii.h"
+#include "buffer.h"
+#include "dictionary.h"
+#include "limits.h"
+#include "lines.h"
+#include "patch.h"
+#include "sink.h"
+#include "source.h"
+#include "utf8index.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+template <typename text_t = Ascii>
+class StreamDiff
+{
+private:
+    /**
+     *  The buffered data of one of the inputs
+     */
+    class Window
+    {
+    private:
+        /**
+         *  The input
+         *  @var Source
+         */
+        Source &_source;
+
+        /**
+         *  The buffer (its size is the size of the window)
+         *  @var std::vector
+         */
+        std::vector<char> _buffer;
+
+        /**
+         *  Number of bytes in the buffer
+         *  @var size_t
+         */
+        size_t _size = 0;
+
+        /**
+         *  Has the end of the input been reached?
+         *  @var bool
+         */
+        bool _eof = false;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  source      the input
+         *  @param  size        size of the window
+         */
+        Window(Source &source, size_t size) : _source(source), _buffer(size) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Window() = default;
+
+        /**
+         *  Read from the input until the window is full (or the input is exhausted)
+         */
+        void fill()
+        {
+            // keep reading
+            while (!_eof && _size < _buffer.size())
+            {
+                // read from the input
+                size_t bytes = _source.read(_buffer.data() + _size, _buffer.size() - _size);
+
+                // update the administration
+                if (bytes == 0) _eof = true; else _size += bytes;
+            }
+        }
+
+        /**
+         *  Remove data from the start of the window
+         *  @param  bytes       number of bytes to remove
+         */
+        void consume(size_t bytes)
+        {
+            // move the remaining data to the front
+            memmove(_buffer.data(), _buffer.data() + bytes, _size - bytes);
+            _size -= bytes;
+        }
+
+        /**
+         *  The data in the window
+         *  @return const char *
+         */
+        const char *data() const { return _buffer.data(); }
+
+        /**
+         *  Number of bytes in the window
+         *  @return size_t
+         */
+        size_t size() const { return _size; }
+
+        /**
+         *  Has the end of the input been reached?
+         *  @return bool
+         */
+        bool eof() const { return _eof; }
+
+        /**
+         *  Number of bytes in the window that hold complete lines (at the end
+         *  of the input, the last line is complete even without a newline)
+         *  @return size_t
+         */
+        size_t complete() const
+        {
+            // at the end of the input, everything is complete
+            if (_eof) return _size;
+
+            // find the last newline
+            const char *newline = (const char *)memrchr(_buffer.data(), '\n', _size);
+
+            // the complete lines end after the newline
+            return newline ? newline - _buffer.data() + 1 : 0;
+        }
+
+        /**
+         *  Where the window can be cut if there is no anchor: after the complete
+         *  lines, or, if there are none, at the end of the window (but not in the
+         *  middle of a utf8 sequence)
+         *  @return size_t
+         */
+        size_t cut() const
+        {
+            // an empty window can not be cut (this happens when the input is exhausted)
+            if (_size == 0) return _size;
+
+            // cut after the complete lines
+            size_t result = complete();
+            if (result > 0) return result;
+
+            // find the start of the last utf8 sequence in the window
+            size_t lead = _size - 1;
+            while (lead > 0 && _size - lead < 4 && ((unsigned char)_buffer[lead] & 0xc0) == 0x80) --lead;
+
+            // the window is cut before this sequence if it is incomplete
+            return lead > 0 && lead + Utf8Index::width(_buffer[lead]) > _size ? lead : _size;
+        }
+    };
+
+    /**
+     *  Object with limits / settings for the algorithm
+     *  @var Limits
+     */
+    const Limits &_limits;
+
+    /**
+     *  The windows of the two inputs
+     *  @var Window
+     */
+    Window _window1;
+    Window _window2;
+
+    /**
+     *  The receiver of the diffs
+     *  @var Sink
+     */
+    Sink &_sink;
+
+    /**
+     *  Tuning flag for the diff algorithm
+     *  @var bool
+     */
+    bool _checklines;
+
+    /**
+     *  Working memory of the diff algorithm
+     *  @var Arena
+     */
+    Arena _arena;
+
+    /**
+     *  Dictionary and lines to find the anchors
+     *  @var Dictionary
+     *  @var Lines
+     */
+    Dictionary _dictionary;
+    Lines _lines1;
+    Lines _lines2;
+
+    /**
+     *  Number of times each line appears in the windows, and the position
+     *  of the line in the second window
+     *  @var std::vector
+     */
+    std::vector<uint32_t> _counts1;
+    std::vector<uint32_t> _counts2;
+    std::vector<size_t> _positions;
+
+    /**
+     *  Positions of the anchors in both windows, and the patience piles
+     *  @var std::vector
+     */
+    std::vector<std::pair<size_t, size_t>> _anchors;
+    std::vector<size_t> _piles;
+
+    /**
+     *  Find the last anchor in the windows
+     *  @param  end1        end of the anchor line in the first window (output)
+     *  @param  end2        end of the anchor line in the second window (output)
+     *  @return bool        was an anchor found?
+     */
+    bool anchor(size_t &end1, size_t &end2)
+    {
+        // split the complete lines of the windows
+        _dictionary.clear();
+        _lines1.assign(Buffer(_window1.data(), _window1.complete(), false), _dictionary);
+        _lines2.assign(Buffer(_window2.data(), _window2.complete(), false), _dictionary);
+
+        // count how often each line appears
+        _counts1.assign(_dictionary.size(), 0);
+        _counts2.assign(_dictionary.size(), 0);
+        _positions.resize(_dictionary.size());
+        Tokens tokens1 = _lines1.tokens(), tokens2 = _lines2.tokens();
+        for (auto token : tokens1) _counts1[token] += 1;
+        for (size_t i = 0; i < tokens2.characters(); ++i) _counts2[tokens2[i]] += 1, _positions[tokens2[i]] = i;
+
+        // the lines that appear once in each window, in the order of the first window
+        _anchors.clear();
+        for (size_t i = 0; i < tokens1.characters(); ++i)
+        {
+            // skip lines that are not unique
+            if (_counts1[tokens1[i]] != 1 || _counts2[tokens1[i]] != 1) continue;
+
+            // this is a candidate
+            _anchors.emplace_back(i, _positions[tokens1[i]]);
+        }
+
+        // find the longest series that is also in order in the second window, the
+        // top of each pile is the anchor with the smallest position in the second
+        // window that ends a series of that length
+        _piles.clear();
+        for (size_t i = 0; i < _anchors.size(); ++i)
+        {
+            // find the pile on which the anchor is placed
+            auto pile = std::lower_bound(_piles.begin(), _piles.end(), _anchors[i].second, [this](size_t anchor, size_t position) {
+                return _anchors[anchor].second < position;
+            });
+
+            // place the anchor on the pile
+            if (pile == _piles.end()) _piles.push_back(i); else *pile = i;
+        }
+
+        // no anchor at all?
+        if (_piles.empty()) return false;
+
+        // the anchor that ends the longest series
+        const auto &last = _anchors[_piles.back()];
+
+        // the windows are cut after the anchor lines
+        end1 = _lines1.offset(last.first + 1);
+        end2 = _lines2.offset(last.second + 1);
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Calculate the diff of the start of the windows, and pass it to the sink
+     *  @param  end1        number of bytes of the first window
+     *  @param  end2        number of bytes of the second window
+     */
+    void diff(size_t end1, size_t end2)
+    {
+        // the memory used by the previous diff is no longer needed
+        _arena.reset();
+
+        // the texts to compare
+        text_t text1(_window1.data(), end1);
+        text_t text2(_window2.data(), end2);
+
+        // calculate the patch
+        Patch<text_t> patch(_limits, text1, text2, _arena, _checklines);
+
+        // pass the diffs to the sink
+        for (const auto &diff : patch) _sink.write(diff.operation(), patch.buffer(diff).data(), diff.bytes());
+
+        // the data is no longer needed
+        _window1.consume(end1);
+        _window2.consume(end2);
+    }
+
+public:
+    /**
+     *  Calculate the diff of two streams
+     *
+     *  The timeout of the limits is applied to each window separately.
+     *
+     *  @param  limits      object with limits / settings for the algorithm
+     *  @param  input1      the base input
+     *  @param  input2      the input to compare
+     *  @param  sink        receiver of the diffs
+     *  @param  window      max number of bytes of each input that is held in memory
+     *  @param  checklines  tuning flag
+     */
+    StreamDiff(const Limits &limits, Source &input1, Source &input2, Sink &sink, size_t window = 4 * 1024 * 1024, bool checklines = true) :
+        _limits(limits),
+        _window1(input1, window),
+        _window2(input2, window),
+        _sink(sink),
+        _checklines(checklines)
+    {
+        // process the windows
+        while (true)
+        {
+            // read as much data as fits in the windows
+            _window1.fill();
+            _window2.fill();
+
+            // leap out if all data has been processed
+            if (_window1.size() == 0 && _window2.size() == 0) return;
+
+            // at the end of both inputs, everything that is left is compared
+            if (_window1.eof() && _window2.eof()) diff(_window1.size(), _window2.size());
+
+            // otherwise we need an anchor to split the windows
+            else
+            {
+                // find the anchor
+                size_t end1, end2;
+
+                // if there is no anchor, we cut the windows after the complete lines
+                if (!anchor(end1, end2)) end1 = _window1.cut(), end2 = _window2.cut();
+
+                // compare the windows up to the anchor
+                diff(end1, end2);
+            }
+        }
+    }
+
+    /**
+     *  Stream diffs can not be copied
+     *  @param  that
+     */
+    StreamDiff(const StreamDiff &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~StreamDiff() = default;
+};
+
+/**
+ *  End of namespace
+ */
+}
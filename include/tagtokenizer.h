@@ -0,0 +1,84 @@
+/**
+ *  TagTokenizer.h
+ *
+ *  Tokenizer for html and xml. Each tag (from '<' up to and including the
+ *  matching '>') is a single token, and the text in between is split into
+ *  words, whitespace and punctuation like the WordTokenizer does. Comments
+ *  are also single tokens, even if they contain a '>'.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string.h>
+#include "wordtokenizer.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class TagTokenizer : public WordTokenizer
+{
+private:
+    /**
+     *  Size of the tag at the start of the data (the tag runs until the end
+     *  of the data if it is not closed)
+     *  @param  data        the remaining data, starting with '<'
+     *  @param  size        number of remaining bytes
+     *  @return size_t
+     */
+    static size_t tag(const char *data, size_t size)
+    {
+        // comments end with "-->"
+        if (size >= 4 && memcmp(data, "<!--", 4) == 0)
+        {
+            // look for the end of the comment
+            for (size_t i = 4; i + 3 <= size; ++i) if (memcmp(data + i, "-->", 3) == 0) return i + 3;
+
+            // the comment is not closed
+            return size;
+        }
+
+        // other tags end with the first '>'
+        const char *end = (const char *)memchr(data, '>', size);
+        return end ? end - data + 1 : size;
+    }
+
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~TagTokenizer() = default;
+
+    /**
+     *  Size of the token at the start of the data
+     *  @param  data        the remaining data
+     *  @param  size        number of remaining bytes
+     *  @return size_t
+     */
+    virtual size_t next(const char *data, size_t size) const
+    {
+        // tags are single tokens
+        if (data[0] == '<') return tag(data, size);
+
+        // the text is split in words (a word never includes a '<')
+        return WordTokenizer::next(data, size);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
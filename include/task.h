@@ -0,0 +1,149 @@
+/**
+ *  Task.h
+ *
+ *  Base class for a unit of work that can be handed over to a thread pool.
+ *  The object is not owned by the pool: the code that pushed the task is
+ *  responsible for keeping it alive until it has finished (which normally
+ *  means that the task lives on the stack of the thread that waits for it).
+ *  The bytes that buffers copy while the task runs are counted for the thread
+ *  that waits for it, no matter which thread ran it. A task remembers the
+ *  task that pushed it, so that a thread that waits for a task only helps
+ *  with the tasks that descend from it.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <atomic>
+#include <exception>
+#include "stats.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Task
+{
+private:
+    /**
+     *  Has the task finished?
+     *  @var std::atomic
+     */
+    std::atomic<bool> _finished;
+
+    /**
+     *  The exception that was thrown by the task
+     *  @var std::exception_ptr
+     */
+    std::exception_ptr _exception;
+
+    /**
+     *  Number of bytes that buffers copied while the task ran
+     *  @var size_t
+     */
+    size_t _copied = 0;
+
+    /**
+     *  The task that was running in the thread that pushed this task (nullptr if there was none)
+     *  @var Task*
+     */
+    const Task *_parent = nullptr;
+
+    /**
+     *  The pool sets the parent
+     */
+    friend class Pool;
+
+protected:
+    /**
+     *  Method that does the actual work
+     */
+    virtual void execute() = 0;
+
+public:
+    /**
+     *  Constructor
+     */
+    Task() : _finished(false) {}
+
+    /**
+     *  Tasks can not be copied
+     *  @param  that
+     */
+    Task(const Task &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Task() = default;
+
+    /**
+     *  Run the task, this is called by the thread that picked up the task
+     */
+    void run()
+    {
+        // the bytes that this thread copied so far
+        size_t copying = Stats::copying();
+
+        // run the task, exceptions are passed on to the thread that waits for the task
+        try { execute(); } catch (...) { _exception = std::current_exception(); }
+
+        // the copies of the task are passed on to the thread that waits for the task too
+        _copied = Stats::transfer(copying);
+
+        // the task is ready (this publishes all the results of the task)
+        _finished.store(true, std::memory_order_release);
+    }
+
+    /**
+     *  Has the task finished?
+     *  @return bool
+     */
+    bool finished() const { return _finished.load(std::memory_order_acquire); }
+
+    /**
+     *  Is this the other task, or was it pushed (directly or indirectly) by the other task?
+     *  @param  that        the other task
+     *  @return bool
+     */
+    bool descends(const Task *that) const
+    {
+        // walk up to the task that was pushed first (the parents are still waiting, so they are still alive)
+        for (const Task *task = this; task != nullptr; task = task->_parent) if (task == that) return true;
+
+        // not found
+        return false;
+    }
+
+    /**
+     *  Collect the result of a finished task, this is called by the thread that
+     *  waits for it: the copies of the task are counted for this thread, and
+     *  the exception that was thrown by the task (if any) is rethrown
+     */
+    void join()
+    {
+        // count the copies (only once, even if the task is joined again)
+        Stats::copying(_copied);
+        _copied = 0;
+
+        // pass on the exception
+        if (_exception) std::rethrow_exception(_exception);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,55 @@
+/**
+ *  Tokenizer.h
+ *
+ *  Interface for a class that splits a text into tokens, for diffs that are
+ *  calculated over words, tags or fields instead of over characters. The
+ *  tokens are interned into a dictionary, and the diff is calculated over
+ *  the token ids. The resulting diffs are byte ranges in the original texts.
+ *
+ *  Tokens must not split a multi-byte utf8 sequence if the diff is
+ *  calculated over utf8 text. This is easy to get right by splitting only
+ *  on ascii bytes.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stddef.h>
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Tokenizer
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Tokenizer() = default;
+
+    /**
+     *  Size of the token at the start of the data
+     *  @param  data        the remaining data
+     *  @param  size        number of remaining bytes (never zero)
+     *  @return size_t      size of the token (at least one, at most size)
+     */
+    virtual size_t next(const char *data, size_t size) const = 0;
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,225 @@
+/**
+ *  Tokens.h
+ *
+ *  Wrapper around a buffer of 32-bit tokens. This is used as a text type
+ *  for algorithms that do not compare characters, but bigger units (like
+ *  lines) that were first converted into unique numbers. Just like the
+ *  Ascii class, the buffer is not managed by this object.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <iterator>
+#include "buffer.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Tokens
+{
+private:
+    /**
+     *  The buffer of bytes
+     *  @var Buffer
+     */
+    Buffer _buffer;
+
+    /**
+     *  The tokens stored in the buffer
+     *  @return const uint32_t*
+     */
+    const uint32_t *tokens() const { return (const uint32_t *)_buffer.data(); }
+
+public:
+    /**
+     *  Default constructor
+     */
+    Tokens() = default;
+
+    /**
+     *  Constructor to wrap around a user-supplied array of tokens
+     *  @param  tokens
+     *  @param  count
+     */
+    Tokens(const uint32_t *tokens, size_t count) : _buffer((const char *)tokens, count * sizeof(uint32_t), false) {}
+
+    /**
+     *  Constructor to wrap around a user-supplied buffer of bytes
+     *  @param  buffer
+     *  @param  size
+     */
+    Tokens(const char *buffer, size_t size) : _buffer(buffer, size, false) {}
+
+    /**
+     *  Copy constructor
+     *  @param  that
+     */
+    Tokens(const Tokens &that) : _buffer(that._buffer) {}
+
+    /**
+     *  Move constructor
+     *  @param  that
+     */
+    Tokens(Tokens &&that) : _buffer(std::move(that._buffer)) {}
+
+    /**
+     *  Wrap around a buffer
+     *  @param  buffer
+     *  @param  deepcopy
+     */
+    Tokens(const Buffer &buffer, bool deepcopy) : _buffer(buffer, deepcopy) {}
+
+    /**
+     *  Move a buffer inside the tokens object
+     *  @param  buffer
+     */
+    explicit Tokens(Buffer &&buffer) : _buffer(std::move(buffer)) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Tokens() = default;
+
+    /**
+     *  The underlying raw data
+     *  @return const Buffer
+     */
+    const Buffer &buffer() const { return _buffer; }
+
+    /**
+     *  Get the underlying partial raw data buffer
+     *  @param  start       start position in tokens
+     *  @param  size        size in tokens
+     *  @return Buffer
+     */
+    Buffer buffer(size_t start) const { return _buffer.part(start * sizeof(uint32_t)); }
+    Buffer buffer(size_t start, size_t size) const { return _buffer.part(start * sizeof(uint32_t), size * sizeof(uint32_t)); }
+
+    /**
+     *  Size of the raw data buffer in bytes
+     *  @return size_t
+     */
+    size_t bytes() const { return _buffer.bytes(); }
+
+    /**
+     *  Number of tokens in the buffer (the tokens are the 'characters' of this text type)
+     *  @return size_t
+     */
+    size_t characters() const { return _buffer.bytes() / sizeof(uint32_t); }
+
+    /**
+     *  Get access to a single token
+     *  Is is up to the caller to ensure that a valid index is supplied (inside the right range)
+     *  @param  index       position of the token
+     *  @return uint32_t
+     */
+    uint32_t operator[](size_t index) const { return tokens()[index]; }
+
+    /**
+     *  Find a sequence of tokens
+     *  @param  that        tokens to look for
+     *  @return ssize_t     start position, -1 on no-match
+     */
+    ssize_t find(const Tokens &that) const { return find(that, 0); }
+
+    /**
+     *  Find a sequence of tokens
+     *  @param  that        tokens to look for
+     *  @param  index       start position
+     *  @return ssize_t     start position, -1 on no-match
+     */
+    ssize_t find(const Tokens &that, size_t index) const
+    {
+        // byte position from where we start searching
+        size_t pos = index * sizeof(uint32_t);
+
+        // search as long as there is data
+        while (pos <= _buffer.bytes())
+        {
+            // do a memory-search
+            ssize_t result = _buffer.find(that._buffer, pos);
+
+            // leap out if there was no match
+            if (result < 0) return -1;
+
+            // the match is only valid if it is aligned on a token boundary
+            if (result % sizeof(uint32_t) == 0) return result / sizeof(uint32_t);
+
+            // search again from the next byte
+            pos = result + 1;
+        }
+
+        // not found
+        return -1;
+    }
+
+    /**
+     *  Comparison operation
+     *  @param  that
+     *  @return int
+     */
+    int compare(const Tokens &that) const
+    {
+        // compare the buffer
+        return _buffer.compare(that._buffer);
+    }
+
+    /**
+     *  Comparison operators
+     *  @param  that
+     *  @return bool
+     */
+    bool operator==(const Tokens &that) const { return compare(that) == 0; }
+    bool operator!=(const Tokens &that) const { return compare(that) != 0; }
+
+    /**
+     *  Get a subset of the tokens
+     *  Is is up to the caller to ensure that valid parameters are supplied (inside the right range)
+     *  @param  start       start position (in tokens)
+     *  @param  size        number of tokens
+     *  @return Tokens
+     */
+    Tokens substr(size_t start, size_t size) const { return Tokens(buffer(start, size)); }
+
+    /**
+     *  Get a subset of the tokens
+     *  Is is up to the caller to ensure that a valid parameter is supplied (inside the right range)
+     *  @param  start       start position (in tokens)
+     *  @return Tokens
+     */
+    Tokens substr(size_t start) const { return Tokens(buffer(start)); }
+
+    /**
+     *  Iterator over the tokens
+     *  @return const uint32_t*
+     */
+    const uint32_t *begin() const { return tokens(); }
+    const uint32_t *end() const { return tokens() + characters(); }
+
+    /**
+     *  Reverse iterator
+     *  @return std::reverse_iterator
+     */
+    std::reverse_iterator<const uint32_t *> rbegin() const { return std::reverse_iterator<const uint32_t *>(end()); }
+    std::reverse_iterator<const uint32_t *> rend() const { return std::reverse_iterator<const uint32_t *>(begin()); }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,138 @@
+/**
+ *  TokenTable.h
+ *
+ *  Hash table that assigns a dense index to each distinct token of a range
+ *  of tokens. The anchor based algorithms (patience and histogram) use this
+ *  to count the occurrences of the tokens of the range that they work on:
+ *  the tokens themselves are the numbers from the dictionary, which can be
+ *  much bigger than the range, so they can not be used as index directly.
+ *  The callers store their own data in arrays that are indexed by entry.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+#include "arena.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class TokenTable
+{
+private:
+    /**
+     *  The slots of the hash table, holding the entry + 1 (zero for empty slots)
+     *  @var std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> _slots;
+
+    /**
+     *  The token of each entry
+     *  @var std::vector
+     */
+    std::vector<uint32_t, Allocator<uint32_t>> _tokens;
+
+    /**
+     *  Find the slot for a token
+     *  @param  token
+     *  @return size_t      index of the slot, which is either empty or holds the token
+     */
+    size_t slot(uint32_t token) const
+    {
+        // the capacity is a power of two
+        size_t mask = _slots.size() - 1;
+
+        // the tokens are mostly consecutive numbers, so they are scattered over the slots (Fibonacci hashing)
+        size_t index = (size_t)((token * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+
+        // walk over the slots until the token or an empty slot is found
+        while (_slots[index] != 0 && _tokens[_slots[index] - 1] != token) index = (index + 1) & mask;
+
+        // done
+        return index;
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  capacity    max number of distinct tokens that is going to be stored
+     *  @param  arena       arena to allocate from (nullptr for the heap)
+     */
+    TokenTable(size_t capacity, Arena *arena = nullptr) :
+        _slots(Allocator<uint32_t>(arena)),
+        _tokens(Allocator<uint32_t>(arena))
+    {
+        // the load factor stays under 50%
+        size_t size = 16;
+        while (size < capacity * 2) size *= 2;
+
+        // allocate the slots
+        _slots.assign(size, 0);
+        _tokens.reserve(capacity);
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~TokenTable() = default;
+
+    /**
+     *  Number of distinct tokens
+     *  @return size_t
+     */
+    size_t size() const { return _tokens.size(); }
+
+    /**
+     *  Get the entry of a token, a new entry is assigned if the token was not seen
+     *  before (the number of distinct tokens may not exceed the capacity)
+     *  @param  token
+     *  @return size_t
+     */
+    size_t insert(uint32_t token)
+    {
+        // find the slot
+        size_t index = slot(token);
+
+        // is the token already known?
+        if (_slots[index] != 0) return _slots[index] - 1;
+
+        // store the new entry
+        _tokens.push_back(token);
+        _slots[index] = _tokens.size();
+
+        // done
+        return _tokens.size() - 1;
+    }
+
+    /**
+     *  Find the entry of a token
+     *  @param  token
+     *  @return ssize_t     the entry, or -1 if the token was not seen before
+     */
+    ssize_t find(uint32_t token) const
+    {
+        // find the slot, it holds the entry + 1
+        return (ssize_t)_slots[slot(token)] - 1;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
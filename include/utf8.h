@@ -0,0 +1,474 @@
+/**
+ *  Utf8.h
+ *
+ *  Wrapper around a utf8 buffer. Just like the Ascii class, the buffer is
+ *  not managed and it is up to the caller to keep it in scope. The buffer
+ *  is validated when the object is constructed (with an ascii fast path,
+ *  see Utf8Index), and a sparse index with the byte offsets of the code
+ *  points is built at the same time. This index is shared by all
+ *  substrings, so that substr(), buffer() and find() do not have to scan
+ *  the text from the start. Parts of a text should therefore be taken with
+ *  substr(): constructing a new Utf8 over the same bytes validates and
+ *  indexes them again.
+ *
+ *  The characters of this text type are the unicode code points.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include "buffer.h"
+#include "utf8index.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Utf8
+{
+private:
+    /**
+     *  The buffer of bytes
+     *  @var Buffer
+     */
+    Buffer _buffer;
+
+    /**
+     *  The index of the text from which this text was taken (shared by all substrings)
+     *  @var std::shared_ptr
+     */
+    std::shared_ptr<const Utf8Index> _index;
+
+    /**
+     *  The code point in the indexed text where this text starts
+     *  @var size_t
+     */
+    size_t _first = 0;
+
+    /**
+     *  The byte offset in the indexed text where this text starts
+     *  @var size_t
+     */
+    size_t _offset = 0;
+
+    /**
+     *  Number of code points in this text
+     *  @var size_t
+     */
+    size_t _characters = 0;
+
+    /**
+     *  Decode the code point that starts at a certain position
+     *  @param  data        lead byte of a valid sequence
+     *  @return uint32_t
+     */
+    static uint32_t decode(const char *data)
+    {
+        // the bytes of the sequence
+        const unsigned char *bytes = (const unsigned char *)data;
+
+        // the lead byte tells the size of the sequence
+        if (bytes[0] < 0x80) return bytes[0];
+        if (bytes[0] < 0xe0) return (bytes[0] & 0x1f) << 6 | (bytes[1] & 0x3f);
+        if (bytes[0] < 0xf0) return (bytes[0] & 0x0f) << 12 | (bytes[1] & 0x3f) << 6 | (bytes[2] & 0x3f);
+        return (bytes[0] & 0x07) << 18 | (bytes[1] & 0x3f) << 12 | (bytes[2] & 0x3f) << 6 | (bytes[3] & 0x3f);
+    }
+
+    /**
+     *  Is this a continuation byte (a byte that is not the start of a sequence)?
+     *  @param  byte
+     *  @return bool
+     */
+    static bool continuation(char byte) { return ((unsigned char)byte & 0xc0) == 0x80; }
+
+    /**
+     *  Iterator to go over the code points
+     */
+    class iterator
+    {
+    private:
+        /**
+         *  The current position in the buffer
+         *  @var const char *
+         */
+        const char *_buffer;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  buffer
+         */
+        iterator(const char *buffer) : _buffer(buffer) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~iterator() = default;
+
+        /**
+         *  Compare with a different iterator
+         *  @param  that
+         */
+        bool operator==(const iterator &that) const { return _buffer == that._buffer; }
+        bool operator!=(const iterator &that) const { return _buffer != that._buffer; }
+
+        /**
+         *  Dereference, get the code point
+         *  @return uint32_t
+         */
+        uint32_t operator*() const { return decode(_buffer); }
+
+        /**
+         *  Move the iterator (implements ++iter)
+         *  @return iterator
+         */
+        const iterator &operator++()
+        {
+            // the lead byte tells the size of the sequence
+            _buffer += Utf8Index::width(*_buffer);
+
+            // allow chaining
+            return *this;
+        }
+
+        /**
+         *  Move the iterator (implements iter++)
+         *  @return iterator
+         */
+        iterator operator++(int)
+        {
+            // move the iterator, but return the prev
+            iterator result(*this); ++*this; return result;
+        }
+    };
+
+    /**
+     *  Iterator to go over the code points in reverse order
+     */
+    class reverse_iterator
+    {
+    private:
+        /**
+         *  The buffer that is being iterated, this points to the position right after the current code point
+         *  @var const char *
+         */
+        const char *_buffer;
+
+        /**
+         *  The start of the current code point
+         *  @return const char *
+         */
+        const char *start() const
+        {
+            // skip back over the continuation bytes
+            const char *result = _buffer - 1;
+            while (continuation(*result)) --result;
+            return result;
+        }
+
+    public:
+        /**
+         *  Constructor
+         *  @param  buffer
+         */
+        reverse_iterator(const char *buffer) : _buffer(buffer) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~reverse_iterator() = default;
+
+        /**
+         *  Compare with a different iterator
+         *  @param  that
+         */
+        bool operator==(const reverse_iterator &that) const { return _buffer == that._buffer; }
+        bool operator!=(const reverse_iterator &that) const { return _buffer != that._buffer; }
+
+        /**
+         *  Dereference, get the code point
+         *  @return uint32_t
+         */
+        uint32_t operator*() const { return decode(start()); }
+
+        /**
+         *  Move the iterator (implements ++iter)
+         *  @return reverse_iterator
+         */
+        const reverse_iterator &operator++()
+        {
+            // move the iterator
+            _buffer = start();
+
+            // allow chaining
+            return *this;
+        }
+
+        /**
+         *  Move the iterator (implements iter++)
+         *  @return reverse_iterator
+         */
+        reverse_iterator operator++(int)
+        {
+            // move the iterator, but return the prev
+            reverse_iterator result(*this); ++*this; return result;
+        }
+    };
+
+    /**
+     *  Private constructor for substrings, that share the index
+     *  @param  buffer      the bytes of the substring
+     *  @param  index       the shared index
+     *  @param  first       first code point of the substring in the indexed text
+     *  @param  offset      byte offset of the substring in the indexed text
+     *  @param  characters  number of code points
+     */
+    Utf8(Buffer &&buffer, const std::shared_ptr<const Utf8Index> &index, size_t first, size_t offset, size_t characters) :
+        _buffer(std::move(buffer)), _index(index), _first(first), _offset(offset), _characters(characters) {}
+
+    /**
+     *  Build the index, this validates the buffer
+     *  @throws std::invalid_argument
+     */
+    void initialize()
+    {
+        // construct the index
+        _index = std::make_shared<Utf8Index>(_buffer.data(), _buffer.bytes());
+
+        // the number of code points
+        _characters = _index->characters();
+    }
+
+public:
+    /**
+     *  Default constructor
+     */
+    Utf8() = default;
+
+    /**
+     *  Constructor to wrap around a user-supplied buffer
+     *  @param  buffer
+     *  @param  size
+     *  @throws std::invalid_argument
+     */
+    Utf8(const char *buffer, size_t size) : _buffer(buffer, size, false) { initialize(); }
+
+    /**
+     *  Constructor
+     *  @param  buffer
+     *  @throws std::invalid_argument
+     */
+    explicit Utf8(const char *buffer) : Utf8(buffer, strlen(buffer)) {}
+
+    /**
+     *  Copy constructor
+     *  @param  that
+     */
+    Utf8(const Utf8 &that) = default;
+
+    /**
+     *  Move constructor
+     *  @param  that
+     */
+    Utf8(Utf8 &&that) = default;
+
+    /**
+     *  Wrap around a buffer
+     *  @param  buffer
+     *  @param  deepcopy
+     *  @throws std::invalid_argument
+     */
+    Utf8(const Buffer &buffer, bool deepcopy) : _buffer(buffer, deepcopy) { initialize(); }
+
+    /**
+     *  Move a buffer inside the utf8 object
+     *  @param  buffer
+     *  @throws std::invalid_argument
+     */
+    explicit Utf8(Buffer &&buffer) : _buffer(std::move(buffer)) { initialize(); }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Utf8() = default;
+
+    /**
+     *  Byte offset of a code point in this text
+     *  @param  character   the code point (may be equal to the number of characters)
+     *  @return size_t
+     */
+    size_t offset(size_t character) const
+    {
+        // texts without an index are empty
+        if (!_index) return 0;
+
+        // use the index
+        return _index->offset(_first + character, _buffer.data(), _first, _offset) - _offset;
+    }
+
+    /**
+     *  The code point at a byte offset in this text
+     *  @param  offset      the byte offset (must be at the start of a code point)
+     *  @return size_t
+     */
+    size_t character(size_t offset) const
+    {
+        // texts without an index are empty
+        if (!_index) return 0;
+
+        // use the index
+        return _index->character(_offset + offset, _buffer.data(), _first, _offset) - _first;
+    }
+
+    /**
+     *  The underlying raw data
+     *  @return const Buffer
+     */
+    const Buffer &buffer() const { return _buffer; }
+
+    /**
+     *  Get the underlying partial raw data buffer
+     *  @param  start       start position in characters
+     *  @param  size        size in characters
+     *  @return Buffer
+     */
+    Buffer buffer(size_t start) const { return _buffer.part(offset(std::min(start, _characters))); }
+    Buffer buffer(size_t start, size_t size) const
+    {
+        // prevent out-of-range errors
+        start = std::min(start, _characters);
+        size = std::min(size, _characters - start);
+
+        // the byte range
+        size_t begin = offset(start);
+        return _buffer.part(begin, offset(start + size) - begin);
+    }
+
+    /**
+     *  Size of the raw data buffer in bytes
+     *  @return size_t
+     */
+    size_t bytes() const { return _buffer.bytes(); }
+
+    /**
+     *  Number of code points in the string
+     *  @return size_t
+     */
+    size_t characters() const { return _characters; }
+
+    /**
+     *  Get access to a single code point
+     *  Is is up to the caller to ensure that a valid index is supplied (inside the right range)
+     *  @param  index       position of the code point
+     *  @return uint32_t
+     */
+    uint32_t operator[](size_t index) const { return decode(_buffer.data() + offset(index)); }
+
+    /**
+     *  Find the substring
+     *  @param  that        text to compare
+     *  @return ssize_t     start position, -1 on no-match
+     */
+    ssize_t find(const Utf8 &that) const { return find(that, 0); }
+
+    /**
+     *  Find the substring
+     *  @param  that        text to compare
+     *  @param  index       start position
+     *  @return ssize_t     start position, -1 on no-match
+     */
+    ssize_t find(const Utf8 &that, size_t index) const
+    {
+        // prevent out-of-range errors
+        if (index > _characters) return -1;
+
+        // do a memory-search (a valid utf8 needle can only match at the start of a code point)
+        ssize_t result = _buffer.find(that._buffer, offset(index));
+
+        // convert the byte offset to a code point
+        return result < 0 ? -1 : character(result);
+    }
+
+    /**
+     *  Comparison operation (utf8 bytes sort in the same order as the code points)
+     *  @param  that
+     *  @return int
+     */
+    int compare(const Utf8 &that) const
+    {
+        // compare the buffer
+        return _buffer.compare(that._buffer);
+    }
+
+    /**
+     *  Comparison operators
+     *  @param  that
+     *  @return bool
+     */
+    bool operator==(const Utf8 &that) const { return compare(that) == 0; }
+    bool operator!=(const Utf8 &that) const { return compare(that) != 0; }
+
+    /**
+     *  Get a substring, this shares the index with the current text
+     *  Is is up to the caller to ensure that valid parameters are supplied (inside the right range)
+     *  @param  start       start position in code points
+     *  @param  size        number of code points
+     *  @return Utf8
+     */
+    Utf8 substr(size_t start, size_t size) const
+    {
+        // prevent out-of-range errors
+        start = std::min(start, _characters);
+        size = std::min(size, _characters - start);
+
+        // the byte range
+        size_t begin = offset(start);
+        size_t end = offset(start + size);
+
+        // construct the substring
+        return Utf8(_buffer.part(begin, end - begin), _index, _first + start, _offset + begin, size);
+    }
+
+    /**
+     *  Get a substring
+     *  Is is up to the caller to ensure that a valid parameter is supplied (inside the right range)
+     *  @param  start       start position in code points
+     *  @return Utf8
+     */
+    Utf8 substr(size_t start) const { return substr(start, _characters); }
+
+    /**
+     *  Iterator over the code points
+     *  @return iterator
+     */
+    iterator begin() const { return iterator(_buffer.data()); }
+    iterator end() const { return iterator(_buffer.data() + _buffer.bytes()); }
+
+    /**
+     *  Reverse iterator
+     *  @return iterator
+     */
+    reverse_iterator rbegin() const { return reverse_iterator(_buffer.data() + _buffer.bytes()); }
+    reverse_iterator rend() const { return reverse_iterator(_buffer.data()); }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,312 @@
+/**
+ *  Utf8Index.h
+ *
+ *  Sparse index over a utf8 buffer that stores the byte offset of every
+ *  64th code point. With this index, the byte offset of a character (and
+ *  the character at a byte offset) can be found without scanning the entire
+ *  buffer: at most 63 code points have to be skipped after a lookup.
+ *
+ *  The index is built in a single pass that also validates the buffer.
+ *  The validation has an ascii fast path: runs of ascii bytes are checked
+ *  16 (or 8) bytes at a time, but every multi-byte sequence is validated
+ *  one by one with scalar code. Texts with many non-ascii characters are
+ *  therefore not validated any faster than byte by byte.
+ *
+ *  The index does not hold a pointer to the buffer: the caller passes the
+ *  bytes to scan, so that the index can be shared by all substrings of a
+ *  text, even if these substrings hold a copy of the data.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+/**
+ *  Vector instructions that we can use
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Utf8Index
+{
+private:
+    /**
+     *  Distance between two code points in the index
+     *  @var size_t
+     */
+    static const size_t interval = 64;
+
+    /**
+     *  Byte offset of code point 0, 64, 128, etc
+     *  @var std::vector
+     */
+    std::vector<size_t> _offsets;
+
+    /**
+     *  Total number of code points
+     *  @var size_t
+     */
+    size_t _characters = 0;
+
+    /**
+     *  Total number of bytes
+     *  @var size_t
+     */
+    size_t _bytes = 0;
+
+    /**
+     *  Count the number of ascii bytes at the start of a buffer
+     *  @param  data        the buffer
+     *  @param  size        max number of bytes to check
+     *  @return size_t
+     */
+    static size_t ascii(const char *data, size_t size)
+    {
+        // number of ascii bytes
+        size_t result = 0;
+
+#if defined(__SSE2__)
+        // check 16 bytes at a time, the movemask holds the high bits
+        for (; result + 16 <= size; result += 16)
+        {
+            // get the high bits
+            unsigned mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(data + result)));
+
+            // leap out on the first non-ascii byte
+            if (mask != 0) return result + __builtin_ctz(mask);
+        }
+#elif defined(__GNUC__) && defined(__aarch64__)
+        // check 16 bytes at a time
+        for (; result + 16 <= size; result += 16)
+        {
+            // leap out if one of the bytes has the high bit set
+            if (vmaxvq_u8(vld1q_u8((const uint8_t *)data + result)) >= 0x80) break;
+        }
+#endif
+
+        // check 8 bytes at a time
+        for (; result + 8 <= size; result += 8)
+        {
+            // get the high bits
+            uint64_t word; memcpy(&word, data + result, sizeof(word));
+
+            // leap out if one of the bytes has the high bit set
+            if ((word & 0x8080808080808080ULL) != 0) break;
+        }
+
+        // check the remaining bytes one at a time
+        while (result < size && (unsigned char)data[result] < 0x80) ++result;
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Validate a multi-byte sequence
+     *  @param  data        start of the sequence
+     *  @param  size        number of available bytes
+     *  @return size_t      size of the sequence, 0 if is not valid
+     */
+    static size_t sequence(const unsigned char *data, size_t size)
+    {
+        // the lead byte determines the size and the valid range of the second byte
+        size_t length; unsigned char min = 0x80, max = 0xbf;
+        if (data[0] >= 0xc2 && data[0] <= 0xdf) length = 2;
+        else if (data[0] == 0xe0) length = 3, min = 0xa0;
+        else if (data[0] == 0xed) length = 3, max = 0x9f;
+        else if (data[0] >= 0xe1 && data[0] <= 0xef) length = 3;
+        else if (data[0] == 0xf0) length = 4, min = 0x90;
+        else if (data[0] == 0xf4) length = 4, max = 0x8f;
+        else if (data[0] >= 0xf1 && data[0] <= 0xf3) length = 4;
+        else return 0;
+
+        // the sequence must be complete
+        if (length > size) return 0;
+
+        // check the second byte (this rejects overlong forms, surrogates and too big code points)
+        if (data[1] < min || data[1] > max) return 0;
+
+        // the other bytes must be continuation bytes
+        for (size_t i = 2; i < length; ++i) if ((data[i] & 0xc0) != 0x80) return 0;
+
+        // the sequence is valid
+        return length;
+    }
+
+    /**
+     *  Skip a number of code points
+     *  @param  data        the buffer (valid utf8)
+     *  @param  count       number of code points to skip
+     *  @return size_t      number of bytes that were skipped
+     */
+    static size_t skip(const char *data, size_t count)
+    {
+        // number of bytes skipped
+        size_t result = 0;
+
+        // skip the code points, the lead byte tells the size of each sequence
+        for (; count > 0; --count) result += width(data[result]);
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Count the code points in a buffer
+     *  @param  data        the buffer (valid utf8)
+     *  @param  size        number of bytes
+     *  @return size_t
+     */
+    static size_t count(const char *data, size_t size)
+    {
+        // count the bytes that are not continuation bytes
+        size_t result = 0;
+        for (size_t i = 0; i < size; ++i) result += ((unsigned char)data[i] & 0xc0) != 0x80;
+        return result;
+    }
+
+public:
+    /**
+     *  Constructor, this validates the buffer and throws if it is not valid utf8
+     *  @param  data        the buffer
+     *  @param  size        number of bytes
+     *  @throws std::invalid_argument
+     */
+    Utf8Index(const char *data, size_t size) : _bytes(size)
+    {
+        // reserve room for the worst case (pure ascii)
+        _offsets.reserve(size / interval + 1);
+
+        // walk over the buffer
+        for (size_t pos = 0; pos < size;)
+        {
+            // number of code points until the next entry in the index
+            size_t remaining = interval - _characters % interval;
+
+            // store an entry if we are at an index position
+            if (remaining == interval) _offsets.push_back(pos);
+
+            // skip over the ascii bytes (but not further than the next index position)
+            size_t skipped = ascii(data + pos, std::min(remaining, size - pos));
+
+            // update the counters
+            pos += skipped;
+            _characters += skipped;
+
+            // if we arrived at an index position or at the end, we go on with the next block
+            if (skipped == remaining || pos == size) continue;
+
+            // this is a multi-byte sequence
+            size_t length = sequence((const unsigned char *)data + pos, size - pos);
+
+            // it must be valid
+            if (length == 0) throw std::invalid_argument("invalid utf8 sequence");
+
+            // move on
+            pos += length;
+            _characters += 1;
+        }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Utf8Index() = default;
+
+    /**
+     *  Size of a sequence, based on its lead byte
+     *  @param  lead        the lead byte (of a valid sequence)
+     *  @return size_t
+     */
+    static size_t width(char lead)
+    {
+        // check the high bits
+        unsigned char byte = lead;
+        return byte < 0x80 ? 1 : byte < 0xe0 ? 2 : byte < 0xf0 ? 3 : 4;
+    }
+
+    /**
+     *  Total number of code points and bytes
+     *  @return size_t
+     */
+    size_t characters() const { return _characters; }
+    size_t bytes() const { return _bytes; }
+
+    /**
+     *  Find the byte offset of a code point. The caller passes the position of
+     *  a known code point (for example the start of a substring) from which
+     *  the scan may start if that is closer, and a pointer to its data.
+     *  @param  character   the code point to look for
+     *  @param  data        data at the known position
+     *  @param  first       code point at the known position
+     *  @param  offset      byte offset of the known position
+     *  @return size_t      byte offset of the code point
+     */
+    size_t offset(size_t character, const char *data, size_t first, size_t offset) const
+    {
+        // for texts without multi-byte sequences this is simple
+        if (_characters == _bytes) return character;
+
+        // the closest entry in the index
+        size_t entry = std::min(character / interval, _offsets.size() - 1);
+
+        // start from this entry if it comes after the known position
+        if (entry * interval > first) data += _offsets[entry] - offset, first = entry * interval, offset = _offsets[entry];
+
+        // skip the other code points
+        return offset + skip(data, character - first);
+    }
+
+    /**
+     *  Find the code point at a byte offset. Just like in the offset() method,
+     *  the caller passes a known position
+     *  @param  target      byte offset of the code point to look for
+     *  @param  data        data at the known position
+     *  @param  first       code point at the known position
+     *  @param  offset      byte offset of the known position
+     *  @return size_t      the code point
+     */
+    size_t character(size_t target, const char *data, size_t first, size_t offset) const
+    {
+        // for texts without multi-byte sequences this is simple
+        if (_characters == _bytes) return target;
+
+        // the entry in the index at or right before the target
+        size_t entry = std::upper_bound(_offsets.begin(), _offsets.end(), target) - _offsets.begin() - 1;
+
+        // start from this entry if it comes after the known position
+        if (_offsets[entry] > offset) data += _offsets[entry] - offset, first = entry * interval, offset = _offsets[entry];
+
+        // count the code points in between
+        return first + count(data, target - offset);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,96 @@
+/**
+ *  Varint.h
+ *
+ *  Functions to write and read variable length integers. Each byte holds
+ *  seven bits of the value (the lowest bits first), the high bit of a byte
+ *  is set if more bytes follow. Small values thus take a single byte.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class Varint
+{
+public:
+    /**
+     *  Max number of bytes of an encoded 64-bit value
+     *  @var size_t
+     */
+    static const size_t maxsize = 10;
+
+    /**
+     *  Write a value
+     *  @param  buffer      where to write (must have room for maxsize bytes)
+     *  @param  value       the value to write
+     *  @return size_t      number of bytes written
+     */
+    static size_t write(char *buffer, uint64_t value)
+    {
+        // the bytes that are written
+        unsigned char *bytes = (unsigned char *)buffer;
+
+        // most values fit in a single byte
+        if (value < 0x80) { bytes[0] = value; return 1; }
+
+        // write seven bits at a time
+        size_t result = 0;
+        while (value >= 0x80) { bytes[result++] = (value & 0x7f) | 0x80; value >>= 7; }
+        bytes[result++] = value;
+        return result;
+    }
+
+    /**
+     *  Read a value
+     *  @param  data        where to read (this is moved to the next value)
+     *  @param  end         end of the buffer
+     *  @param  value       the value that was read (output)
+     *  @return bool        false if the value is incomplete or too big
+     */
+    static bool read(const char *&data, const char *end, uint64_t &value)
+    {
+        // the bytes that are read
+        const unsigned char *bytes = (const unsigned char *)data;
+        size_t available = end - data;
+
+        // most values fit in a single byte
+        if (available > 0 && bytes[0] < 0x80) { value = bytes[0]; data += 1; return true; }
+
+        // read seven bits at a time
+        value = 0;
+        for (size_t i = 0; i < available && i < maxsize; ++i)
+        {
+            // add the bits
+            value |= uint64_t(bytes[i] & 0x7f) << (7 * i);
+
+            // is this the last byte?
+            if (bytes[i] < 0x80) { data += i + 1; return true; }
+        }
+
+        // the value is incomplete
+        return false;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
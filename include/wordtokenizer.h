@@ -0,0 +1,96 @@
+/**
+ *  WordTokenizer.h
+ *
+ *  Tokenizer that splits a text into words, runs of whitespace and
+ *  punctuation. A word is a run of letters, digits, underscores and bytes
+ *  of multi-byte utf8 sequences (so that non-ascii words stay together),
+ *  every other character is a token on its own.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @copyright 2018 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "tokenizer.h"
+
+/**
+ *  Begin of namespace
+ */
+namespace DIFF {
+
+/**
+ *  Class definition
+ */
+class WordTokenizer : public Tokenizer
+{
+protected:
+    /**
+     *  Is a byte part of a word?
+     *  @param  byte
+     *  @return bool
+     */
+    static bool word(char byte)
+    {
+        // letters, digits, underscores and non-ascii bytes
+        unsigned char c = byte;
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+    }
+
+    /**
+     *  Is a byte whitespace?
+     *  @param  byte
+     *  @return bool
+     */
+    static bool space(char byte)
+    {
+        // spaces, tabs and newlines
+        return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r' || byte == '\f' || byte == '\v';
+    }
+
+    /**
+     *  Size of the run of bytes of the same class at the start of the data
+     *  @param  data        the remaining data
+     *  @param  size        number of remaining bytes
+     *  @param  member      function that tells if a byte belongs to the class
+     *  @return size_t
+     */
+    static size_t run(const char *data, size_t size, bool (*member)(char))
+    {
+        // count the bytes
+        size_t result = 1;
+        while (result < size && member(data[result])) ++result;
+        return result;
+    }
+
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~WordTokenizer() = default;
+
+    /**
+     *  Size of the token at the start of the data
+     *  @param  data        the remaining data
+     *  @param  size        number of remaining bytes
+     *  @return size_t
+     */
+    virtual size_t next(const char *data, size_t size) const
+    {
+        // words and whitespace are runs, all other characters stand on their own
+        if (word(data[0])) return run(data, size, word);
+        if (space(data[0])) return run(data, size, space);
+        return 1;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -1,7 +1,11 @@
 /**
  *  Test.cpp
  * 
- *  Test file for the library
+ *  Test file for the library. Every check prints a line when it fails, and
+ *  the program exits with a non-zero status if any of the checks failed.
+ *
+ *      g++ -std=c++11 -pthread test.cpp -o test
+ *      ./test
  *  
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2018 Copernica BV
@@ -10,15 +14,366 @@
 /**
  *  Dependencies
  */
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <atomic>
+#include <stdexcept>
+#include <system_error>
 #include <string>
+#include <thread>
+#include <vector>
+#include "include/apply.h"
+#include "include/batchdiff.h"
+#include "include/deltadecoder.h"
+#include "include/deltaencoder.h"
+#include "include/diffengine.h"
+#include "include/fingerprint.h"
+#include "include/hunks.h"
 #include "include/limits.h"
+#include "include/mappedfile.h"
+#include "include/match.h"
+#include "include/merge3.h"
+#include "include/metrics.h"
 #include "include/patch.h"
+#include "include/pool.h"
+#include "include/resumablediff.h"
+#include "include/sink.h"
+#include "include/source.h"
+#include "include/streamdiff.h"
+#include "include/tokens.h"
+#include "include/utf8.h"
+#include "include/varint.h"
+#include "include/wordtokenizer.h"
 
 /**
- *  Main procedure
- *  @return int
+ *  Number of checks that failed
+ *  @var size_t
  */
-int main()
+static size_t failures = 0;
+
+/**
+ *  Report the result of a check
+ *  @param  success     did the check succeed?
+ *  @param  name        name of the check
+ */
+static void check(bool success, const char *name)
+{
+    // only failures are reported
+    if (success) return;
+
+    // count and report the failure
+    failures += 1;
+    printf("failed: %s\n", name);
+}
+
+
+/**
+ *  Source that reads from a string, in blocks of a limited size
+ */
+class StringSource : public DIFF::Source
+{
+private:
+    /**
+     *  The data and the position of the next read
+     *  @var std::string
+     *  @var size_t
+     */
+    std::string _data;
+    size_t _position = 0;
+
+    /**
+     *  Max number of bytes per read
+     *  @var size_t
+     */
+    size_t _block;
+
+public:
+    /**
+     *  Constructor
+     *  @param  data        the data
+     *  @param  block       max number of bytes per read
+     */
+    StringSource(const std::string &data, size_t block = 1000) : _data(data), _block(block) {}
+
+    /**
+     *  Read data
+     *  @param  buffer      where to store the data
+     *  @param  size        max number of bytes to read
+     *  @return size_t
+     */
+    virtual size_t read(char *buffer, size_t size)
+    {
+        // the number of bytes to copy
+        size_t bytes = std::min(std::min(size, _block), _data.size() - _position);
+
+        // copy them
+        memcpy(buffer, _data.data() + _position, bytes);
+        _position += bytes;
+        return bytes;
+    }
+};
+
+/**
+ *  Task that tells when it started, and then runs until it is released
+ */
+class BlockingTask : public DIFF::Task
+{
+private:
+    /**
+     *  The flag that releases the task (nullptr if the task does not have to wait)
+     *  @var std::atomic
+     */
+    const std::atomic<bool> *_released;
+
+protected:
+    /**
+     *  Run the task
+     */
+    virtual void execute()
+    {
+        // we started, wait until we are released
+        started = true;
+        while (_released != nullptr && !_released->load()) std::this_thread::yield();
+    }
+
+public:
+    /**
+     *  Has the task started?
+     *  @var std::atomic
+     */
+    std::atomic<bool> started;
+
+    /**
+     *  Constructor
+     *  @param  released    the flag that releases the task
+     */
+    BlockingTask(const std::atomic<bool> *released = nullptr) : _released(released), started(false) {}
+};
+
+/**
+ *  Sink that rebuilds both inputs from the diffs
+ */
+class StringSink : public DIFF::Sink
+{
+public:
+    /**
+     *  The rebuilt inputs
+     *  @var std::string
+     */
+    std::string input1;
+    std::string input2;
+
+    /**
+     *  Process a diff
+     *  @param  operation   the operation
+     *  @param  data        the data
+     *  @param  size        number of bytes
+     */
+    virtual void write(DIFF::Operation operation, const char *data, size_t size)
+    {
+        // inserted data is only part of the second input, deleted data only of the first
+        if (operation != DIFF::Operation::INSERT) input1.append(data, size);
+        if (operation != DIFF::Operation::DELETE) input2.append(data, size);
+    }
+};
+
+
+/**
+ *  Does a patch rebuild both inputs?
+ *  @param  patch       the patch
+ *  @param  input1      the first input
+ *  @param  input2      the second input
+ *  @return bool
+ */
+template <typename patch_t>
+static bool rebuilds(const patch_t &patch, const std::string &input1, const std::string &input2)
+{
+    // the rebuilt inputs
+    std::string result1, result2;
+
+    // walk over the diffs
+    for (const auto &diff : patch)
+    {
+        // inserted data is only part of the second input, deleted data only of the first
+        if (diff.operation() != DIFF::Operation::INSERT) result1.append(patch.buffer(diff).data(), diff.bytes());
+        if (diff.operation() != DIFF::Operation::DELETE) result2.append(patch.buffer(diff).data(), diff.bytes());
+    }
+
+    // compare them
+    return result1 == input1 && result2 == input2;
+}
+
+
+/**
+ *  Describe the diffs of a patch, e.g. "-ab+12=xyz"
+ *  @param  patch       the patch
+ *  @return std::string
+ */
+template <typename patch_t>
+static std::string describe(const patch_t &patch)
+{
+    // the result
+    std::string result;
+
+    // walk over the diffs
+    for (const auto &diff : patch)
+    {
+        // the operation, and its data
+        result.push_back(diff.operation() == DIFF::Operation::INSERT ? '+' : diff.operation() == DIFF::Operation::DELETE ? '-' : '=');
+        result.append(patch.buffer(diff).data(), diff.bytes());
+    }
+
+    // done
+    return result;
+}
+
+/**
+ *  Generate a text without newlines and without repetitions of lines
+ *  @param  size        number of bytes
+ *  @param  seed        seed for the text
+ *  @return std::string
+ */
+static std::string noise(size_t size, unsigned seed)
+{
+    // the result
+    std::string result;
+
+    // a simple linear congruential generator is good enough
+    for (size_t i = 0; i < size; ++i) { seed = seed * 1103515245 + 12345; result.push_back('a' + (seed >> 16) % 26); }
+
+    // done
+    return result;
+}
+
+
+/**
+ *  Generate a sequence of elements from a small alphabet
+ *  @param  size        number of elements
+ *  @param  alphabet    number of different elements
+ *  @param  seed        state of the generator (this is updated)
+ *  @return std::vector
+ */
+static std::vector<uint32_t> elements(size_t size, unsigned alphabet, unsigned &seed)
+{
+    // the result
+    std::vector<uint32_t> result;
+
+    // the same generator as for the noise
+    for (size_t i = 0; i < size; ++i) { seed = seed * 1103515245 + 12345; result.push_back(1 + (seed >> 16) % alphabet); }
+
+    // done
+    return result;
+}
+
+
+/**
+ *  Length of the longest common subsequence, this is the number of characters
+ *  that an optimal patch keeps
+ *  @param  text1       the first sequence
+ *  @param  text2       the second sequence
+ *  @return size_t
+ */
+static size_t lcs(const std::vector<uint32_t> &text1, const std::vector<uint32_t> &text2)
+{
+    // one row of the table for each element of the first sequence
+    std::vector<size_t> previous(text2.size() + 1, 0), current(text2.size() + 1, 0);
+
+    // fill the table row by row
+    for (size_t i = 0; i < text1.size(); ++i, previous.swap(current))
+    {
+        // the columns of the row
+        for (size_t j = 0; j < text2.size(); ++j) current[j + 1] = text1[i] == text2[j] ? previous[j] + 1 : std::max(previous[j + 1], current[j]);
+    }
+
+    // done
+    return previous[text2.size()];
+}
+
+
+/**
+ *  Generate a pair of small texts: either two unrelated texts, or a text and
+ *  a copy of it with a couple of edits
+ *  @param  index       index of the pair
+ *  @param  seed        state of the generator (this is updated)
+ *  @param  text1       the first text
+ *  @param  text2       the second text
+ */
+static void pair(size_t index, unsigned &seed, std::vector<uint32_t> &text1, std::vector<uint32_t> &text2)
+{
+    // the first text, and a second one that is either unrelated or a copy
+    text1 = elements(index % 37, 1 + index % 4, seed);
+    text2 = index % 2 ? elements(index % 29, 1 + index % 4, seed) : text1;
+
+    // unrelated texts are ready
+    if (index % 2) return;
+
+    // remove and insert a couple of elements
+    for (auto edit : elements(index % 5, 1000, seed))
+    {
+        // remove an element, or insert one
+        if (edit % 2 && !text2.empty()) text2.erase(text2.begin() + edit % text2.size());
+        else text2.insert(text2.begin() + edit % (text2.size() + 1), 1 + edit % 4);
+    }
+}
+
+/**
+ *  Number of characters that a patch keeps
+ *  @param  patch       the patch
+ *  @return size_t
+ */
+template <typename patch_t>
+static size_t common(const patch_t &patch)
+{
+    // the result
+    size_t result = 0;
+
+    // add up the equal diffs
+    for (const auto &diff : patch) if (diff.operation() == DIFF::Operation::EQUAL) result += patch.text(diff).characters();
+
+    // done
+    return result;
+}
+
+
+/**
+ *  Generate a text with lines, where the lines are taken from a small set so
+ *  that they repeat
+ *  @param  count       number of lines
+ *  @param  seed        seed for the text
+ *  @return std::string
+ */
+static std::string lines(size_t count, unsigned seed)
+{
+    // the result
+    std::string result;
+
+    // pick the lines
+    for (auto line : elements(count, 50, seed)) result.append("line " + std::to_string(line) + " " + noise(20 + line, line) + "\n");
+
+    // done
+    return result;
+}
+
+
+/**
+ *  Two big texts with many lines, where a couple of lines changed
+ *  @param  text1       the first text
+ *  @param  text2       the second text
+ */
+static void bigtexts(std::string &text1, std::string &text2)
+{
+    // the first text
+    text1 = lines(2000, 14);
+
+    // the second one replaces and inserts a couple of lines
+    text2 = text1.substr(0, 20000) + lines(20, 15) + text1.substr(25000, 30000) + noise(100, 16) + text1.substr(60000);
+}
+
+/**
+ *  The simple patch that the library started with
+ */
+static void simple()
 {
     // create two string
     DIFF::Ascii input1("hallo daar");
@@ -29,7 +384,757 @@ int main()
     
     // get the patch
     DIFF::Patch<> patch(limits, input1, input2);
+
+    // it should rebuild the inputs
+    check(rebuilds(patch, "hallo daar", "hallo hier"), "simple patch");
+}
+
+
+/**
+ *  Patches of small random texts must be optimal
+ */
+static void optimal()
+{
+    // without a timeout, because the half match shortcut (which is only used with a deadline) is not optimal
+    DIFF::Limits limits;
+    limits.timeout = 0.0f;
+
+    // many small pairs
+    unsigned seed = 13;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        // the texts
+        std::vector<uint32_t> text1, text2;
+        pair(i, seed, text1, text2);
+
+        // the texts as ascii
+        std::string ascii1, ascii2;
+        for (auto element : text1) ascii1.push_back('a' + element);
+        for (auto element : text2) ascii2.push_back('a' + element);
+
+        // the patch should rebuild the texts and keep as much as possible
+        DIFF::Patch<DIFF::Ascii> patch(limits, DIFF::Ascii(ascii1.data(), ascii1.size()), DIFF::Ascii(ascii2.data(), ascii2.size()), false);
+        check(rebuilds(patch, ascii1, ascii2) && common(patch) == lcs(text1, text2), "optimal ascii patch");
+    }
+}
+
+/**
+ *  Big texts with and without the line mode
+ */
+static void linemode()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // texts with many lines
+    std::string text1, text2;
+    bigtexts(text1, text2);
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+    // the patch with and without the line mode
+    DIFF::Patch<> patch1(limits, input1, input2, true);
+    DIFF::Patch<> patch2(limits, input1, input2, false);
+    check(rebuilds(patch1, text1, text2), "patch in line mode");
+    check(rebuilds(patch2, text1, text2), "patch without line mode");
+}
+
+/**
+ *  Patches of small random utf8 texts must be optimal too, and invalid utf8
+ *  is rejected
+ */
+static void utf8s()
+{
+    // without a timeout, because the half match shortcut (which is only used with a deadline) is not optimal
+    DIFF::Limits limits;
+    limits.timeout = 0.0f;
+
+    // characters of one up to four bytes
+    const char *characters[] = { "", "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80" };
+
+    // many small pairs
+    unsigned seed = 13;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        // the texts
+        std::vector<uint32_t> text1, text2;
+        pair(i, seed, text1, text2);
+
+        // the texts as utf8
+        std::string utf1, utf2;
+        for (auto element : text1) utf1.append(characters[element]);
+        for (auto element : text2) utf2.append(characters[element]);
+
+        // the patch should rebuild the texts and keep as many characters as possible
+        DIFF::Patch<DIFF::Utf8> patch(limits, DIFF::Utf8(utf1.data(), utf1.size()), DIFF::Utf8(utf2.data(), utf2.size()), false);
+        check(rebuilds(patch, utf1, utf2) && common(patch) == lcs(text1, text2), "optimal utf8 patch");
+    }
+
+    // utf8 texts with many lines, every seventh line is changed in the second text
+    std::string big1, big2;
+    for (size_t i = 0; i < 300; ++i)
+    {
+        // the line, and the changed line
+        std::string line = "\xe2\x82\xac " + std::to_string(i) + " " + noise(30, i) + " \xc3\xa9\n";
+        big1.append(line);
+        big2.append(i % 7 ? line : "\xf0\x9f\x98\x80" + line.substr(3));
+    }
+    DIFF::Utf8 input1(big1.data(), big1.size()), input2(big2.data(), big2.size());
+
+    // with the line mode and the cleanups, the parts of the texts are taken from the original texts
+    DIFF::Limits cleaning;
+    cleaning.semantic = cleaning.efficient = true;
+    DIFF::Patch<DIFF::Utf8> patch(cleaning, input1, input2, true);
+    size_t characters1 = 0, characters2 = 0;
+    for (const auto &diff : patch)
+    {
+        // count the characters of both texts
+        if (diff.operation() != DIFF::Operation::INSERT) characters1 += patch.text(diff).characters();
+        if (diff.operation() != DIFF::Operation::DELETE) characters2 += patch.text(diff).characters();
+    }
+    check(rebuilds(patch, big1, big2) && characters1 == input1.characters() && characters2 == input2.characters(), "utf8 patch with the line mode");
+
+    // an edit in the middle of the second text
+    size_t offset = input2.offset(input2.characters() / 2);
+    std::string edited = big2.substr(0, offset) + "\xe2\x82\xac" + big2.substr(offset);
+    DIFF::Patch<DIFF::Utf8> updated(cleaning, patch, input1, DIFF::Utf8(edited.data(), edited.size()), offset, 0, 3);
+    check(rebuilds(updated, big1, edited), "updated utf8 patch");
+
+    // invalid utf8 is rejected
+    bool rejected = false;
+    try { DIFF::Utf8 invalid("\xc3", 1); } catch (const std::invalid_argument &) { rejected = true; }
+    check(rejected, "invalid utf8");
+}
+
+/**
+ *  A patch with a thread pool is the same as without
+ */
+static void pooled()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // texts with many lines
+    std::string text1, text2;
+    bigtexts(text1, text2);
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+    // the patch with and without a pool
+    DIFF::Pool pool(4);
+    DIFF::Patch<> patch(limits, input1, input2, false);
+    DIFF::Patch<> pooled(limits, input1, input2, pool, false);
+    check(rebuilds(pooled, text1, text2) && common(pooled) == common(patch), "patch with a thread pool");
+}
+
+/**
+ *  A thread that waits for a task only runs that task (or the tasks it pushed),
+ *  and not the unrelated tasks that are in the queues
+ */
+static void waiting()
+{
+    // a pool with a single worker, that is kept busy
+    DIFF::Pool pool(1);
+    std::atomic<bool> released(false);
+    BlockingTask blocker(&released), unrelated, awaited;
+    pool.push(&blocker);
+    while (!blocker.started) std::this_thread::yield();
+
+    // push an unrelated task before the task that we wait for
+    pool.push(&unrelated);
+    pool.push(&awaited);
+
+    // the awaited task is run by this thread, the unrelated task stays queued for the worker
+    pool.wait(&awaited);
+    check(awaited.started && !unrelated.started, "waiting for a task");
+
+    // release the worker
+    released = true;
+    pool.wait(&blocker);
+    pool.wait(&unrelated);
+}
+
+/**
+ *  A batch of pairs, with and without a thread pool
+ */
+static void batches()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // texts of growing sizes, every text is compared with the next one
+    std::vector<std::pair<DIFF::Ascii, DIFF::Ascii>> pairs;
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < 40; ++i) texts.push_back(noise(i * 10, (unsigned)i + 21));
+    for (size_t i = 0; i + 1 < texts.size(); ++i) pairs.emplace_back(DIFF::Ascii(texts[i].data(), texts[i].size()), DIFF::Ascii(texts[i + 1].data(), texts[i + 1].size()));
+
+    // calculate the batches
+    DIFF::Pool pool(2);
+    DIFF::BatchDiff<> batch1(limits, pairs), batch2(limits, pairs, pool);
+    for (const auto *batch : { &batch1, &batch2 })
+    {
+        // every pair should be rebuilt
+        bool success = batch->size() == pairs.size();
+        for (size_t i = 0; success && i < batch->size(); ++i)
+        {
+            // rebuild the texts of the pair
+            std::string result1, result2;
+            for (auto diff = batch->begin(i); diff != batch->end(i); ++diff)
+            {
+                // inserted data is only part of the second text, deleted data only of the first
+                DIFF::Buffer buffer = batch->buffer(i, *diff);
+                if (diff->operation() != DIFF::Operation::INSERT) result1.append(buffer.data(), buffer.bytes());
+                if (diff->operation() != DIFF::Operation::DELETE) result2.append(buffer.data(), buffer.bytes());
+            }
+            success = result1 == texts[i] && result2 == texts[i + 1];
+        }
+        check(success, "batch diff");
+    }
+}
+
+/**
+ *  The engine reuses its memory for the next patches
+ */
+static void engines()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // a text and two versions of it
+    std::string text1 = lines(100, 20), text2 = text1.substr(0, 500) + "inserted" + text1.substr(500), text3 = text1.substr(0, 1000) + text1.substr(1100);
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size()), input3(text3.data(), text3.size());
+
+    // calculate the patches one after the other
+    DIFF::DiffEngine<> engine(limits);
+    check(rebuilds(engine.diff(input1, input2), text1, text2) && rebuilds(engine.diff(input1, input3), text1, text3), "diff engine");
+}
+
+/**
+ *  Memory mapped files
+ */
+static void mapped()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // a temporary file with a text
+    std::string text = lines(200, 22);
+    FILE *file = tmpfile();
+    if (file == nullptr) return check(false, "temporary file");
+    fwrite(text.data(), 1, text.size(), file);
+    fflush(file);
+
+    // map it, and compare it to an empty file
+    DIFF::MappedFile mapped(fileno(file));
+    FILE *empty = tmpfile();
+    DIFF::MappedFile nothing(fileno(empty));
+    DIFF::Patch<> patch(limits, mapped.text(), nothing.text());
+    check(mapped.bytes() == text.size() && nothing.bytes() == 0 && rebuilds(patch, text, ""), "memory mapped files");
+
+    // clean up
+    fclose(file);
+    fclose(empty);
+
+    // files that do not exist can not be mapped
+    bool rejected = false;
+    try { DIFF::MappedFile missing("/this/file/does/not/exist"); } catch (const std::system_error &) { rejected = true; }
+    check(rejected, "missing file");
+}
+
+
+/**
+ *  Patches over token ids must be optimal too
+ */
+static void tokens()
+{
+    // without a timeout, because the half match shortcut (which is only used with a deadline) is not optimal
+    DIFF::Limits limits;
+    limits.timeout = 0.0f;
+
+    // many small pairs
+    unsigned seed = 13;
+    for (size_t i = 0; i < 2000; ++i)
+    {
+        // the texts
+        std::vector<uint32_t> text1, text2;
+        pair(i, seed, text1, text2);
+
+        // the patch should rebuild the texts and keep as many tokens as possible
+        DIFF::Patch<DIFF::Tokens> patch(limits, DIFF::Tokens(text1.data(), text1.size()), DIFF::Tokens(text2.data(), text2.size()), false);
+        check(rebuilds(patch, std::string((const char *)text1.data(), text1.size() * 4), std::string((const char *)text2.data(), text2.size() * 4)) && common(patch) == lcs(text1, text2), "optimal token patch");
+    }
+}
+
+/**
+ *  A patch over words does not split the words
+ */
+static void words()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // a patch over words
+    DIFF::Ascii words1("the quick brown fox"), words2("the quack brown fox");
+    DIFF::Patch<> words(limits, words1, words2, DIFF::WordTokenizer());
+
+    // the changed word is deleted as a whole
+    bool whole = false;
+    for (const auto &diff : words) if (diff.operation() == DIFF::Operation::DELETE) whole = std::string(words.buffer(diff).data(), diff.bytes()) == "quick";
+    check(whole && rebuilds(words, "the quick brown fox", "the quack brown fox"), "patch over words");
+}
+
+/**
+ *  Updating a patch after small edits of the second text
+ */
+static void updates()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // the texts before the edits
+    std::string text1 = lines(500, 19), text2 = text1.substr(0, 5000) + "changed" + text1.substr(6000);
+    DIFF::Ascii input1(text1.data(), text1.size());
+    DIFF::Patch<> patch(limits, input1, DIFF::Ascii(text2.data(), text2.size()));
+
+    // edits: an insert, a removal, a replacement, and edits at the edges
+    const size_t edits[][3] = { { 100, 0, 10 }, { 3000, 50, 0 }, { 5003, 4, 9 }, { 0, 3, 3 }, { text2.size() - 5, 5, 2 } };
+    for (const auto &edit : edits)
+    {
+        // the edited text
+        std::string text3 = text2.substr(0, edit[0]) + noise(edit[2], (unsigned)edit[0]) + text2.substr(edit[0] + edit[1]);
+
+        // update the patch
+        DIFF::Patch<> updated(limits, patch, input1, DIFF::Ascii(text3.data(), text3.size()), edit[0], edit[1], edit[2]);
+        check(rebuilds(updated, text1, text3), "updated patch");
+    }
+
+    // an edit that does not match the texts is calculated from scratch
+    DIFF::Patch<> recalculated(limits, patch, input1, input1, 10, 20, 30);
+    check(recalculated.size() == 1 && rebuilds(recalculated, text1, text1), "updated patch with a wrong edit");
+}
+
+
+/**
+ *  The cleanup passes
+ */
+static void cleanups()
+{
+    // limits without and with the cleanup passes
+    DIFF::Limits limits, semantic, efficient;
+    semantic.semantic = true;
+    efficient.efficient = true;
+
+    // a small edit that accidentally keeps a single character
+    DIFF::Ascii mouse("mouse"), sofas("sofas");
+    DIFF::Patch<> raw(limits, mouse, sofas);
+    DIFF::Patch<> cleaned(semantic, mouse, sofas);
+    check(raw.size() > 2 && cleaned.size() == 2 && rebuilds(cleaned, "mouse", "sofas"), "semantic cleanup");
+
+    // the efficiency cleanup gives the same results as diff-match-patch, the texts are
+    // chosen so that the raw patch is the one of the diff-match-patch test
+    struct { const char *text1, *text2; short editcost; const char *expected; } cases[] = {
+        { "abwxyzcd", "12wxyz34", 4, "-ab+12=wxyz-cd+34" },
+        { "abxyzcd", "12xyz34", 4, "-abxyzcd+12xyz34" },
+        { "xcd", "12x34", 4, "-xcd+12x34" },
+        { "abxyzcd", "12xy34z56", 4, "-abxyzcd+12xy34z56" },
+        { "abwxyzcd", "12wxyz34", 5, "-abwxyzcd+12wxyz34" },
+        { "dbdac", "aaddbab", 4, "+aa=d-bdac+dbab" },
+    };
+    for (const auto &test : cases)
+    {
+        // the texts, and the edit cost
+        DIFF::Ascii input1(test.text1), input2(test.text2);
+        efficient.editcost = test.editcost;
+
+        // the patch should be the same
+        check(describe(DIFF::Patch<>(efficient, input1, input2)) == test.expected, "efficiency cleanup like diff-match-patch");
+    }
+    efficient.editcost = DIFF::Limits().editcost;
+
+    // random texts never get more diffs by cleaning up
+    unsigned seed = 18;
+    for (size_t i = 0; i < 500; ++i)
+    {
+        // the texts
+        std::string text1 = noise(i % 100, seed++), text2 = text1.substr(0, i % 37) + noise(i % 7, seed++) + text1.substr(std::min(text1.size(), i % 53));
+        DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+        // the patches
+        DIFF::Patch<> patch1(limits, input1, input2);
+        DIFF::Patch<> patch2(semantic, input1, input2);
+        DIFF::Patch<> patch3(efficient, input1, input2);
+        check(rebuilds(patch2, text1, text2) && patch2.size() <= patch1.size(), "semantic cleanup of random texts");
+        check(rebuilds(patch3, text1, text2) && patch3.size() <= patch1.size(), "efficiency cleanup of random texts");
+    }
+}
+
+/**
+ *  Patches with fingerprints, also with a fingerprint that claims that two
+ *  different texts are identical
+ */
+static void fingerprints()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // two texts of the same size
+    std::string text1 = noise(2000, 10), text2 = text1;
+    text2[1000] = '#';
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+    // identical texts are recognized, and a changed text is not
+    DIFF::Patch<> identical(limits, input1, DIFF::Fingerprint(input1.buffer()), input1, DIFF::Fingerprint(input1.buffer()));
+    DIFF::Patch<> changed(limits, input1, DIFF::Fingerprint(input1.buffer()), input2, DIFF::Fingerprint(input2.buffer()));
+    check(identical.size() == 1 && rebuilds(identical, text1, text1), "fingerprints of identical texts");
+    check(rebuilds(changed, text1, text2), "fingerprints of changed texts");
+
+    // a collision of the hashes (the fingerprint of the first text for both texts) must not hide the change
+    DIFF::Fingerprint fingerprint(input1.buffer());
+    DIFF::Patch<> collision(limits, input1, fingerprint, input2, fingerprint);
+    check(rebuilds(collision, text1, text2), "fingerprints with a collision");
+
+    // with a similarity threshold, unrelated texts are replaced as a whole
+    DIFF::Limits similar(limits);
+    similar.similarity = 0.5f;
+    std::string text3 = noise(2000, 11);
+    DIFF::Ascii input3(text3.data(), text3.size());
+    DIFF::Patch<> unrelated(similar, input1, DIFF::Fingerprint(input1.buffer()), input3, DIFF::Fingerprint(input3.buffer()));
+    check(unrelated.size() == 2 && rebuilds(unrelated, text1, text3), "fingerprints of unrelated texts");
+    check(DIFF::Fingerprint(input1.buffer()).similarity(DIFF::Fingerprint(input2.buffer())) > 0.5, "similarity of similar texts");
+
+    // a collision also makes unrelated texts look the same, so the algorithm runs
+    DIFF::Patch<> forced(similar, input1, fingerprint, input3, fingerprint);
+    check(forced.size() > 2 && rebuilds(forced, text1, text3), "fingerprints of unrelated texts with a collision");
+
+    // the engine uses the fingerprints too
+    DIFF::DiffEngine<> engine(limits);
+    check(rebuilds(engine.diff(input1, DIFF::Fingerprint(input1.buffer()), input2, DIFF::Fingerprint(input2.buffer())), text1, text2), "diff engine with fingerprints");
+    check(rebuilds(engine.diff(input1, fingerprint, input2, fingerprint), text1, text2), "diff engine with a collision");
+}
+
+/**
+ *  Metrics are the same as those of the patch
+ */
+static void metrics()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // a text, and a version with an inserted line
+    std::string text1 = lines(100, 20), text2 = text1.substr(0, 500) + "inserted\n" + text1.substr(500);
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+    // the metrics, and those of the patch
+    DIFF::Patch<> patch(limits, input1, input2);
+    DIFF::Metrics metrics1(limits, input1, input2), metrics2(patch);
+    check(metrics1.inserted() == 9 && metrics1.deleted() == 0 && metrics1.equal() == text1.size() && metrics1.levenshtein() == metrics2.levenshtein(), "metrics");
+    check(DIFF::Metrics(limits, input1, input1).identical(), "metrics of identical texts");
+
+    // the engine calculates the same metrics
+    DIFF::DiffEngine<> engine(limits);
+    check(engine.metrics(input1, input2).levenshtein() == metrics1.levenshtein(), "metrics of the diff engine");
+}
+
+/**
+ *  Three-way merges, with and without a conflict
+ */
+static void merges()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // the offsets of a couple of lines in a base text
+    std::string base = lines(100, 20);
+    size_t line10 = 0, line20 = 0, line30 = 0;
+    for (size_t i = 0, count = 0; i < base.size(); ++i) if (base[i] == '\n' && ++count) { if (count == 10) line10 = i + 1; if (count == 20) line20 = i + 1; if (count == 30) line30 = i + 1; }
+
+    // two versions that changed different lines
+    std::string ours = base.substr(0, line10) + "our line\n" + base.substr(line10);
+    std::string theirs = base.substr(0, line30) + "their line\n" + base.substr(line30);
+    std::string both = base.substr(0, line10) + "our line\n" + base.substr(line10, line30 - line10) + "their line\n" + base.substr(line30);
+    DIFF::Ascii input(base.data(), base.size()), input1(ours.data(), ours.size()), input2(theirs.data(), theirs.size());
+
+    // they are merged without a conflict (also with a thread pool)
+    DIFF::Pool pool(2);
+    DIFF::Merge3<> merge1(limits, input, input1, input2);
+    DIFF::Merge3<> merge2(limits, input, input1, input2, pool);
+    check(merge1.clean() && std::string(merge1.buffer().data(), merge1.buffer().bytes()) == both, "clean merge");
+    check(merge2.clean() && std::string(merge2.buffer().data(), merge2.buffer().bytes()) == both, "clean merge with a thread pool");
+
+    // both sides change the same line
+    std::string other = base.substr(0, line20) + "other line\n" + base.substr(line20);
+    std::string another = base.substr(0, line20) + "another line\n" + base.substr(line20);
+    DIFF::Ascii input3(other.data(), other.size()), input4(another.data(), another.size());
+    DIFF::Merge3<> merge3(limits, input, input3, input4);
+    check(!merge3.clean() && merge3.conflicts().size() == 1 && std::string(merge3.buffer().data(), merge3.buffer().bytes()) == other, "merge with a conflict");
+}
+
+/**
+ *  A resumable diff gives the same patches in steps
+ */
+static void resumable()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // texts with many lines
+    std::string text1, text2;
+    bigtexts(text1, text2);
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+    // the patch in small steps (with and without the line mode)
+    for (bool checklines : { true, false })
+    {
+        // run the steps until it is finished
+        DIFF::ResumableDiff<> diff(limits, input1, input2, checklines);
+        while (!diff.step(0.0001)) {}
+
+        // it should rebuild the inputs
+        check(diff.finished() && rebuilds(diff.patch(), text1, text2), "resumable diff");
+    }
+
+    // a resumable diff of small texts without a timeout is optimal too
+    DIFF::Limits unlimited;
+    unlimited.timeout = 0.0f;
+    unsigned seed = 17;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        // the texts
+        std::vector<uint32_t> elements1, elements2;
+        pair(i, seed, elements1, elements2);
+        std::string small1, small2;
+        for (auto element : elements1) small1.push_back('a' + element);
+        for (auto element : elements2) small2.push_back('a' + element);
+
+        // run the diff in one go
+        DIFF::ResumableDiff<> diff(unlimited, DIFF::Ascii(small1.data(), small1.size()), DIFF::Ascii(small2.data(), small2.size()), false);
+        while (!diff.step(1.0)) {}
+        check(rebuilds(diff.patch(), small1, small2) && common(diff.patch()) == lcs(elements1, elements2), "optimal resumable diff");
+    }
+}
+
+/**
+ *  Stream diffs, also when one of the inputs is exhausted before the other one
+ */
+static void streams()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // pairs of inputs: one empty input, a single byte, and inputs without common lines
+    const std::string inputs[][2] = {
+        { "", noise(10000, 1) },
+        { noise(10000, 2), "" },
+        { "x", noise(10000, 3) },
+        { noise(5000, 4) + "\ncommon line\n" + noise(5000, 5), noise(3000, 6) + "\ncommon line\n" + noise(7000, 7) },
+    };
+
+    // compare them with a small window
+    for (const auto &pair : inputs)
+    {
+        // the streams
+        StringSource source1(pair[0]), source2(pair[1]);
+        StringSink sink;
+
+        // calculate the diff
+        DIFF::StreamDiff<> diff(limits, source1, source2, sink, 4096);
+
+        // it should rebuild the inputs
+        check(sink.input1 == pair[0] && sink.input2 == pair[1], "stream diff");
+    }
+}
+
+
+/**
+ *  Binary deltas: a round trip, and deltas that are corrupt
+ */
+static void deltas()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // two texts with a couple of edits
+    std::string text1 = noise(3000, 8), text2 = text1.substr(0, 1000) + "inserted" + text1.substr(1200, 1500) + noise(100, 9);
+
+    // encode the patch, and decode it again
+    DIFF::Patch<> patch(limits, DIFF::Ascii(text1.data(), text1.size()), DIFF::Ascii(text2.data(), text2.size()));
+    DIFF::DeltaEncoder encoder(patch);
+    DIFF::DeltaDecoder decoder(encoder.buffer());
+
+    // rebuild the new text
+    std::vector<char> target(decoder.bytes2());
+    decoder.apply(text1.data(), text1.size(), target.data());
+    check(decoder.size() == patch.size() && std::string(target.data(), target.size()) == text2, "delta round trip");
+
+    // a delta for two empty texts, with records whose sizes wrap around when they are added up
+    char corrupt[2 + 8 * DIFF::Varint::maxsize];
+    size_t size = DIFF::Varint::write(corrupt, 0);
+    size += DIFF::Varint::write(corrupt + size, 0);
+    for (size_t i = 0; i < 8; ++i) size += DIFF::Varint::write(corrupt + size, (1ULL << 61) << 2 | (uint64_t)DIFF::Operation::EQUAL);
+
+    // the decoder should reject it
+    bool rejected = false;
+    try { DIFF::DeltaDecoder decoder(corrupt, size); } catch (const std::invalid_argument &) { rejected = true; }
+    check(rejected, "delta with overflowing sizes");
+
+    // a delta that covers more than the texts
+    size = DIFF::Varint::write(corrupt, 4);
+    size += DIFF::Varint::write(corrupt + size, 4);
+    size += DIFF::Varint::write(corrupt + size, 8 << 2 | (uint64_t)DIFF::Operation::EQUAL);
+
+    // the decoder should reject it too
+    rejected = false;
+    try { DIFF::DeltaDecoder decoder(corrupt, size); } catch (const std::invalid_argument &) { rejected = true; }
+    check(rejected, "delta that covers too much");
+}
+
+
+/**
+ *  Applying patches, also when the texts or the patterns are empty
+ */
+static void applying()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // pairs of texts, some of them empty
+    std::string text = noise(3000, 12);
+    const std::string inputs[][2] = {
+        { "", "" },
+        { "", text },
+        { text, "" },
+        { text, text.substr(0, 1000) + "changed" + text.substr(1500) },
+    };
+
+    // make the hunks of each patch, and apply them to the first text
+    for (const auto &pair : inputs)
+    {
+        // the patch and its hunks
+        DIFF::Patch<> patch(limits, DIFF::Ascii(pair[0].data(), pair[0].size()), DIFF::Ascii(pair[1].data(), pair[1].size()));
+        DIFF::Hunks hunks(limits, patch);
+
+        // apply them
+        DIFF::Apply apply(limits, hunks, pair[0].data(), pair[0].size());
+        check(apply && std::string(apply.buffer().data(), apply.bytes()) == pair[1], "applying a patch");
+
+        // applying them to an empty text should not crash
+        DIFF::Apply empty(limits, hunks, nullptr, 0);
+        check(pair[0].size() > 0 || empty, "applying a patch to an empty text");
+    }
+
+    // applying hunks to a text that moved a bit
+    DIFF::Patch<> patch(limits, DIFF::Ascii(inputs[3][0].data(), inputs[3][0].size()), DIFF::Ascii(inputs[3][1].data(), inputs[3][1].size()));
+    std::string moved = "prefix" + text;
+    DIFF::Apply apply(limits, DIFF::Hunks(limits, patch), moved.data(), moved.size());
+    check(apply && std::string(apply.buffer().data(), apply.bytes()) == "prefix" + inputs[3][1], "applying a patch to a moved text");
+
+    // matches with empty texts and patterns
+    check(DIFF::Match(limits, nullptr, 0, nullptr, 0, 0).position() == 0, "empty pattern in an empty text");
+    check(DIFF::Match(limits, text.data(), text.size(), nullptr, 0, 10).position() == 10, "empty pattern in a text");
+    check(!DIFF::Match(limits, nullptr, 0, "abc", 3, 0), "pattern in an empty text");
+    check(DIFF::Match(limits, text.data(), text.size(), text.data() + 2000, 32, 1990).position() == 2000, "pattern near its location");
+}
+
+
+/**
+ *  A resumable diff that is cancelled stays empty
+ */
+static void cancelling()
+{
+    // limits for calculating
+    DIFF::Limits limits;
+
+    // texts with many lines
+    std::string text1, text2;
+    bigtexts(text1, text2);
+    DIFF::Ascii input1(text1.data(), text1.size()), input2(text2.data(), text2.size());
+
+    // cancel the diff after the first step
+    DIFF::ResumableDiff<> cancelled(limits, input1, input2, false);
+    cancelled.step(0.00001);
+    cancelled.cancel();
+    check(cancelled.cancelled() && !cancelled.finished() && cancelled.patch().size() == 0 && cancelled.step(1.0) == false, "cancelled resumable diff");
+}
+
+/**
+ *  Buffers share their storage with their copies and parts
+ */
+static void buffers()
+{
+    // a buffer that owns its data
+    std::string text = noise(1000, 23);
+    DIFF::Buffer buffer(text.data(), text.size(), true);
+
+    // copies and parts point into the same storage
+    DIFF::Buffer copy(buffer), part = buffer.part(100, 50);
+    check(buffer.owned() && copy.data() == buffer.data() && part.data() == buffer.data() + 100 && part.bytes() == 50, "shared storage");
+
+    // a part stays valid when the buffers that it came from are gone
+    buffer.clear();
+    copy.clear();
+    check(std::string(part.data(), part.bytes()) == text.substr(100, 50), "part of a released buffer");
+
+    // appending to a shared buffer does not change the others
+    DIFF::Buffer original(text.data(), text.size(), true), shared(original);
+    shared.append("appended", 8);
+    check(std::string(original.data(), original.bytes()) == text && std::string(shared.data(), shared.bytes()) == text + "appended", "append to shared storage");
+
+    // appending to a buffer that is not shared
+    DIFF::Buffer alone(text.data(), 10, true);
+    for (size_t i = 10; i < text.size(); i += 10) alone.append(text.data() + i, 10);
+    check(std::string(alone.data(), alone.bytes()) == text, "append to storage");
+
+    // a buffer with room behind its data, and a copy that shares the storage
+    DIFF::Buffer grown(text.data(), 100, true);
+    grown.append(text.data() + 100, 10);
+    DIFF::Buffer before(grown);
+
+    // appending after a shrink must not overwrite the bytes that the copy still refers to
+    grown.shrink(10);
+    grown.append("0123456789", 10);
+    check(std::string(before.data(), before.bytes()) == text.substr(0, 110), "append after shrink keeps copies");
+    check(std::string(grown.data(), grown.bytes()) == text.substr(0, 100) + "0123456789", "append after shrink");
+
+    // a copy that ends where the used part of the storage ends appends in place, after that the original can not
+    DIFF::Buffer after(before);
+    const char *storage = before.data();
+    after.append("abc", 3);
+    before.append("xyz", 3);
+    check(after.data() == storage && std::string(after.data(), after.bytes()) == text.substr(0, 110) + "abc", "append to a copy in place");
+    check(before.data() != storage && std::string(before.data(), before.bytes()) == text.substr(0, 110) + "xyz", "append to the original of a copy");
+}
+
+/**
+ *  Main procedure
+ *  @return int
+ */
+int main()
+{
+    // run the tests
+    simple();
+    optimal();
+    linemode();
+    utf8s();
+    pooled();
+    waiting();
+    batches();
+    engines();
+    mapped();
+    tokens();
+    words();
+    updates();
+    cleanups();
+    fingerprints();
+    metrics();
+    merges();
+    resumable();
+    streams();
+    deltas();
+    applying();
+    cancelling();
+    buffers();
+
+    // report the result
+    if (failures > 0) printf("%zu checks failed\n", failures);
     
     // done
-    return 0;
+    return failures > 0 ? 1 : 0;
 }